@@ -36,7 +36,17 @@ public:
 
 	inline glm::mat4 GetViewProjection() const
 	{
-		return this->projection * glm::lookAt(this->pos, this->pos + this->front, this->up);
+		return this->projection * GetView();
+	}
+
+	inline glm::mat4 GetView() const
+	{
+		return glm::lookAt(this->pos, this->pos + this->front, this->up);
+	}
+
+	inline glm::mat4 GetProjection() const
+	{
+		return this->projection;
 	}
 
         /*-------------------------------------------------------------------*/
@@ -0,0 +1,109 @@
+#ifndef __FRAME_UNIFORMS_H_
+#define __FRAME_UNIFORMS_H_
+
+#define GLM_ENABLE_EXPERIMENTAL
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+/*---------------------------------------------------------------------------*/
+
+// std140 layouts, must match the blocks of shaders/frame_data.glsl
+
+struct FrameData
+{
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::mat4 view_projection;
+
+	// width, height, 1 / width, 1 / height
+	glm::vec4 viewport;
+
+	float time;
+	float pad[3];
+};
+
+struct ObjectData
+{
+	glm::mat4 model;
+	glm::mat4 mvp;
+
+	// x: alpha
+	glm::vec4 params;
+};
+
+/*---------------------------------------------------------------------------*/
+
+/*
+	Per-frame and per-object uniforms shared by every program.
+
+	Two UBOs, each split into RING_SIZE segments, one segment per frame in flight (a
+	fence protects the segments of a frame until the GPU is done with them):
+	  - frame_ubo: the FrameData, written and bound once per frame to FRAME_BINDING,
+	  - object_ubo: the dynamic one, the pushed ObjectData at a fixed stride, each one
+	    selected with glBindBufferRange on OBJECT_BINDING.
+
+	Pushed objects are staged on the CPU and written with a single unsynchronized map
+	when the first of them is bound: two uploads per frame instead of a glUniform per
+	program and object.
+
+		BeginFrame(frame);
+		unsigned int o = Push(object);
+		...
+		BindObject(o); draw;
+		EndFrame();
+*/
+
+class FrameUniforms
+{
+	public:
+		static const GLuint FRAME_BINDING = 0;
+		static const GLuint OBJECT_BINDING = 1;
+		static const unsigned int RING_SIZE = 3;
+
+		FrameUniforms(unsigned int max_objects = 256);
+		virtual ~FrameUniforms();
+
+		void BeginFrame(const FrameData& frame);
+		void EndFrame();
+
+		// slot of the object in the current frame
+		unsigned int Push(const ObjectData& object);
+
+		// uploads the pending objects first if needed
+		void BindObject(unsigned int slot);
+
+		// writes the pending part of the segment
+		void Flush();
+
+		// glUniformBlockBinding of the FrameData / ObjectData blocks the program declares
+		static void BindBlocks(GLuint program);
+
+	public:
+		GLuint frame_ubo;
+		GLuint object_ubo;
+
+		// last frame: writes to the UBOs
+		unsigned int uploads;
+
+	private:
+		void Write(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data);
+
+		unsigned int max_objects;
+		unsigned int nb_objects;
+
+		GLsizeiptr frame_stride;
+		GLsizeiptr object_stride;
+		GLsizeiptr object_segment_size;
+
+		unsigned int segment;
+		GLsync fences[RING_SIZE];
+
+		// objects of the current segment, bytes [0, uploaded) are already in object_ubo
+		std::vector<unsigned char> staging;
+		GLsizeiptr used;
+		GLsizeiptr uploaded;
+};
+
+#endif
@@ -3,6 +3,9 @@
 #include "input.h"
 #include "shader.h"
 #include "render.h"
+#include "frame_uniforms.h"
+#include "texture_stream.h"
+#include "tiled_render.h"
 
 #include <sstream>
 #include <vector>
@@ -30,6 +33,18 @@ const int screen_height = 800;
 bool fullscreen = false; // if true display->screen_width / screen_height are overwritten by monitor size
 bool vsync = false;
 
+// texture streaming globals (empty pattern: wireframe quad only)
+string texture_pattern = ""; // printf pattern of the frame files, e.g. "../frames/frame_%05d.ppm"
+int texture_frames = 0;
+float texture_fps = 25.0f;
+int texture_prefetch = 8; // next frames queued ahead of the playback
+size_t texture_budget = 256 << 20; // resident textures, bytes
+
+// tiled full screen shader globals (empty: the quad scene)
+string tiled_shader = ""; // shadertoy style fragment shader, e.g. "../shaders/raymarch_fs.glsl"
+float tiled_budget_ms = 8.0f; // GPU time of the tiles rendered each frame
+int tiled_tile_size = 128;
+
 // camera globals
 float keyboard_sensitivity = 0.01f;
 float mouse_sensitivity = 0.1f;
@@ -53,10 +68,27 @@ int main(int argc, char* argv[])
 
 	// shaders
 	auto shader = make_shared<Shader>("../shaders/quad_vs.glsl", "../shaders/quad_fs.glsl");
+	auto texture_shader = make_shared<Shader>("../shaders/quad_vs.glsl", "../shaders/quad_tex_fs.glsl");
+
+	// decode threads + PBO uploads, nothing blocks the loop
+	auto textures = make_shared<TextureStream>(texture_budget);
+	string shown_path;
+
+	// heavy full screen shader rendered a few tiles per frame
+	shared_ptr<TiledRender> tiled;
+
+	if(!tiled_shader.empty())
+		tiled = make_shared<TiledRender>(display->screen_width, display->screen_height, tiled_shader, tiled_budget_ms, tiled_tile_size);
 
 	// camera
 	auto camera = make_shared<Camera>(camera_pos, fov, (float)display->screen_width/(float)display->screen_height, znear, zfar, mouse_sensitivity, keyboard_sensitivity);
 
+	// per-frame / per-object uniform blocks shared by the programs
+	FrameUniforms uniforms;
+	FrameData frame_data;
+
+	frame_data.viewport = glm::vec4(display->screen_width, display->screen_height, 1.0f / display->screen_width, 1.0f / display->screen_height);
+
 	// --- main loop
 
 	// cube motion
@@ -64,7 +96,7 @@ int main(int argc, char* argv[])
 
     // FPS
     double t, t0, fps;
-    char fpstr[50];
+    char fpstr[128];
     int frames = 0;
 
     t0 = glfwGetTime();
@@ -80,7 +112,10 @@ int main(int argc, char* argv[])
         if( (t-t0) > 1.0 || frames == 0 )
         {
             fps = (double)frames / (t-t0);
-            sprintf( fpstr, "FPS = %.1f", fps );
+            if(tiled)
+                snprintf( fpstr, sizeof(fpstr), "FPS = %.1f - pass %u %.0f%% - %d tiles/frame (%dpx, %.2f ms)", fps, tiled->passes, tiled->Progress() * 100.0f, tiled->tiles_per_frame, tiled->tile_size, tiled->tile_ms );
+            else
+                snprintf( fpstr, sizeof(fpstr), "FPS = %.1f", fps );
             glfwSetWindowTitle(display->mainWindow, fpstr);
             t0 = t;
             frames = 0;
@@ -118,15 +153,68 @@ int main(int argc, char* argv[])
 		rotz.z = -motion_counter;
 		glm::mat4 rot_mz = glm::rotate(rotz.z, glm::vec3(0.0f, 0.0f, 1.0f));
 
-		// send our MVP matrix to the currently bound shader
-		// camera = view_project matrix; model matrix = tr_mx * rotx_mx * rot_my * rot_mz 
-		shader -> Update(tr_mx * rotx_mx * rot_my * rot_mz, camera);
+		// camera block, written once for every program
+		frame_data.view = camera->GetView();
+		frame_data.projection = camera->GetProjection();
+		frame_data.view_projection = camera->GetViewProjection();
+		frame_data.time = t;
+
+		uniforms.BeginFrame(frame_data);
+
+		// our quad: model matrix = tr_mx * rotx_mx * rot_my * rot_mz (glm::mat4(1.0f): no motion)
+		glm::mat4 model = tr_mx * rotx_mx * rot_my * rot_mz;
+
+		ObjectData quad_data = { model, frame_data.view_projection * model, glm::vec4(1.0f, 0.0f, 0.0f, 0.0f) };
+		uniforms.BindObject(uniforms.Push(quad_data));
+
+		// streamed frame: the current one if resident, otherwise keep the last one shown (requested again: not evicted)
+		GLuint texture = 0;
+
+		if(!texture_pattern.empty() && texture_frames > 0) {
+			int index = (int)(t * texture_fps) % texture_frames;
+			char path[1024];
 
-		// no motion
-		//shader -> Update(glm::mat4(1.0f), camera);
+			snprintf(path, sizeof(path), texture_pattern.c_str(), index);
+			texture = textures -> Request(path);
+
+			if(texture) {
+				shown_path = path;
+			}
+			else if(!shown_path.empty()) {
+				texture = textures -> Request(shown_path);
+			}
+
+			for(int i = 1; i <= texture_prefetch; i++) {
+				snprintf(path, sizeof(path), texture_pattern.c_str(), (index + i) % texture_frames);
+				textures -> Prefetch(path);
+			}
+
+			textures -> Update();
+		}
 
 		// vao / vbo
-		render -> Draw();
+		if(tiled) {
+			// the offscreen image covers the whole screen
+			tiled -> Update(uniforms, t);
+			tiled -> Present();
+
+			glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+		}
+		else if(texture) {
+			glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+			texture_shader -> Bind();
+			glBindTexture(GL_TEXTURE_2D, texture);
+
+			render -> Draw();
+
+			glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+		}
+		else {
+			render -> Draw();
+		}
+
+		// the ring segment of this frame is reused once the GPU is done with it
+		uniforms.EndFrame();
 
 		// show back buffer
 		display -> SwapBuffers();
@@ -7,13 +7,13 @@ Render::Render()
 
 		float quad_screen[] = { // vertex attributes for a quad that fills the entire screen in Normalized Device Coordinates.
 			// positions   // texCoords
-			-0.8f,  0.8f,  0.0f, 0.8f,
+			-0.8f,  0.8f,  0.0f, 1.0f,
 			-0.8f, -0.8f,  0.0f, 0.0f,
-			0.8f, -0.8f,  0.8f, 0.0f,
+			0.8f, -0.8f,  1.0f, 0.0f,
 
-			-0.8f,  0.8f,  0.0f, 0.8f,
-			0.8f, -0.8f,  0.8f, 0.0f,
-			0.8f,  0.8f,  0.8f, 0.8f
+			-0.8f,  0.8f,  0.0f, 1.0f,
+			0.8f, -0.8f,  1.0f, 0.0f,
+			0.8f,  0.8f,  1.0f, 1.0f
 		};
 
 		glGenVertexArrays(1, &quadVAO);
@@ -23,8 +23,8 @@ Render::Render()
 		glBufferData(GL_ARRAY_BUFFER, sizeof(quad_screen), &quad_screen, GL_STATIC_DRAW);
 		glEnableVertexAttribArray(0);
 		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-		//glEnableVertexAttribArray(1);
-		//glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
 	    glBindVertexArray(0);
 }
 
@@ -1,4 +1,5 @@
 #include "shader.h"
+#include "frame_uniforms.h"
 #include <iostream>
 #include <fstream>
 #include <memory>
@@ -23,6 +24,7 @@ Shader::Shader(const std::string& vertexShaderFilename, const std::string& fragm
     // bind attribute index 0 (coordinates) to "position"
     // attribute locations must be setup before calling glLinkProgram.
 	glBindAttribLocation(program, 0, "position");
+	glBindAttribLocation(program, 1, "tex_coords");
 
     // link: shader => binary code uploaded to the GPU, if there is no error
 	glLinkProgram(program);
@@ -32,8 +34,8 @@ Shader::Shader(const std::string& vertexShaderFilename, const std::string& fragm
 	glValidateProgram(program);
 	CheckShaderError(program, GL_LINK_STATUS, true, "Invalid shader program");
 
-    transformations[VIEW_PROJECTION] = glGetUniformLocation(program, "view_projection");
-    transformations[MODEL] = glGetUniformLocation(program, "model");
+    // FrameData / ObjectData blocks (shaders/frame_data.glsl) to their fixed binding points
+    FrameUniforms::BindBlocks(program);
 }
 
 /*---------------------------------------------------------------------------*/
@@ -74,17 +76,6 @@ GLuint Shader::CreateShader(const std::string& text, unsigned int type)
 
 /*---------------------------------------------------------------------------*/
 
-void Shader::Update(glm::mat4 model, std::shared_ptr<Camera> camera)
-{
-    glm::mat4 mvp = camera->GetViewProjection();
-
-    //glUniformMatrix4fv(transformations[VIEW_PROJECTION], 1, GL_FALSE, &mvp[0][0]);
-    //glUniformMatrix4fv(transformations[MODEL], 1, GL_FALSE, &model[0][0]);
-
-    glUniformMatrix4fv(transformations[VIEW_PROJECTION], 1, GL_FALSE, glm::value_ptr(mvp));
-    glUniformMatrix4fv(transformations[MODEL], 1, GL_FALSE, glm::value_ptr(model));
-}
-
 void Shader::Bind()
 {
 	glUseProgram(program);
@@ -105,6 +96,21 @@ std::string Shader::LoadShader(const std::string& fileName)
         while(file.good())
         {
             getline(file, line);
+
+            // #include "file": GLSL has none, the file (relative to this one) is pasted in place
+            if(line.compare(0, 9, "#include ") == 0)
+            {
+                size_t first = line.find('"');
+                size_t last = line.rfind('"');
+
+                if(first != std::string::npos && last > first)
+                {
+                    std::string dir = fileName.substr(0, fileName.rfind('/') + 1);
+                    output.append(LoadShader(dir + line.substr(first + 1, last - first - 1)));
+                    continue;
+                }
+            }
+
 			output.append(line + "\n");
         }
     }
@@ -21,8 +21,7 @@ class Shader
 
 		void Bind();
 
-		// apply the MVP "transform" matrix to the vertices in our vertex shader
-		void Update(glm::mat4 model, std::shared_ptr<Camera> camera);
+		// the matrices are in the FrameData / ObjectData uniform blocks (FrameUniforms)
 
 	private:
 		static const unsigned int NUM_SHADERS = 2;
@@ -33,16 +32,6 @@ class Shader
 
 		GLuint program;
 		GLuint shaders[NUM_SHADERS];
-
-		// our transformations
-		enum
-		{
-			VIEW_PROJECTION,
-			MODEL,
-			NB_TRANSFORMATION
-		};
-
-		GLuint transformations[NB_TRANSFORMATION];
 };
 
 #endif
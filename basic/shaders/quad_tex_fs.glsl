@@ -0,0 +1,13 @@
+#version 330 core
+
+precision mediump float;
+in vec2 uv;
+out vec4          FragColor;
+
+// streamed image (TextureStream), unit 0
+uniform sampler2D image;
+
+void main()
+{
+	FragColor = vec4(texture(image, uv).rgb, 1.0);
+}
@@ -1,10 +1,17 @@
 #version 330 core
+#include "frame_data.glsl"
 
 precision mediump float;
 in vec3 position;
+in vec2 tex_coords;
+
+out vec2 uv;
 
 void main()
 {
-    gl_Position = vec4(position.x, position.y, 0.0, 1.0); 
+    gl_Position = object.mvp * vec4(position.x, position.y, 0.0, 1.0); 
+
+    // image rows are stored top to bottom
+    uv = vec2(tex_coords.x, 1.0 - tex_coords.y);
 }
 
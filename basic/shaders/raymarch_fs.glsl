@@ -0,0 +1,83 @@
+#version 330 core
+#include "shadertoy.glsl"
+
+// sphere traced spheres over a plane, soft shadows and ambient occlusion: a deliberately heavy example
+
+float Scene(vec3 p)
+{
+	float d = p.y + 1.0;
+
+	for(int i = 0; i < 8; i++) {
+		float a = float(i) * 0.785 + iTime * 0.3;
+		vec3 c = vec3(2.5 * cos(a), 0.2 * sin(iTime + float(i)), 2.5 * sin(a) + 6.0);
+		d = min(d, length(p - c) - 0.6);
+	}
+
+	return min(d, length(p - vec3(0.0, 0.0, 6.0)) - 1.0);
+}
+
+vec3 Normal(vec3 p)
+{
+	vec2 e = vec2(0.001, 0.0);
+	return normalize(vec3(Scene(p + e.xyy) - Scene(p - e.xyy), Scene(p + e.yxy) - Scene(p - e.yxy), Scene(p + e.yyx) - Scene(p - e.yyx)));
+}
+
+float SoftShadow(vec3 p, vec3 l)
+{
+	float s = 1.0;
+	float t = 0.02;
+
+	for(int i = 0; i < 128; i++) {
+		float h = Scene(p + l * t);
+		s = min(s, 16.0 * h / t);
+		t += clamp(h, 0.01, 0.5);
+
+		if(s < 0.001 || t > 20.0)
+			break;
+	}
+
+	return clamp(s, 0.0, 1.0);
+}
+
+float Occlusion(vec3 p, vec3 n)
+{
+	float o = 0.0;
+
+	for(int i = 1; i <= 16; i++) {
+		float d = 0.05 * float(i);
+		o += (d - Scene(p + n * d)) / pow(2.0, float(i) * 0.5);
+	}
+
+	return clamp(1.0 - 4.0 * o, 0.0, 1.0);
+}
+
+void mainImage(out vec4 fragColor, in vec2 fragCoord)
+{
+	vec2 uv = (2.0 * fragCoord - iResolution.xy) / iResolution.y;
+	vec3 ro = vec3(0.0, 1.0, 0.0);
+	vec3 rd = normalize(vec3(uv, 1.5) - vec3(0.0, 0.25, 0.0));
+
+	float t = 0.0;
+	vec3 col = vec3(0.6, 0.7, 0.9) - rd.y * 0.3;
+
+	for(int i = 0; i < 256; i++) {
+		float d = Scene(ro + rd * t);
+
+		if(d < 0.0005 * t) {
+			vec3 p = ro + rd * t;
+			vec3 n = Normal(p);
+			vec3 l = normalize(vec3(0.6, 0.8, -0.4));
+
+			float diffuse = max(dot(n, l), 0.0) * SoftShadow(p + n * 0.01, l);
+			col = vec3(0.9, 0.8, 0.7) * (0.15 + 0.85 * diffuse) * Occlusion(p, n);
+			break;
+		}
+
+		t += d;
+
+		if(t > 40.0)
+			break;
+	}
+
+	fragColor = vec4(pow(col, vec3(0.4545)), 1.0);
+}
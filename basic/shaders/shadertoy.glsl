@@ -0,0 +1,16 @@
+// shadertoy style prelude (TiledRender): #include "shadertoy.glsl" then define mainImage()
+
+#include "frame_data.glsl"
+
+#define iResolution vec3(frame.viewport.xy, 1.0)
+#define iTime object.params.x
+#define iFrame int(object.params.y)
+
+out vec4 FragColor;
+
+void mainImage(out vec4 fragColor, in vec2 fragCoord);
+
+void main()
+{
+	mainImage(FragColor, gl_FragCoord.xy);
+}
@@ -0,0 +1,611 @@
+#include "texture_stream.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// frames before a failed image is loaded again
+static const unsigned long FAILED_RETRY_FRAMES = 120;
+
+/*---------------------------------------------------------------------------*/
+
+// next header token of a PPM / PGM file (skips the whitespaces and the # comments)
+static bool ReadToken(std::ifstream& file, std::string& token)
+{
+	token.clear();
+
+	int c = file.get();
+
+	while(c != EOF && (isspace(c) || c == '#')) {
+		if(c == '#') {
+			while(c != EOF && c != '\n')
+				c = file.get();
+		}
+
+		c = file.get();
+	}
+
+	while(c != EOF && !isspace(c)) {
+		token.push_back(c);
+		c = file.get();
+	}
+
+	// the single whitespace after the token is consumed (the one before the pixels for maxval)
+	return !token.empty();
+}
+
+/*---------------------------------------------------------------------------*/
+
+// P6 (rgb) or P5 (gray), 8 bits: the file is left at the pixels
+static bool DecodePPMHeader(std::ifstream& file, DecodedImage& image)
+{
+	std::string magic, width, height, maxval;
+
+	if(!ReadToken(file, magic) || !ReadToken(file, width) || !ReadToken(file, height) || !ReadToken(file, maxval))
+		return false;
+
+	if((magic != "P6" && magic != "P5") || atoi(maxval.c_str()) != 255)
+		return false;
+
+	image.width = atoi(width.c_str());
+	image.height = atoi(height.c_str());
+	image.channels = magic == "P6" ? 3 : 1;
+
+	return image.width > 0 && image.height > 0;
+}
+
+/*---------------------------------------------------------------------------*/
+
+// "<name>_<width>x<height>x<channels>.raw", the pixels only
+static bool DecodeRawHeader(const std::string& path, DecodedImage& image)
+{
+	size_t underscore = path.rfind('_');
+
+	if(underscore == std::string::npos)
+		return false;
+
+	if(sscanf(path.c_str() + underscore, "_%dx%dx%d.raw", &image.width, &image.height, &image.channels) != 3)
+		return false;
+
+	return image.width > 0 && image.height > 0 && (image.channels == 1 || image.channels == 3 || image.channels == 4);
+}
+
+/*---------------------------------------------------------------------------*/
+
+// size of the image, the file left at its pixels
+static bool DecodeHeader(std::ifstream& file, DecodedImage& image)
+{
+	if(!file.is_open())
+		return false;
+
+	const std::string& path = image.path;
+
+	if(path.size() > 4 && path.compare(path.size() - 4, 4, ".raw") == 0)
+		return DecodeRawHeader(path, image);
+
+	return DecodePPMHeader(file, image);
+}
+
+static size_t ImageBytes(const DecodedImage& image)
+{
+	return (size_t)image.width * image.height * image.channels;
+}
+
+/*---------------------------------------------------------------------------*/
+
+TextureStream::TextureStream(size_t memory_budget, unsigned int nb_pbos, unsigned int nb_threads)
+{
+	this->memory_budget = memory_budget;
+	this->resident_bytes = 0;
+	this->hits = 0;
+	this->misses = 0;
+	this->uploads = 0;
+	this->evictions = 0;
+	this->failures = 0;
+	this->stalls = 0;
+	this->frame = 0;
+	this->over_budget_reported = false;
+	this->slot_request = 0;
+	this->slot_waiters = 0;
+	this->stop = false;
+
+	// sized (and mapped) by Update() when a decode thread asks for a slot
+	pbos.resize(std::max(nb_pbos, 1u));
+
+	for(auto& pbo : pbos) {
+		glGenBuffers(1, &pbo.buffer);
+		pbo.size = 0;
+		pbo.fence = 0;
+		pbo.mapped = nullptr;
+		pbo.state = SLOT_GL;
+	}
+
+	for(unsigned int i = 0; i < std::max(nb_threads, 1u); i++)
+		threads.emplace_back(&TextureStream::Loop, this);
+}
+
+/*---------------------------------------------------------------------------*/
+
+TextureStream::~TextureStream()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stop = true;
+	}
+
+	cv.notify_all();
+
+	for(auto& thread : threads)
+		thread.join();
+
+	for(auto& pbo : pbos) {
+		if(pbo.mapped) {
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo.buffer);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		}
+
+		if(pbo.fence)
+			glDeleteSync(pbo.fence);
+
+		glDeleteBuffers(1, &pbo.buffer);
+	}
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	for(auto& e : entries) {
+		if(e.second.texture)
+			glDeleteTextures(1, &e.second.texture);
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+
+void TextureStream::Queue(const std::string& path, bool first)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if(first)
+			requests.push_front(path);
+		else
+			requests.push_back(path);
+	}
+
+	cv.notify_one();
+}
+
+// a prefetched path requested: first in line (not there: a decode thread has it already)
+void TextureStream::Promote(const std::string& path)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto it = std::find(requests.begin(), requests.end(), path);
+
+	if(it != requests.end() && it != requests.begin()) {
+		requests.erase(it);
+		requests.push_front(path);
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+
+int TextureStream::AcquireSlot(size_t bytes)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	// never resident anyway, and no slot of that size
+	if(bytes > memory_budget)
+		return -1;
+
+	int slot = -1;
+
+	slot_waiters++;
+
+	cv.wait(lock, [&]()
+	{
+		if(stop)
+			return true;
+
+		for(unsigned int i = 0; i < pbos.size(); i++) {
+			if(pbos[i].state == SLOT_FREE && pbos[i].size >= bytes) {
+				slot = i;
+				return true;
+			}
+		}
+
+		// grown by the render thread (GL calls), which notifies
+		slot_request = std::max(slot_request, bytes);
+
+		return false;
+	});
+
+	slot_waiters--;
+
+	if(slot >= 0)
+		pbos[slot].state = SLOT_DECODING;
+
+	return slot;
+}
+
+/*---------------------------------------------------------------------------*/
+
+void TextureStream::Loop()
+{
+	while(true) {
+		DecodedImage image;
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+
+			cv.wait(lock, [this]() { return stop || !requests.empty(); });
+
+			if(stop)
+				return;
+
+			image.path = requests.front();
+			requests.pop_front();
+		}
+
+		std::ifstream file(image.path.c_str(), std::ios::binary);
+
+		image.slot = -1;
+		image.ok = DecodeHeader(file, image);
+
+		if(image.ok)
+			image.slot = AcquireSlot(ImageBytes(image));
+
+		// straight into the mapped PBO: the render thread only unmaps it (the slot is ours, no lock)
+		if(image.slot >= 0) {
+			size_t bytes = ImageBytes(image);
+
+			file.read((char*)pbos[image.slot].mapped, bytes);
+			image.ok = (size_t)file.gcount() == bytes;
+		}
+		else {
+			image.ok = false;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			if(image.slot >= 0)
+				pbos[image.slot].state = SLOT_READY;
+
+			ready.push_back(std::move(image));
+		}
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+
+GLuint TextureStream::Request(const std::string& path)
+{
+	auto it = entries.find(path);
+
+	// failed: loaded again once FAILED_RETRY_FRAMES went by
+	if(it != entries.end() && it->second.state == STATE_FAILED && frame - it->second.last_frame >= FAILED_RETRY_FRAMES) {
+		entries.erase(it);
+		it = entries.end();
+	}
+
+	if(it != entries.end()) {
+		Entry& entry = it->second;
+
+		// reported by Failed(), last_frame keeps the failure time
+		if(entry.state == STATE_FAILED)
+			return 0;
+
+		// still loading: it will enter the cache as recently used
+		if(entry.state == STATE_LOADING) {
+			entry.last_frame = frame;
+
+			// prefetched: not behind the other prefetches anymore
+			if(!entry.requested) {
+				entry.requested = true;
+				Promote(path);
+			}
+
+			return 0;
+		}
+
+		hits++;
+		entry.last_frame = frame;
+		lru.splice(lru.begin(), lru, entry.lru_it);
+
+		return entry.texture;
+	}
+
+	misses++;
+
+	Entry entry = {};
+	entry.state = STATE_LOADING;
+	entry.last_frame = frame;
+	entry.requested = true;
+	entries[path] = entry;
+
+	Queue(path, true);
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+
+void TextureStream::Prefetch(const std::string& path)
+{
+	auto it = entries.find(path);
+
+	if(it != entries.end()) {
+		if(it->second.state != STATE_FAILED || frame - it->second.last_frame < FAILED_RETRY_FRAMES)
+			return;
+
+		entries.erase(it);
+	}
+
+	Entry entry = {};
+	entry.state = STATE_LOADING;
+	entry.last_frame = frame - 1;
+	entry.requested = false;
+	entries[path] = entry;
+
+	Queue(path, false);
+}
+
+bool TextureStream::Failed(const std::string& path) const
+{
+	auto it = entries.find(path);
+
+	return it != entries.end() && it->second.state == STATE_FAILED;
+}
+
+/*---------------------------------------------------------------------------*/
+
+void TextureStream::RecycleSlots()
+{
+	// a decode thread waits: no free slot, or none large enough
+	if(slot_waiters)
+		stalls++;
+
+	for(auto& p : pbos) {
+		if(p.state != SLOT_GL || !p.fence)
+			continue;
+
+		// no wait: a busy slot is simply skipped
+		GLenum status = glClientWaitSync(p.fence, 0, 0);
+
+		if(status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+			glDeleteSync(p.fence);
+			p.fence = 0;
+		}
+	}
+
+	// too small for a waiting image: an idle slot is grown (the smallest one, the others keep their size)
+	if(slot_request) {
+		Pbo* grow = nullptr;
+		bool fits = false;
+
+		for(auto& p : pbos) {
+			bool idle = p.state == SLOT_FREE || (p.state == SLOT_GL && !p.fence);
+
+			fits = fits || (p.state == SLOT_FREE && p.size >= slot_request);
+
+			if(idle && p.size < slot_request && (!grow || p.size < grow->size))
+				grow = &p;
+		}
+
+		if(!fits && grow) {
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, grow->buffer);
+
+			if(grow->mapped)
+				glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+			glBufferData(GL_PIXEL_UNPACK_BUFFER, slot_request, NULL, GL_STREAM_DRAW);
+
+			grow->size = slot_request;
+			grow->mapped = nullptr;
+			grow->state = SLOT_GL;
+		}
+
+		// asked again by the waiting threads if still needed
+		if(fits || grow)
+			slot_request = 0;
+	}
+
+	// the GPU is done with them: mapped again for the decode threads
+	for(auto& p : pbos) {
+		if(p.state != SLOT_GL || p.fence || !p.size)
+			continue;
+
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, p.buffer);
+
+		// the fence signaled, nothing reads the previous content anymore
+		p.mapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, p.size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+
+		// not mapped: tried again next frame
+		if(p.mapped)
+			p.state = SLOT_FREE;
+	}
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+/*---------------------------------------------------------------------------*/
+
+GLuint TextureStream::AcquireTexture(int width, int height, GLenum internal_format, GLenum format, size_t bytes)
+{
+	// evict the least recently used images, except the ones used by this frame
+	while(resident_bytes + bytes > memory_budget && !lru.empty()) {
+		auto it = entries.find(lru.back());
+		Entry& entry = it->second;
+
+		if(entry.last_frame == frame) {
+			if(!over_budget_reported) {
+				std::cout << "TextureStream: the images of a single frame exceed the memory budget (" << (memory_budget >> 20) << " MB)" << std::endl;
+				over_budget_reported = true;
+			}
+
+			break;
+		}
+
+		GLuint texture = entry.texture;
+		size_t evicted_bytes = entry.bytes;
+		bool same_size = entry.width == width && entry.height == height && entry.internal_format == internal_format;
+
+		lru.pop_back();
+		entries.erase(it);
+		evictions++;
+
+		// same storage: the texture object is reused as is
+		if(same_size)
+			return texture;
+
+		glDeleteTextures(1, &texture);
+		resident_bytes -= evicted_bytes;
+	}
+
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+
+	// storage only, the pixels come from the PBO
+	glTexImage2D(GL_TEXTURE_2D, 0, internal_format, width, height, 0, format, GL_UNSIGNED_BYTE, NULL);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	// gray images are sampled as gray, not red
+	if(internal_format == GL_R8) {
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_RED);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_RED);
+	}
+
+	resident_bytes += bytes;
+
+	return texture;
+}
+
+/*---------------------------------------------------------------------------*/
+
+void TextureStream::Upload(const DecodedImage& image)
+{
+	auto it = entries.find(image.path);
+
+	// requested twice while loading (the first one won), or failed
+	bool wanted = it != entries.end() && it->second.state == STATE_LOADING;
+	bool unmapped = false;
+
+	if(wanted && image.ok) {
+		Pbo& p = pbos[image.slot];
+
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, p.buffer);
+
+		// decoded in place: the pixels are handed to the GL as they are
+		unmapped = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+		p.mapped = nullptr;
+
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+		// the mapping was lost (the content is undefined): decoded again
+		if(!unmapped)
+			Queue(image.path, true);
+	}
+	else if(wanted) {
+		std::cout << "TextureStream: unable to decode " << image.path << std::endl;
+
+		it->second.state = STATE_FAILED;
+		it->second.last_frame = frame;
+		failures++;
+	}
+
+	if(unmapped) {
+		GLenum internal_format = image.channels == 1 ? GL_R8 : (image.channels == 3 ? GL_RGB8 : GL_RGBA8);
+		GLenum format = image.channels == 1 ? GL_RED : (image.channels == 3 ? GL_RGB : GL_RGBA);
+		size_t bytes = ImageBytes(image);
+
+		// storage first, with no PBO bound (a NULL glTexImage2D would read the PBO)
+		GLuint texture = AcquireTexture(image.width, image.height, internal_format, format, bytes);
+
+		// AcquireTexture() may have evicted entries, not this one (not resident yet)
+		Entry& entry = entries[image.path];
+
+		Pbo& p = pbos[image.slot];
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, p.buffer);
+
+		// rows are tightly packed (rgb rows are not 4 bytes aligned)
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+		// sourced from the bound PBO: returns immediately, the copy runs on the GPU timeline
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image.width, image.height, format, GL_UNSIGNED_BYTE, (void*)0);
+
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+		// the slot is mapped again once this signals (RecycleSlots())
+		p.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+		entry.state = STATE_RESIDENT;
+		entry.texture = texture;
+		entry.bytes = bytes;
+		entry.width = image.width;
+		entry.height = image.height;
+		entry.internal_format = internal_format;
+
+		// prefetched images too: they are about to be used
+		lru.push_front(image.path);
+		entry.lru_it = lru.begin();
+
+		uploads++;
+	}
+
+	// nothing read it: still mapped, straight back to the decode threads
+	if(image.slot >= 0 && !unmapped && pbos[image.slot].mapped) {
+		std::lock_guard<std::mutex> lock(mutex);
+		pbos[image.slot].state = SLOT_FREE;
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+
+void TextureStream::Update(size_t max_upload_bytes)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		RecycleSlots();
+	}
+
+	// a slot may be free or larger now
+	cv.notify_all();
+
+	size_t uploaded = 0;
+
+	while(uploaded < max_upload_bytes) {
+		DecodedImage image;
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			if(ready.empty())
+				break;
+
+			image = std::move(ready.front());
+			ready.pop_front();
+
+			// the render thread's until uploaded (or handed back)
+			if(image.slot >= 0)
+				pbos[image.slot].state = SLOT_GL;
+		}
+
+		if(image.ok)
+			uploaded += ImageBytes(image);
+
+		Upload(image);
+	}
+
+	cv.notify_all();
+
+	frame++;
+}
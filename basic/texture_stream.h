@@ -0,0 +1,168 @@
+#ifndef __TEXTURE_STREAM_H_
+#define __TEXTURE_STREAM_H_
+
+#include <GL/glew.h>
+
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/*---------------------------------------------------------------------------*/
+
+// decoded image waiting for its upload, the pixels are in its PBO slot (rows top to bottom, tightly packed)
+struct DecodedImage
+{
+	std::string path;
+
+	// -1: rejected before the pixels (no slot taken)
+	int slot;
+
+	int width;
+	int height;
+	int channels;
+
+	bool ok;
+};
+
+/*---------------------------------------------------------------------------*/
+
+/*
+	Asynchronous texture loading: nothing on the render thread blocks on a file, a decode
+	or a transfer, and no pixel is copied on it.
+
+	1. Request() / Prefetch() queue the path for the decode threads (PPM P5 / P6, raw).
+	   A decode thread reads the header, takes a free slot of the PBO ring (kept mapped
+	   while free) and reads the pixels straight into the mapping.
+	2. Update(), on the render thread once per frame: each decoded slot is unmapped and
+	   glTexSubImage2D is sourced from it (the transfer runs in the background), a fence
+	   marks the slot busy until the GPU consumed it, then it is mapped again for the
+	   decode threads. A slot too small for a waiting image is grown there (GL thread).
+	3. The resident textures are kept in an LRU cache bounded by memory_budget, the texture
+	   of an evicted image is reused as is for a new image of the same size (no
+	   reallocation when paging through video frames).
+
+	Request() of a prefetched image moves it first in line. A failed load is reported by
+	Failed() and tried again FAILED_RETRY_FRAMES later (the file may show up meanwhile).
+
+	Raw files carry their size in the name: "<name>_<width>x<height>x<channels>.raw".
+*/
+
+class TextureStream
+{
+	public:
+		TextureStream(size_t memory_budget = 256 << 20, unsigned int nb_pbos = 4, unsigned int nb_threads = 2);
+		virtual ~TextureStream();
+
+		// texture of the image if resident (0 otherwise, the load is queued first in line)
+		GLuint Request(const std::string& path);
+
+		// queued after the requests, not protected from eviction in the current frame
+		void Prefetch(const std::string& path);
+
+		// the last load of the image failed (Request() returns 0 until the retry)
+		bool Failed(const std::string& path) const;
+
+		// render thread: retire the PBOs, upload the decoded images (up to max_upload_bytes)
+		void Update(size_t max_upload_bytes = 32 << 20);
+
+	public:
+		// cache / transfer counters (since the start)
+		unsigned long hits;
+		unsigned long misses;
+		unsigned long uploads;
+		unsigned long evictions;
+		unsigned long failures;
+		unsigned long stalls; // frames where a decode thread waited for a free (or large enough) PBO slot
+
+		size_t resident_bytes;
+		size_t memory_budget;
+
+	private:
+		enum State
+		{
+			STATE_LOADING,
+			STATE_RESIDENT,
+			STATE_FAILED
+		};
+
+		struct Entry
+		{
+			State state;
+			GLuint texture;
+			size_t bytes;
+			unsigned long last_frame;
+
+			int width;
+			int height;
+			GLenum internal_format;
+
+			// queued first (Request()), not behind the prefetches
+			bool requested;
+
+			// position in lru (resident only)
+			std::list<std::string>::iterator lru_it;
+		};
+
+		enum SlotState
+		{
+			SLOT_FREE,     // mapped, a decode thread can take it
+			SLOT_DECODING, // a decode thread writes the pixels
+			SLOT_READY,    // decoded, waiting for Update()
+			SLOT_GL        // render thread: unmapped (upload in flight until the fence), or to be (re)sized
+		};
+
+		struct Pbo
+		{
+			GLuint buffer;
+			size_t size;
+			GLsync fence;
+
+			// write mapping of the whole buffer, nullptr while the GL owns it
+			unsigned char* mapped;
+			SlotState state;
+		};
+
+		void Queue(const std::string& path, bool first);
+		void Promote(const std::string& path);
+		void Loop();
+
+		// decode thread: a free slot of at least bytes (waits for it), -1 when stopping or too large
+		int AcquireSlot(size_t bytes);
+
+		// render thread, mutex held: retired slots mapped again, one grown for a waiting image
+		void RecycleSlots();
+
+		// texture for the image: evicts to stay under the budget, recycled or allocated
+		GLuint AcquireTexture(int width, int height, GLenum internal_format, GLenum format, size_t bytes);
+
+		void Upload(const DecodedImage& image);
+
+		std::unordered_map<std::string, Entry> entries;
+
+		// most recently used first
+		std::list<std::string> lru;
+
+		std::vector<Pbo> pbos;
+		unsigned long frame;
+		bool over_budget_reported;
+
+		// decode threads
+		std::vector<std::thread> threads;
+		std::mutex mutex;
+		std::condition_variable cv;
+		std::deque<std::string> requests;
+		std::deque<DecodedImage> ready;
+
+		// largest image a decode thread waits a slot for (0: none), and how many wait
+		size_t slot_request;
+		unsigned int slot_waiters;
+		bool stop;
+};
+
+#endif
@@ -0,0 +1,205 @@
+#include "tiled_render.h"
+
+#include <algorithm>
+#include <iostream>
+
+// tile size bounds (pixels)
+static const int MIN_TILE_SIZE = 16;
+static const int MAX_TILE_SIZE = 1024;
+
+/*---------------------------------------------------------------------------*/
+
+TiledRender::TiledRender(int width, int height, const std::string& fragment_shader, float budget_ms, int tile_size)
+{
+	this->width = width;
+	this->height = height;
+	this->budget_ms = budget_ms;
+	this->tile_size = tile_size;
+	this->tile_ms = 0.0f;
+	this->tiles_per_frame = 1;
+	this->passes = 0;
+	this->tiles_x = 0;
+	this->tiles_y = 0;
+	this->next_tile = 0;
+	this->pass_time = 0.0f;
+	this->query_next = 0;
+
+	shader = std::make_shared<Shader>("../shaders/fullscreen_vs.glsl", fragment_shader);
+
+	// the image stays on the screen between passes: color only, no depth
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cout << "ERROR::FRAMEBUFFER:: Tiled render framebuffer is not complete!" << std::endl;
+
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	// full screen quad (NDC)
+	float quad[] = {
+		-1.0f,  1.0f,
+		-1.0f, -1.0f,
+		 1.0f, -1.0f,
+
+		-1.0f,  1.0f,
+		 1.0f, -1.0f,
+		 1.0f,  1.0f
+	};
+
+	glGenVertexArrays(1, &quad_vao);
+	glGenBuffers(1, &quad_vbo);
+	glBindVertexArray(quad_vao);
+	glBindBuffer(GL_ARRAY_BUFFER, quad_vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(quad), &quad, GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+	glBindVertexArray(0);
+
+	glGenQueries(NB_QUERIES, queries);
+
+	for(unsigned int i = 0; i < NB_QUERIES; i++)
+		query_tiles[i] = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+
+TiledRender::~TiledRender()
+{
+	glDeleteQueries(NB_QUERIES, queries);
+
+	glDeleteVertexArrays(1, &quad_vao);
+	glDeleteBuffers(1, &quad_vbo);
+
+	glDeleteFramebuffers(1, &framebuffer);
+	glDeleteTextures(1, &texture);
+}
+
+/*---------------------------------------------------------------------------*/
+
+void TiledRender::ReadQueries()
+{
+	for(unsigned int i = 0; i < NB_QUERIES; i++) {
+		if(!query_tiles[i])
+			continue;
+
+		GLuint available = 0;
+		glGetQueryObjectuiv(queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+
+		if(!available)
+			continue;
+
+		GLuint64 ns = 0;
+		glGetQueryObjectui64v(queries[i], GL_QUERY_RESULT, &ns);
+
+		float ms = ns / 1e6f / query_tiles[i];
+
+		// smoothed, the first measure is taken as is
+		tile_ms = tile_ms > 0.0f ? 0.7f * tile_ms + 0.3f * ms : ms;
+		query_tiles[i] = 0;
+	}
+
+	if(tile_ms > 0.0f)
+		tiles_per_frame = std::max(1, (int)(budget_ms / tile_ms));
+}
+
+/*---------------------------------------------------------------------------*/
+
+void TiledRender::Update(FrameUniforms& uniforms, float time)
+{
+	ReadQueries();
+
+	// a single tile far over the budget: start over with smaller tiles without waiting for the end of the pass
+	if(next_tile != 0 && tile_ms > 2.0f * budget_ms && tile_size > MIN_TILE_SIZE)
+		next_tile = 0;
+
+	// new pass: the tile size may change between passes only (the grid stays consistent)
+	if(next_tile == 0) {
+		if(tile_ms > budget_ms && tile_size > MIN_TILE_SIZE) {
+			tile_size /= 2;
+			tile_ms /= 4.0f;
+		}
+		else if(tile_ms > 0.0f && tile_ms * 4.0f < budget_ms / 8.0f && tile_size < MAX_TILE_SIZE) {
+			tile_size *= 2;
+			tile_ms *= 4.0f;
+		}
+
+		tiles_x = (width + tile_size - 1) / tile_size;
+		tiles_y = (height + tile_size - 1) / tile_size;
+		pass_time = time;
+	}
+
+	// same time for every tile of the pass (params.x, see shadertoy.glsl)
+	ObjectData pass_data = { glm::mat4(1.0f), glm::mat4(1.0f), glm::vec4(pass_time, (float)passes, 0.0f, 0.0f) };
+	uniforms.BindObject(uniforms.Push(pass_data));
+
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glViewport(0, 0, width, height);
+	glEnable(GL_SCISSOR_TEST);
+	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+
+	shader -> Bind();
+	glBindVertexArray(quad_vao);
+
+	// a query still in flight is not reused: these tiles are just not measured
+	bool measure = query_tiles[query_next] == 0;
+	int nb_tiles = tiles_x * tiles_y;
+	int count = std::min(tiles_per_frame, nb_tiles - next_tile);
+
+	if(measure)
+		glBeginQuery(GL_TIME_ELAPSED, queries[query_next]);
+
+	for(int i = 0; i < count; i++) {
+		int tile = next_tile + i;
+		int x = (tile % tiles_x) * tile_size;
+		int y = (tile / tiles_x) * tile_size;
+
+		glScissor(x, y, std::min(tile_size, width - x), std::min(tile_size, height - y));
+		glDrawArrays(GL_TRIANGLES, 0, 6);
+	}
+
+	if(measure) {
+		glEndQuery(GL_TIME_ELAPSED);
+
+		query_tiles[query_next] = count;
+		query_next = (query_next + 1) % NB_QUERIES;
+	}
+
+	next_tile += count;
+
+	if(next_tile >= nb_tiles) {
+		next_tile = 0;
+		passes++;
+	}
+
+	glBindVertexArray(0);
+	glDisable(GL_SCISSOR_TEST);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+/*---------------------------------------------------------------------------*/
+
+void TiledRender::Present()
+{
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+/*---------------------------------------------------------------------------*/
+
+float TiledRender::Progress() const
+{
+	int nb_tiles = tiles_x * tiles_y;
+
+	return nb_tiles ? (float)next_tile / nb_tiles : 0.0f;
+}
@@ -0,0 +1,83 @@
+#ifndef __TILED_RENDER_H_
+#define __TILED_RENDER_H_
+
+#include <GL/glew.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "shader.h"
+#include "frame_uniforms.h"
+
+/*---------------------------------------------------------------------------*/
+
+/*
+	Full screen fragment shader (shadertoy style, see shaders/shadertoy.glsl) rendered in
+	scissored tiles into an offscreen target, a GPU time budget of tiles per frame: a
+	heavy shader never holds the GPU for a whole frame (driver watchdog, frozen input).
+
+	Every frame Update() renders the next tiles of the current pass and Present() copies
+	the partially updated image to the screen. A pass renders every tile with the same
+	time (the one at its start), the passes follow each other.
+
+	The GPU time of each frame's tiles is measured with GL_TIME_ELAPSED queries (read
+	when available, never waited for): tiles_per_frame follows budget_ms / tile_ms, and
+	between two passes a tile that alone exceeds the budget is split in four (or four
+	cheap tiles are merged).
+*/
+
+class TiledRender
+{
+	public:
+		TiledRender(int width, int height, const std::string& fragment_shader, float budget_ms = 8.0f, int tile_size = 128);
+		virtual ~TiledRender();
+
+		// next tiles of the pass (time: shader time if a new pass starts)
+		void Update(FrameUniforms& uniforms, float time);
+
+		// offscreen image -> default framebuffer
+		void Present();
+
+		// done tiles / tiles of the current pass
+		float Progress() const;
+
+	public:
+		float budget_ms;
+
+		// measured (smoothed) GPU time of one tile, adapted number of tiles per frame
+		float tile_ms;
+		int tiles_per_frame;
+		int tile_size;
+
+		// complete images
+		unsigned int passes;
+
+	private:
+		void ReadQueries();
+
+		int width;
+		int height;
+
+		std::shared_ptr<Shader> shader;
+
+		GLuint framebuffer;
+		GLuint texture;
+		GLuint quad_vao;
+		GLuint quad_vbo;
+
+		// current pass
+		int tiles_x;
+		int tiles_y;
+		int next_tile;
+		float pass_time;
+
+		// time queries in flight (tiles rendered inside each one)
+		static const unsigned int NB_QUERIES = 4;
+
+		GLuint queries[NB_QUERIES];
+		int query_tiles[NB_QUERIES];
+		unsigned int query_next;
+};
+
+#endif
@@ -0,0 +1,218 @@
+#include "alloc_count.h"
+#include "depth_sort.h"
+#include "frame_arena.h"
+#include "ingest.h"
+#include "point_buffer.h"
+
+#include <GLFW/glfw3.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <glm/gtx/transform.hpp>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+/*
+	Steady state heap allocation check (built with the counting operator new, see alloc_count.h)
+
+	./glfw_shader_alloc [frames]     (default 400, xvfb-run without a display)
+
+	Runs the per-frame CPU paths of the viewer on a hidden GL context: shared memory ingest
+	drained into a PointBuffer capped like --ingest-shm, live points pushed into its ring,
+	an in place edit, Upload(), then a full and a coherent depth sort under an orbiting
+	camera. Every frame after the warm-up must not touch the heap: the exit code is 1
+	when one did.
+*/
+
+// --------------------------------------------------------------------------------------------
+
+static const unsigned int MAX_POINTS = 100000;
+static const unsigned int BATCH_POINTS = 2048;
+static const unsigned int LIVE_POINTS = 500;
+
+// the producer side of the ring (glfw_shader_producer), on this thread: no allocation
+static void Produce(PointRingHeader* ring, const vector<glm::vec3>& points, uint64_t sequence)
+{
+	uint32_t count = points.size();
+
+	uint64_t point_head = ring->point_head.load(std::memory_order_relaxed);
+	uint64_t batch_head = ring->batch_head.load(std::memory_order_relaxed);
+
+	// drained every frame: a full ring is a bug of the consumer
+	if(point_head + count - ring->point_tail.load(std::memory_order_acquire) > ring->point_capacity ||
+		batch_head - ring->batch_tail.load(std::memory_order_acquire) >= ring->batch_capacity) {
+		ring->dropped.fetch_add(count, std::memory_order_relaxed);
+		return;
+	}
+
+	glm::vec3* ring_points = reinterpret_cast<glm::vec3*>(PointRingPoints(ring));
+
+	for(uint32_t i = 0; i < count; i++)
+		ring_points[(point_head + i) % ring->point_capacity] = points[i];
+
+	PointRingBatch& batch = PointRingBatches(ring)[batch_head % ring->batch_capacity];
+	batch.first = point_head;
+	batch.count = count;
+	batch.sequence = sequence;
+	batch.timestamp = PointTimestamp();
+
+	ring->point_head.store(point_head + count, std::memory_order_release);
+	ring->batch_head.store(batch_head + 1, std::memory_order_release);
+}
+
+// set up by PointIngest::MapRing()
+static PointRingHeader* OpenRing(const string& name, size_t& size)
+{
+	int fd = shm_open(name.c_str(), O_RDWR, 0);
+	struct stat st;
+
+	if(fd < 0)
+		return nullptr;
+
+	void* memory = MAP_FAILED;
+
+	if(fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(PointRingHeader)) {
+		size = st.st_size;
+		memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	}
+
+	close(fd);
+
+	return memory == MAP_FAILED ? nullptr : (PointRingHeader*)memory;
+}
+
+// --------------------------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+	int frames = argc > 1 ? atoi(argv[1]) : 400;
+
+	if(!glfwInit()) {
+		cout << "ERROR::ALLOC:: cannot initialize GLFW" << endl;
+		return 2;
+	}
+
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+
+	GLFWwindow* window = glfwCreateWindow(64, 64, "alloc", NULL, NULL);
+
+	if(!window) {
+		cout << "ERROR::ALLOC:: cannot create the GL context" << endl;
+		glfwTerminate();
+		return 2;
+	}
+
+	glfwMakeContextCurrent(window);
+
+	glewExperimental = GL_TRUE;
+
+	if(glewInit() != GLEW_OK) {
+		cout << "ERROR::ALLOC:: cannot initialize GLEW" << endl;
+		glfwTerminate();
+		return 2;
+	}
+
+	int failed = 0;
+
+	{
+		string shm_name = "/glfw_shader_alloc_" + to_string(getpid());
+
+		IngestConfig config;
+		config.backlog = 8 * BATCH_POINTS;
+		config.max_points = MAX_POINTS;
+
+		PointIngest ingest(config);
+
+		if(!ingest.MapRing(shm_name)) {
+			glfwTerminate();
+			return 2;
+		}
+
+		size_t ring_size = 0;
+		PointRingHeader* ring = OpenRing(shm_name, ring_size);
+
+		if(!ring) {
+			cout << "ERROR::ALLOC:: cannot open the shared memory " << shm_name << endl;
+			glfwTerminate();
+			return 2;
+		}
+
+		vector<glm::vec3> batch(BATCH_POINTS);
+		vector<glm::vec3> none;
+		PointBuffer buffer(none);
+
+		DepthSorter full;
+		DepthSorter coherent;
+		coherent.coherent = true;
+
+		for(int f = 0; f < frames; f++) {
+			FrameArena::NextFrame();
+
+			// acquisition: a scan line per frame
+			for(unsigned int i = 0; i < BATCH_POINTS; i++) {
+				float elevation = (float)M_PI * ((float)i / BATCH_POINTS - 0.5f);
+				float azimuth = f * 0.01f;
+
+				batch[i] = glm::vec3(cosf(elevation) * sinf(azimuth), sinf(elevation), cosf(elevation) * cosf(azimuth));
+			}
+
+			Produce(ring, batch, f);
+
+			ingest.Drain(buffer);
+
+			// live points (frame scratch), as the viewer's --live
+			glm::vec3* live = FrameArena::Current().Allocate<glm::vec3>(LIVE_POINTS);
+
+			for(unsigned int i = 0; i < LIVE_POINTS; i++)
+				live[i] = glm::vec3(drand48() - 0.5, drand48() - 0.5, drand48() - 0.5);
+
+			buffer.PushRing(live, LIVE_POINTS, MAX_POINTS);
+
+			// an in place edit
+			if(buffer.Size() > LIVE_POINTS)
+				buffer.UpdateRange(buffer.Size() / 2, live, LIVE_POINTS);
+
+			buffer.Upload();
+
+			float a = glm::radians(0.5f * f);
+			glm::mat4 view = glm::lookAt(glm::vec3(3.0f * sinf(a), 1.0f, 3.0f * cosf(a)), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+			full.FullSort(buffer.points, view);
+			coherent.Sort(buffer.points, view);
+
+			ingest.Presented();
+
+			if(f % 60 == 59)
+				ingest.Period();
+
+			failed += AllocCount::CheckFrame();
+		}
+
+		glFinish();
+
+		munmap(ring, ring_size);
+
+		printf("%u points, %llu ingested, %llu dropped\n", buffer.Size(), (unsigned long long)ingest.stats.points, (unsigned long long)ingest.stats.dropped);
+	}
+
+	AllocCount::Report();
+
+	glfwDestroyWindow(window);
+	glfwTerminate();
+
+	return failed ? 1 : 0;
+}
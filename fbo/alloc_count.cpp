@@ -0,0 +1,133 @@
+#include "alloc_count.h"
+
+#ifdef GLFW_SHADER_ALLOC_COUNT
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+// frames before the check starts (first sort, buffer growth, arena sizing)
+static const uint64_t WARMUP_FRAMES = 120;
+
+// plain integers: no constructor, usable from the first allocation of a thread
+static thread_local uint64_t thread_allocations = 0;
+static thread_local uint64_t thread_bytes = 0;
+
+static void* Allocate(size_t size)
+{
+	thread_allocations++;
+	thread_bytes += size;
+
+	void* p = malloc(size ? size : 1);
+
+	if(!p)
+		throw std::bad_alloc();
+
+	return p;
+}
+
+static void* AllocateAligned(size_t size, size_t alignment)
+{
+	thread_allocations++;
+	thread_bytes += size;
+
+	void* p = nullptr;
+
+	if(posix_memalign(&p, alignment < sizeof(void*) ? sizeof(void*) : alignment, size ? size : 1) != 0)
+		throw std::bad_alloc();
+
+	return p;
+}
+
+/*---------------------------------------------------------------------------*/
+
+void* operator new(size_t size) { return Allocate(size); }
+void* operator new[](size_t size) { return Allocate(size); }
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	try { return Allocate(size); } catch(...) { return nullptr; }
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	try { return Allocate(size); } catch(...) { return nullptr; }
+}
+
+void* operator new(size_t size, std::align_val_t alignment) { return AllocateAligned(size, (size_t)alignment); }
+void* operator new[](size_t size, std::align_val_t alignment) { return AllocateAligned(size, (size_t)alignment); }
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { free(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { free(p); }
+
+/*---------------------------------------------------------------------------*/
+
+uint64_t AllocCount::Allocations()
+{
+	return thread_allocations;
+}
+
+uint64_t AllocCount::Bytes()
+{
+	return thread_bytes;
+}
+
+/*---------------------------------------------------------------------------*/
+
+// render thread only
+static uint64_t frames_checked = 0;
+static uint64_t frames_allocating = 0;
+static uint64_t worst_allocations = 0;
+static uint64_t worst_bytes = 0;
+static uint64_t worst_frame = 0;
+static uint64_t last_allocations = 0;
+static uint64_t last_bytes = 0;
+static uint64_t frame = 0;
+
+bool AllocCount::CheckFrame()
+{
+	uint64_t allocations = thread_allocations - last_allocations;
+	uint64_t bytes = thread_bytes - last_bytes;
+
+	last_allocations = thread_allocations;
+	last_bytes = thread_bytes;
+
+	// the first call closes the setup, not a frame
+	if(frame++ <= WARMUP_FRAMES)
+		return false;
+
+	frames_checked++;
+
+	if(allocations == 0)
+		return false;
+
+	// the first ones are printed, the next ones only counted
+	if(frames_allocating++ < 10)
+		printf("AllocCount: frame %llu made %llu heap allocations (%llu bytes)\n", (unsigned long long)frame - 1, (unsigned long long)allocations, (unsigned long long)bytes);
+
+	if(allocations > worst_allocations) {
+		worst_allocations = allocations;
+		worst_bytes = bytes;
+		worst_frame = frame - 1;
+	}
+
+	return true;
+}
+
+void AllocCount::Report()
+{
+	printf("AllocCount: %llu steady state frames, %llu with heap allocations", (unsigned long long)frames_checked, (unsigned long long)frames_allocating);
+
+	if(frames_allocating)
+		printf(" (worst: frame %llu, %llu allocations, %llu bytes)", (unsigned long long)worst_frame, (unsigned long long)worst_allocations, (unsigned long long)worst_bytes);
+
+	printf("\n");
+}
+
+#endif
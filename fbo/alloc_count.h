@@ -0,0 +1,47 @@
+#pragma once
+
+/*---------------------------------------------------------------------------*/
+
+/*
+	Heap allocation counter, built only with -DGLFW_SHADER_ALLOC_COUNT (cmake
+	-DALLOC_COUNT=ON). Otherwise every macro below expands to nothing.
+
+	ALLOC_CHECK_FRAME()    render thread, once per frame: C++ heap allocations (operator
+	                       new) of the thread since the previous call. After a warm-up
+	                       (caches, pools and arenas at their working size), a frame that
+	                       allocates is reported: the steady state frame must not allocate.
+	ALLOC_CHECK_REPORT()   frames checked, frames that allocated, the worst one
+
+	glfw_shader_alloc (alloc_check.cpp) runs the per-frame paths (ingest drain, PointBuffer
+	edits and uploads, depth sorts) under the counter and fails on an allocating frame.
+
+	The global operator new / delete are replaced to count per thread. Allocations of
+	the GL driver and of the windowing system (malloc) are not seen.
+*/
+
+#ifdef GLFW_SHADER_ALLOC_COUNT
+
+#include <cstddef>
+#include <cstdint>
+
+class AllocCount
+{
+	public:
+		// calling thread, since its start
+		static uint64_t Allocations();
+		static uint64_t Bytes();
+
+		// true: a steady state frame (past the warm-up) allocated
+		static bool CheckFrame();
+		static void Report();
+};
+
+#define ALLOC_CHECK_FRAME() AllocCount::CheckFrame()
+#define ALLOC_CHECK_REPORT() AllocCount::Report()
+
+#else
+
+#define ALLOC_CHECK_FRAME() do {} while(0)
+#define ALLOC_CHECK_REPORT() do {} while(0)
+
+#endif
@@ -0,0 +1,270 @@
+#include "morton.h"
+#include "depth_sort.h"
+#include "frame_arena.h"
+#include "soft_raster.h"
+#include "vertex_format.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <glm/gtx/transform.hpp>
+
+using namespace std;
+
+/*
+	CPU micro benchmarks (no GL context needed)
+
+	./glfw_shader_bench            run everything
+	./glfw_shader_bench morton     run one benchmark (morton, depthsort, softraster, vertexlayout)
+*/
+
+// --------------------------------------------------------------------------------------------
+
+static float xrand(float xl, float xh)
+{
+	return (xl + (xh - xl) *  drand48() );
+}
+
+static vector<glm::vec3> RandomCloud(size_t n)
+{
+	vector<glm::vec3> points(n);
+
+	for(auto& p : points) {
+		p = glm::vec3(xrand(-1.0, 1.0), xrand(-1.0, 1.0), xrand(-1.0, 1.0));
+	}
+
+	return points;
+}
+
+// best of `runs` wall clock times of fn (setup is not timed), in seconds
+template<typename S, typename F>
+static double BestOf(int runs, S setup, F fn)
+{
+	double best = 1e30;
+
+	for(int r = 0; r < runs; r++) {
+		setup();
+
+		auto t0 = chrono::steady_clock::now();
+		fn();
+		auto t1 = chrono::steady_clock::now();
+
+		best = min(best, chrono::duration<double>(t1 - t0).count());
+	}
+
+	return best;
+}
+
+// --------------------------------------------------------------------------------------------
+
+static void BenchMorton()
+{
+	cout << "--- Morton sort (Mpoints/s, best of 3)" << endl;
+
+	WorkerPool single(1);
+	WorkerPool& all = WorkerPool::Instance();
+
+	printf("%10s %12s %12s %12s %12s\n", "points", "30b 1 thr", "30b all", "63b 1 thr", "63b all");
+
+	for(size_t n : {10000, 100000, 1000000, 4000000, 16000000}) {
+		vector<glm::vec3> cloud = RandomCloud(n);
+		double mpts[4];
+		int i = 0;
+
+		for(bool wide : {false, true}) {
+			for(WorkerPool* pool : {&single, &all}) {
+				MortonOrder morton(wide, *pool);
+
+				vector<glm::vec3> points;
+
+				double t = BestOf(3, [&]() { points = cloud; }, [&]() { morton.Sort(points); });
+
+				mpts[i++] = n / t / 1e6;
+			}
+		}
+
+		printf("%10zu %12.1f %12.1f %12.1f %12.1f\n", n, mpts[0], mpts[1], mpts[2], mpts[3]);
+	}
+
+	cout << "(" << all.Size() << " threads)" << endl;
+}
+
+// --------------------------------------------------------------------------------------------
+
+static void BenchDepthSort()
+{
+	cout << "--- Back to front depth sort, ms per frame (orbiting camera, average of 16 frames)" << endl;
+
+	printf("%10s %12s %12s %12s\n", "points", "deg/frame", "full radix", "coherent");
+
+	for(size_t n : {100000, 1000000, 4000000}) {
+		vector<glm::vec3> cloud = RandomCloud(n);
+
+		MortonOrder morton;
+		morton.Sort(cloud);
+
+		for(float step : {0.01f, 0.1f, 1.0f, 10.0f}) {
+			DepthSorter full;
+			DepthSorter coherent;
+			coherent.coherent = true;
+
+			double t_full = 0.0;
+			double t_coherent = 0.0;
+
+			const int frames = 16;
+
+			// frame -1 primes the coherent sorter
+			for(int f = -1; f < frames; f++) {
+				float a = glm::radians(step * f);
+				glm::mat4 view = glm::lookAt(glm::vec3(5.0f * sinf(a), 1.0f, 5.0f * cosf(a)), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+				// the sorter scratch lives in the frame arena
+				FrameArena::NextFrame();
+
+				auto t0 = chrono::steady_clock::now();
+				full.FullSort(cloud, view);
+				auto t1 = chrono::steady_clock::now();
+				coherent.Sort(cloud, view);
+				auto t2 = chrono::steady_clock::now();
+
+				if(f >= 0) {
+					t_full += chrono::duration<double>(t1 - t0).count();
+					t_coherent += chrono::duration<double>(t2 - t1).count();
+				}
+			}
+
+			printf("%10zu %12.2f %12.2f %12.2f\n", n, step, t_full / frames * 1e3, t_coherent / frames * 1e3);
+		}
+	}
+}
+
+// --------------------------------------------------------------------------------------------
+
+static void BenchSoftRaster()
+{
+	cout << "--- CPU point rasterizer 1280x800 (Mpoints/s, best of 5)" << endl;
+
+	WorkerPool single(1);
+	WorkerPool& all = WorkerPool::Instance();
+
+	printf("%10s %12s %12s %12s %10s\n", "points", "1 thr", "all", "all / core", "visible");
+
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1280.0f / 800.0f, 0.01f, 100.0f);
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 mvp = projection * view;
+
+	for(size_t n : {100000, 1000000, 4000000, 16000000}) {
+		vector<glm::vec3> cloud = RandomCloud(n);
+
+		// spatially coherent buffer, as loaded by the viewer
+		MortonOrder morton;
+		morton.Sort(cloud);
+
+		SoftRasterizer raster_single(1280, 800, single);
+		SoftRasterizer raster_all(1280, 800, all);
+
+		double t_single = BestOf(5, []() {}, [&]() { raster_single.Draw(cloud, mvp); });
+		double t_all = BestOf(5, []() {}, [&]() { raster_all.Draw(cloud, mvp); });
+
+		printf("%10zu %12.1f %12.1f %12.1f %9.0f%%\n", n, n / t_single / 1e6, n / t_all / 1e6, n / t_all / 1e6 / all.Size(), 100.0 * raster_all.visible / n);
+	}
+
+	cout << "(" << all.Size() << " threads)" << endl;
+}
+
+// --------------------------------------------------------------------------------------------
+
+// attribute i of a packed buffer, as the vertex fetch would read it
+template<typename X>
+static typename X::type Fetch(const unsigned char* bytes, VertexLayout layout, size_t n, size_t i)
+{
+	typename X::type value;
+	memcpy(&value, bytes + FullPointFormat::Offset<X>(layout, n) + i * FullPointFormat::Stride<X>(layout), sizeof(value));
+	return value;
+}
+
+static void BenchVertexLayout()
+{
+	cout << "--- FullPointFormat (" << FullPointFormat::stride << " bytes) interleaved vs SoA, Mvertices/s (best of 5)" << endl;
+
+	printf("%10s %12s %12s %12s %12s\n", "points", "all inter", "all SoA", "pos inter", "pos SoA");
+
+	glm::vec3 eye(0.0f, 0.0f, 3.0f);
+
+	for(size_t n : {100000, 1000000, 4000000, 16000000}) {
+		FullPointFormat::Arrays arrays;
+		arrays.Get<Position>() = RandomCloud(n);
+		arrays.Get<Normal>() = RandomCloud(n);
+		arrays.Get<Color>().assign(n, RGBA8{255, 128, 0, 255});
+		arrays.Get<Intensity>().assign(n, 0.5f);
+		arrays.Get<Timestamp>().assign(n, 1.0f);
+
+		double mverts[4];
+		int k = 0;
+
+		// the sums keep the reads alive
+		volatile float sink = 0.0f;
+
+		for(bool position_only : {false, true}) {
+			for(VertexLayout layout : {LAYOUT_INTERLEAVED, LAYOUT_SOA}) {
+				vector<unsigned char> bytes = FullPointFormat::Pack(arrays, layout);
+				const unsigned char* b = &bytes[0];
+
+				double t = BestOf(5, []() {}, [&]()
+				{
+					float sum = 0.0f;
+
+					if(position_only) {
+						// depth / shadow pass: positions only
+						for(size_t i = 0; i < n; i++)
+							sum += glm::length(Fetch<Position>(b, layout, n, i) - eye);
+					}
+					else {
+						// shading pass: every attribute
+						for(size_t i = 0; i < n; i++) {
+							glm::vec3 p = Fetch<Position>(b, layout, n, i);
+							glm::vec3 normal = Fetch<Normal>(b, layout, n, i);
+							RGBA8 c = Fetch<Color>(b, layout, n, i);
+
+							sum += glm::dot(normal, eye - p) * Fetch<Intensity>(b, layout, n, i) * c.r + Fetch<Timestamp>(b, layout, n, i);
+						}
+					}
+
+					sink = sink + sum;
+				});
+
+				mverts[k++] = n / t / 1e6;
+			}
+		}
+
+		printf("%10zu %12.1f %12.1f %12.1f %12.1f\n", n, mverts[0], mverts[1], mverts[2], mverts[3]);
+	}
+}
+
+// --------------------------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+	srand48(1234);
+
+	string which = argc > 1 ? argv[1] : "";
+
+	if(which.empty() || which == "morton")
+		BenchMorton();
+
+	if(which.empty() || which == "depthsort")
+		BenchDepthSort();
+
+	if(which.empty() || which == "softraster")
+		BenchSoftRaster();
+
+	if(which.empty() || which == "vertexlayout")
+		BenchVertexLayout();
+
+	return 0;
+}
@@ -27,6 +27,9 @@ public:
                 this->yaw = -90.0f;
                 this->pitch = 0.0f; 
 
+		this->fov = fov;
+		this->zNear = zNear;
+		this->zFar = zFar;
 		this->projection = glm::perspective(fov, aspect, zNear, zFar);
 
                 updateCameraVectors();
@@ -36,7 +39,30 @@ public:
 
 	inline glm::mat4 GetViewProjection() const
 	{
-		return this->projection * glm::lookAt(this->pos, this->pos + this->front, this->up);
+		return this->projection * GetView();
+	}
+
+	inline glm::mat4 GetView() const
+	{
+		return glm::lookAt(this->pos, this->pos + this->front, this->up);
+	}
+
+	inline glm::mat4 GetProjection() const
+	{
+		return this->projection;
+	}
+
+	// sub-frustum of the camera at another aspect ratio: [left, right] x [bottom, top] in NDC of the full image (tiled renders)
+	inline glm::mat4 GetTileProjection(float aspect, float left, float right, float bottom, float top) const
+	{
+		// scale + offset in clip space: the tile bounds are mapped to [-1, 1]
+		glm::mat4 crop = glm::mat4(1.0f);
+		crop[0][0] = 2.0f / (right - left);
+		crop[1][1] = 2.0f / (top - bottom);
+		crop[3][0] = -(right + left) / (right - left);
+		crop[3][1] = -(top + bottom) / (top - bottom);
+
+		return crop * glm::perspective(this->fov, aspect, this->zNear, this->zFar);
 	}
 
         /*-------------------------------------------------------------------*/
@@ -106,6 +132,9 @@ private:
         float keyboard_sensitivity;
 
 	glm::mat4 projection;
+	float fov;
+	float zNear;
+	float zFar;
 
 	glm::vec3 pos;
 	glm::vec3 front;
@@ -0,0 +1,46 @@
+#pragma once
+
+#define GLM_ENABLE_EXPERIMENTAL
+
+#include <glm/glm.hpp>
+
+/*---------------------------------------------------------------------------*/
+
+/*
+	What the last rendered frame was drawn from: camera, model (motion), scene data
+	(PointBuffer::version) and framebuffer size. Changed() compares and remembers, a
+	frame whose inputs did not change does not have to be rendered again.
+*/
+
+class ChangeTracker
+{
+	public:
+		ChangeTracker() { Invalidate(); }
+
+		bool Changed(const glm::mat4& view_projection, const glm::mat4& model, unsigned int scene_version, int width, int height)
+		{
+			bool changed = !valid || view_projection != this->view_projection || model != this->model
+				|| scene_version != this->scene_version || width != this->width || height != this->height;
+
+			this->view_projection = view_projection;
+			this->model = model;
+			this->scene_version = scene_version;
+			this->width = width;
+			this->height = height;
+			this->valid = true;
+
+			return changed;
+		}
+
+		// the next Changed() returns true
+		void Invalidate() { valid = false; }
+
+	private:
+		bool valid;
+
+		glm::mat4 view_projection;
+		glm::mat4 model;
+		unsigned int scene_version;
+		int width;
+		int height;
+};
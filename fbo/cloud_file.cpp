@@ -0,0 +1,349 @@
+#include "cloud_file.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char CLOUD_MAGIC[8] = { 'G', 'L', 'F', 'W', 'P', 'C', 'F', '\0' };
+
+// the layout is the file format: no silent change
+static_assert(sizeof(CloudFileHeader) == 56, "CloudFileHeader layout");
+static_assert(sizeof(CloudChunk) == 72, "CloudChunk layout");
+
+static const uint64_t CLOUD_TABLE_OFFSET = sizeof(CLOUD_MAGIC) + sizeof(CloudFileHeader);
+
+/*---------------------------------------------------------------------------*/
+
+static uint64_t Align(uint64_t offset)
+{
+	return (offset + CLOUD_ALIGNMENT - 1) / CLOUD_ALIGNMENT * CLOUD_ALIGNMENT;
+}
+
+static size_t PositionStride(uint32_t position_format)
+{
+	return position_format == CLOUD_UNORM16 ? 3 * sizeof(uint16_t) : sizeof(glm::vec3);
+}
+
+static bool WriteAt(int fd, const void* data, size_t size, uint64_t offset)
+{
+	const char* p = (const char*)data;
+
+	while(size) {
+		ssize_t n = pwrite(fd, p, size, offset);
+
+		if(n < 0 && errno == EINTR)
+			continue;
+
+		if(n <= 0)
+			return false;
+
+		p += n;
+		size -= n;
+		offset += n;
+	}
+
+	return true;
+}
+
+/*---------------------------------------------------------------------------*/
+
+bool WriteCloudFile(const std::string& path, const std::vector<glm::vec3>& points, const std::vector<uint32_t>& colors,
+	const std::vector<PointChunk>& chunks, CloudPositionFormat position_format, WorkerPool& pool)
+{
+	if(!colors.empty() && colors.size() != points.size()) {
+		std::cout << "ERROR::CLOUD:: " << colors.size() << " colors for " << points.size() << " points" << std::endl;
+		return false;
+	}
+
+	CloudFileHeader header;
+	memset(&header, 0, sizeof(header));
+
+	header.version = CLOUD_VERSION;
+	header.nb_chunks = chunks.size();
+	header.nb_points = points.size();
+	header.position_format = position_format;
+	header.attributes = colors.empty() ? 0 : CLOUD_COLORS;
+	header.alignment = CLOUD_ALIGNMENT;
+
+	glm::vec3 bmin(0.0f);
+	glm::vec3 bmax(0.0f);
+
+	// columns laid out chunk after chunk, each one aligned
+	std::vector<CloudChunk> table(chunks.size());
+	uint64_t offset = Align(CLOUD_TABLE_OFFSET + table.size() * sizeof(CloudChunk));
+
+	for(size_t c = 0; c < chunks.size(); c++) {
+		const PointChunk& chunk = chunks[c];
+		CloudChunk& entry = table[c];
+
+		memset(&entry, 0, sizeof(entry));
+
+		glm::vec3 extent = chunk.bmax - chunk.bmin;
+
+		for(int a = 0; a < 3; a++) {
+			entry.bmin[a] = chunk.bmin[a];
+			entry.bmax[a] = chunk.bmax[a];
+			entry.offset[a] = chunk.bmin[a];
+			entry.scale[a] = extent[a] / 65535.0f;
+		}
+
+		entry.nb_points = chunk.count;
+
+		entry.positions = offset;
+		offset = Align(offset + (uint64_t)chunk.count * PositionStride(position_format));
+
+		if(!colors.empty()) {
+			entry.colors = offset;
+			offset = Align(offset + (uint64_t)chunk.count * sizeof(uint32_t));
+		}
+
+		header.chunk_size = std::max(header.chunk_size, chunk.count);
+
+		bmin = c ? glm::min(bmin, chunk.bmin) : chunk.bmin;
+		bmax = c ? glm::max(bmax, chunk.bmax) : chunk.bmax;
+	}
+
+	for(int a = 0; a < 3; a++) {
+		header.bmin[a] = bmin[a];
+		header.bmax[a] = bmax[a];
+	}
+
+	// written aside then renamed: an interrupted conversion never leaves a truncated file
+	std::string tmp_path = path + ".tmp";
+
+	int fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+	if(fd < 0) {
+		std::cout << "ERROR::CLOUD:: cannot write " << path << std::endl;
+		return false;
+	}
+
+	bool ok = ftruncate(fd, offset) == 0 &&
+		WriteAt(fd, CLOUD_MAGIC, sizeof(CLOUD_MAGIC), 0) &&
+		WriteAt(fd, &header, sizeof(header), sizeof(CLOUD_MAGIC)) &&
+		(table.empty() || WriteAt(fd, &table[0], table.size() * sizeof(CloudChunk), CLOUD_TABLE_OFFSET));
+
+	// columns: every slice encodes and writes its chunks
+	std::atomic<bool> failed(!ok);
+
+	pool.ParallelFor(chunks.size(), [&](size_t begin, size_t end, unsigned int)
+	{
+		std::vector<uint16_t> quantized;
+
+		for(size_t c = begin; c < end && !failed; c++) {
+			const PointChunk& chunk = chunks[c];
+			const CloudChunk& entry = table[c];
+
+			bool written;
+
+			if(position_format == CLOUD_UNORM16) {
+				quantized.resize((size_t)chunk.count * 3);
+
+				for(unsigned int i = 0; i < chunk.count; i++) {
+					const glm::vec3& p = points[chunk.first + i];
+
+					for(int a = 0; a < 3; a++) {
+						float q = entry.scale[a] > 0.0f ? std::round((p[a] - entry.offset[a]) / entry.scale[a]) : 0.0f;
+						quantized[3 * i + a] = (uint16_t)std::min(std::max(q, 0.0f), 65535.0f);
+					}
+				}
+
+				written = WriteAt(fd, quantized.data(), quantized.size() * sizeof(uint16_t), entry.positions);
+			}
+			else {
+				written = WriteAt(fd, &points[chunk.first], (size_t)chunk.count * sizeof(glm::vec3), entry.positions);
+			}
+
+			if(written && entry.colors)
+				written = WriteAt(fd, &colors[chunk.first], (size_t)chunk.count * sizeof(uint32_t), entry.colors);
+
+			if(!written)
+				failed = true;
+		}
+	});
+
+	ok = close(fd) == 0 && !failed;
+
+	if(!ok || std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+		std::cout << "ERROR::CLOUD:: cannot write " << path << std::endl;
+		std::remove(tmp_path.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+/*---------------------------------------------------------------------------*/
+
+CloudFile::CloudFile()
+{
+	this->data = nullptr;
+	this->size = 0;
+	this->table = nullptr;
+
+	memset(&header, 0, sizeof(header));
+}
+
+CloudFile::~CloudFile()
+{
+	Close();
+}
+
+void CloudFile::Close()
+{
+	if(data)
+		munmap((void*)data, size);
+
+	data = nullptr;
+	size = 0;
+	table = nullptr;
+
+	memset(&header, 0, sizeof(header));
+}
+
+/*---------------------------------------------------------------------------*/
+
+bool CloudFile::Open(const std::string& path)
+{
+	Close();
+
+	int fd = open(path.c_str(), O_RDONLY);
+
+	if(fd < 0) {
+		std::cout << "ERROR::CLOUD:: cannot read " << path << std::endl;
+		return false;
+	}
+
+	struct stat st;
+
+	if(fstat(fd, &st) == 0 && (size_t)st.st_size >= CLOUD_TABLE_OFFSET) {
+		void* mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+		if(mapping != MAP_FAILED) {
+			data = (const char*)mapping;
+			size = st.st_size;
+		}
+	}
+
+	close(fd);
+
+	bool ok = data && memcmp(data, CLOUD_MAGIC, sizeof(CLOUD_MAGIC)) == 0;
+
+	if(ok) {
+		memcpy(&header, data + sizeof(CLOUD_MAGIC), sizeof(header));
+
+		ok = header.version == CLOUD_VERSION && header.alignment == CLOUD_ALIGNMENT &&
+			(header.position_format == CLOUD_FLOAT32 || header.position_format == CLOUD_UNORM16) &&
+			CLOUD_TABLE_OFFSET + (uint64_t)header.nb_chunks * sizeof(CloudChunk) <= size;
+	}
+
+	if(ok)
+		table = reinterpret_cast<const CloudChunk*>(data + CLOUD_TABLE_OFFSET);
+
+	// never read past the mapping: every column is inside the file
+	uint64_t nb_points = 0;
+
+	for(unsigned int c = 0; ok && c < header.nb_chunks; c++) {
+		const CloudChunk& chunk = table[c];
+
+		ok = chunk.positions % CLOUD_ALIGNMENT == 0 && chunk.positions + (uint64_t)chunk.nb_points * PositionStride(header.position_format) <= size;
+
+		if(ok && (header.attributes & CLOUD_COLORS))
+			ok = chunk.colors % CLOUD_ALIGNMENT == 0 && chunk.colors + (uint64_t)chunk.nb_points * sizeof(uint32_t) <= size;
+
+		nb_points += chunk.nb_points;
+	}
+
+	// PointChunk ranges are 32-bit
+	ok = ok && nb_points == header.nb_points && nb_points <= UINT32_MAX;
+
+	if(!ok) {
+		std::cout << "ERROR::CLOUD:: " << path << " is not a valid point cloud file" << std::endl;
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+/*---------------------------------------------------------------------------*/
+
+void CloudFile::ReadPositions(unsigned int chunk, glm::vec3* out) const
+{
+	const CloudChunk& c = table[chunk];
+
+	if(header.position_format == CLOUD_FLOAT32) {
+		memcpy(out, data + c.positions, (size_t)c.nb_points * sizeof(glm::vec3));
+		return;
+	}
+
+	const uint16_t* q = reinterpret_cast<const uint16_t*>(data + c.positions);
+
+	glm::vec3 offset(c.offset[0], c.offset[1], c.offset[2]);
+	glm::vec3 scale(c.scale[0], c.scale[1], c.scale[2]);
+
+	for(unsigned int i = 0; i < c.nb_points; i++) {
+		out[i] = offset + glm::vec3(q[3 * i], q[3 * i + 1], q[3 * i + 2]) * scale;
+	}
+}
+
+const uint32_t* CloudFile::Colors(unsigned int chunk) const
+{
+	if(!(header.attributes & CLOUD_COLORS))
+		return nullptr;
+
+	return reinterpret_cast<const uint32_t*>(data + table[chunk].colors);
+}
+
+/*---------------------------------------------------------------------------*/
+
+unsigned int CloudFile::Load(std::vector<glm::vec3>& points, std::vector<PointChunk>& chunks,
+	std::function<bool(const glm::vec3& bmin, const glm::vec3& bmax)> keep, WorkerPool& pool) const
+{
+	// the table decides: rejected chunks are never read
+	std::vector<unsigned int> kept;
+	size_t total = 0;
+
+	chunks.clear();
+
+	for(unsigned int c = 0; c < header.nb_chunks; c++) {
+		const CloudChunk& chunk = table[c];
+
+		PointChunk range;
+		range.first = total;
+		range.count = chunk.nb_points;
+		range.bmin = glm::vec3(chunk.bmin[0], chunk.bmin[1], chunk.bmin[2]);
+		range.bmax = glm::vec3(chunk.bmax[0], chunk.bmax[1], chunk.bmax[2]);
+
+		if(keep && !keep(range.bmin, range.bmax))
+			continue;
+
+		chunks.push_back(range);
+		kept.push_back(c);
+
+		total += chunk.nb_points;
+
+		// read ahead of the columns the slices are about to copy
+		madvise((void*)(data + chunk.positions), (size_t)chunk.nb_points * PositionStride(header.position_format), MADV_WILLNEED);
+	}
+
+	points.resize(total);
+
+	pool.ParallelFor(kept.size(), [&](size_t begin, size_t end, unsigned int)
+	{
+		for(size_t i = begin; i < end; i++) {
+			ReadPositions(kept[i], &points[chunks[i].first]);
+		}
+	});
+
+	return header.nb_chunks - kept.size();
+}
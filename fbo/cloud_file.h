@@ -0,0 +1,132 @@
+#pragma once
+
+#define GLM_ENABLE_EXPERIMENTAL
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "morton.h"
+#include "worker_pool.h"
+
+/*---------------------------------------------------------------------------*/
+
+/*
+	Point cloud file (.pcf), written by glfw_shader_convert, read with mmap.
+
+		magic, CloudFileHeader
+		CloudChunk table (nb_chunks entries)
+		columns, each one starting on a CLOUD_ALIGNMENT boundary:
+		  chunk 0 positions, chunk 0 colors, chunk 1 positions, ...
+
+	The points are in Morton order (see MortonOrder): a chunk is a contiguous range of
+	at most chunk_size points, close in space, with tight bounds. A reader decides from
+	the table alone which chunks it wants, the pages of the others are never touched.
+
+	Columns (one attribute of every point of a chunk, packed):
+	  positions  CLOUD_FLOAT32: 3 floats per point, the PointBuffer layout (copied as is)
+	             CLOUD_UNORM16: 3 uint16 per point, p = offset + q * scale (chunk values)
+	  colors     RGBA8, only when the header has CLOUD_COLORS
+
+	Native endianness (little endian everywhere we run).
+*/
+
+static const uint32_t CLOUD_VERSION = 1;
+
+// page: a column can be mapped or handed to the GL straight from the file
+static const uint32_t CLOUD_ALIGNMENT = 4096;
+
+enum CloudPositionFormat
+{
+	CLOUD_FLOAT32 = 0,
+	CLOUD_UNORM16 = 1
+};
+
+// header attributes
+static const uint32_t CLOUD_COLORS = 1;
+
+struct CloudFileHeader
+{
+	uint32_t version;
+	uint32_t nb_chunks;
+	uint64_t nb_points;
+
+	uint32_t position_format;
+	uint32_t attributes;
+
+	uint32_t chunk_size;
+	uint32_t alignment;
+
+	float bmin[3];
+	float bmax[3];
+};
+
+struct CloudChunk
+{
+	float bmin[3];
+	float bmax[3];
+
+	// dequantization: p = offset + q * scale (CLOUD_UNORM16), unused otherwise
+	float offset[3];
+	float scale[3];
+
+	uint32_t nb_points;
+	uint32_t padding;
+
+	// file offsets of the columns (colors: 0 without CLOUD_COLORS)
+	uint64_t positions;
+	uint64_t colors;
+};
+
+/*---------------------------------------------------------------------------*/
+
+/*
+	points: Morton sorted, chunks: their ranges (MortonOrder::BuildChunks), colors: RGBA8,
+	one per point or empty. The chunks are encoded and written on the pool threads.
+*/
+bool WriteCloudFile(const std::string& path, const std::vector<glm::vec3>& points, const std::vector<uint32_t>& colors,
+	const std::vector<PointChunk>& chunks, CloudPositionFormat position_format, WorkerPool& pool = WorkerPool::Instance());
+
+/*---------------------------------------------------------------------------*/
+
+// read only mapping of a .pcf file
+class CloudFile
+{
+	public:
+		CloudFile();
+		virtual ~CloudFile();
+
+		// maps the file, checks the header and the chunk table
+		bool Open(const std::string& path);
+
+		const CloudFileHeader& Header() const { return header; }
+
+		unsigned int NbChunks() const { return header.nb_chunks; }
+		const CloudChunk& Chunk(unsigned int chunk) const { return table[chunk]; }
+
+		// chunk positions into out (nb_points of them): a copy, or the decode of the quantized column
+		void ReadPositions(unsigned int chunk, glm::vec3* out) const;
+
+		// chunk colors (RGBA8), nullptr without CLOUD_COLORS
+		const uint32_t* Colors(unsigned int chunk) const;
+
+		/*
+			Points of the chunks kept (all when keep is empty) into points, in file order,
+			and their ranges into chunks. Chunks are read in parallel, the rejected ones are
+			not read at all. Returns the number of chunks skipped.
+		*/
+		unsigned int Load(std::vector<glm::vec3>& points, std::vector<PointChunk>& chunks,
+			std::function<bool(const glm::vec3& bmin, const glm::vec3& bmax)> keep = nullptr, WorkerPool& pool = WorkerPool::Instance()) const;
+
+	private:
+		void Close();
+
+		const char* data;
+		size_t size;
+
+		CloudFileHeader header;
+		const CloudChunk* table;
+};
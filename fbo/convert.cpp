@@ -0,0 +1,634 @@
+#include "cloud_file.h"
+#include "morton.h"
+#include "worker_pool.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+/*
+	Point cloud converter: .xyz / .ply -> .pcf (see cloud_file.h), read by glfw_shader --cloud
+
+	./glfw_shader_convert <input.xyz|input.ply> <output.pcf> [options]
+
+	--chunk <points>     points per chunk (default 4096)
+	--quantize           16-bit positions relative to the chunk bounds (half the size)
+	--fit                brings the cloud into the [-1, 1] cube (aspect kept), the view of the generated cloud
+	--wide               63-bit Morton codes (big clouds with fine details)
+	--threads <n>        worker threads (default: one per core)
+
+	.xyz (.txt, .pts): one point per line, "x y z", "x y z r g b" or "x y z intensity r g b",
+	colors 0-255, the lines that do not start with 3 numbers are skipped
+	.ply: ascii or binary_little_endian, vertex element first, x y z (float / double),
+	optional red green blue alpha (uchar)
+
+	Every step runs on the pool: text parsed by byte ranges, binary records by index
+	ranges, Morton sort, chunks encoded and written in parallel.
+*/
+
+// --------------------------------------------------------------------------------------------
+
+struct Cloud
+{
+	vector<glm::vec3> points;
+
+	// RGBA8, empty without colors
+	vector<uint32_t> colors;
+};
+
+// columns / properties of the point fields, -1: absent
+enum Field { FIELD_X, FIELD_Y, FIELD_Z, FIELD_R, FIELD_G, FIELD_B, FIELD_A, NB_FIELDS };
+
+static const int MAX_COLUMNS = 32;
+
+static double Milliseconds(chrono::steady_clock::time_point start)
+{
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count() * 1e3;
+}
+
+static uint32_t PackColor(double r, double g, double b, double a)
+{
+	auto channel = [](double v) { return (uint32_t)min(max(v, 0.0), 255.0); };
+
+	return channel(r) | channel(g) << 8 | channel(b) << 16 | channel(a) << 24;
+}
+
+// --------------------------------------------------------------------------------------------
+
+// read only mapping of the whole input
+struct MappedFile
+{
+	const char* data = nullptr;
+	size_t size = 0;
+
+	bool Open(const string& path)
+	{
+		int fd = open(path.c_str(), O_RDONLY);
+
+		if(fd < 0)
+			return false;
+
+		struct stat st;
+
+		if(fstat(fd, &st) == 0 && st.st_size > 0) {
+			void* mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+			if(mapping != MAP_FAILED) {
+				data = (const char*)mapping;
+				size = st.st_size;
+
+				// read once, front to back
+				madvise(mapping, size, MADV_SEQUENTIAL);
+			}
+		}
+
+		close(fd);
+
+		return data != nullptr;
+	}
+
+	~MappedFile()
+	{
+		if(data)
+			munmap((void*)data, size);
+	}
+};
+
+// --------------------------------------------------------------------------------------------
+
+static bool IsSeparator(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == ',';
+}
+
+// numbers of the line [p, end) into values, returns how many (at most MAX_COLUMNS)
+static int ParseLine(const char* p, const char* end, double* values)
+{
+	int count = 0;
+
+	while(count < MAX_COLUMNS) {
+		while(p < end && IsSeparator(*p))
+			p++;
+
+		if(p == end)
+			break;
+
+		// from_chars does not take the sign '+'
+		if(*p == '+')
+			p++;
+
+		auto result = from_chars(p, end, values[count]);
+
+		if(result.ec != errc())
+			break;
+
+		p = result.ptr;
+		count++;
+	}
+
+	return count;
+}
+
+/*
+	Text lines of [text, text + size): the byte range is cut in one slice per thread, a
+	line belongs to the slice where it starts. fields: column of each Field.
+*/
+static void ParseText(const char* text, size_t size, const int* fields, Cloud& cloud, WorkerPool& pool)
+{
+	bool colors = fields[FIELD_R] >= 0;
+
+	int nb_needed = 0;
+
+	for(int f = 0; f < NB_FIELDS; f++)
+		nb_needed = max(nb_needed, fields[f] + 1);
+
+	vector<Cloud> slices(pool.Size());
+
+	pool.ParallelFor(size, [&](size_t begin, size_t end, unsigned int slice)
+	{
+		Cloud& out = slices[slice];
+
+		const char* p = text + begin;
+		const char* text_end = text + size;
+
+		// the line cut by the range start is the previous slice's
+		if(begin > 0 && text[begin - 1] != '\n') {
+			p = (const char*)memchr(p, '\n', text_end - p);
+			p = p ? p + 1 : text_end;
+		}
+
+		double values[MAX_COLUMNS];
+
+		while(p < text + end) {
+			const char* line_end = (const char*)memchr(p, '\n', text_end - p);
+
+			if(!line_end)
+				line_end = text_end;
+
+			int count = ParseLine(p, line_end, values);
+
+			if(count >= 3 && count > max(fields[FIELD_X], max(fields[FIELD_Y], fields[FIELD_Z]))) {
+				out.points.push_back(glm::vec3(values[fields[FIELD_X]], values[fields[FIELD_Y]], values[fields[FIELD_Z]]));
+
+				if(colors) {
+					if(count >= nb_needed)
+						out.colors.push_back(PackColor(values[fields[FIELD_R]], values[fields[FIELD_G]], values[fields[FIELD_B]],
+							fields[FIELD_A] >= 0 ? values[fields[FIELD_A]] : 255.0));
+					else
+						out.colors.push_back(0xffffffff);
+				}
+			}
+
+			p = line_end + 1;
+		}
+	});
+
+	// slices in file order
+	size_t total = 0;
+
+	for(const Cloud& s : slices)
+		total += s.points.size();
+
+	cloud.points.reserve(total);
+
+	if(colors)
+		cloud.colors.reserve(total);
+
+	for(Cloud& s : slices) {
+		cloud.points.insert(cloud.points.end(), s.points.begin(), s.points.end());
+		cloud.colors.insert(cloud.colors.end(), s.colors.begin(), s.colors.end());
+
+		s = Cloud();
+	}
+}
+
+// --------------------------------------------------------------------------------------------
+
+static bool LoadXYZ(const string& path, Cloud& cloud, WorkerPool& pool)
+{
+	MappedFile file;
+
+	if(!file.Open(path)) {
+		cout << "ERROR::CONVERT:: cannot read " << path << endl;
+		return false;
+	}
+
+	// the first line of numbers tells the columns
+	int fields[NB_FIELDS] = { 0, 1, 2, -1, -1, -1, -1 };
+
+	const char* p = file.data;
+	const char* end = file.data + file.size;
+
+	while(p < end) {
+		const char* line_end = (const char*)memchr(p, '\n', end - p);
+
+		if(!line_end)
+			line_end = end;
+
+		double values[MAX_COLUMNS];
+		int count = ParseLine(p, line_end, values);
+
+		if(count >= 3) {
+			// x y z r g b / x y z intensity r g b
+			if(count == 6 || count == 7) {
+				fields[FIELD_R] = count - 3;
+				fields[FIELD_G] = count - 2;
+				fields[FIELD_B] = count - 1;
+			}
+
+			break;
+		}
+
+		p = line_end + 1;
+	}
+
+	ParseText(file.data, file.size, fields, cloud, pool);
+
+	return true;
+}
+
+// --------------------------------------------------------------------------------------------
+
+struct PlyProperty
+{
+	string name;
+	string type;
+	size_t offset;
+
+	// decoded from type once, not per record
+	size_t size;
+	bool is_float;
+	bool is_unsigned;
+};
+
+static size_t PlyTypeSize(const string& type)
+{
+	if(type == "char" || type == "uchar" || type == "int8" || type == "uint8")
+		return 1;
+
+	if(type == "short" || type == "ushort" || type == "int16" || type == "uint16")
+		return 2;
+
+	if(type == "int" || type == "uint" || type == "int32" || type == "uint32" || type == "float" || type == "float32")
+		return 4;
+
+	if(type == "double" || type == "float64")
+		return 8;
+
+	return 0;
+}
+
+// little endian binary value (unaligned)
+static double PlyValue(const char* p, const PlyProperty& property)
+{
+	switch(property.size) {
+		case 1:
+			return property.is_unsigned ? (double)*(const uint8_t*)p : (double)*(const int8_t*)p;
+
+		case 2: {
+			uint16_t v;
+			memcpy(&v, p, 2);
+			return property.is_unsigned ? (double)v : (double)(int16_t)v;
+		}
+
+		case 4: {
+			if(property.is_float) {
+				float v;
+				memcpy(&v, p, 4);
+				return v;
+			}
+
+			uint32_t v;
+			memcpy(&v, p, 4);
+			return property.is_unsigned ? (double)v : (double)(int32_t)v;
+		}
+
+		default: {
+			double v;
+			memcpy(&v, p, 8);
+			return v;
+		}
+	}
+}
+
+static bool LoadPLY(const string& path, Cloud& cloud, WorkerPool& pool)
+{
+	MappedFile file;
+
+	if(!file.Open(path)) {
+		cout << "ERROR::CONVERT:: cannot read " << path << endl;
+		return false;
+	}
+
+	// header lines, up to end_header
+	const char* p = file.data;
+	const char* end = file.data + file.size;
+
+	string format;
+	size_t nb_vertices = 0;
+	int nb_elements = 0;
+	bool vertex_first = false;
+	vector<PlyProperty> properties;
+	size_t stride = 0;
+	bool list_property = false;
+	bool header_end = false;
+
+	while(p < end && !header_end) {
+		const char* line_end = (const char*)memchr(p, '\n', end - p);
+
+		if(!line_end)
+			line_end = end;
+
+		string line(p, line_end);
+
+		if(!line.empty() && line.back() == '\r')
+			line.pop_back();
+
+		char word[64] = "", arg1[64] = "", arg2[64] = "";
+		sscanf(line.c_str(), "%63s %63s %63s", word, arg1, arg2);
+
+		if(strcmp(word, "format") == 0) {
+			format = arg1;
+		}
+		else if(strcmp(word, "element") == 0) {
+			nb_elements++;
+
+			if(nb_elements == 1 && strcmp(arg1, "vertex") == 0) {
+				vertex_first = true;
+				nb_vertices = strtoull(arg2, NULL, 10);
+			}
+		}
+		else if(strcmp(word, "property") == 0 && nb_elements == 1 && vertex_first) {
+			if(strcmp(arg1, "list") == 0) {
+				list_property = true;
+			}
+			else {
+				size_t size = PlyTypeSize(arg1);
+
+				properties.push_back({ arg2, arg1, stride, size, arg1[0] == 'f' || arg1[0] == 'd', arg1[0] == 'u' });
+				stride += size;
+			}
+		}
+		else if(strcmp(word, "end_header") == 0) {
+			header_end = true;
+		}
+
+		p = line_end + 1;
+	}
+
+	// property indices (ascii: columns) and byte offsets (binary) of the fields
+	static const char* NAMES[NB_FIELDS] = { "x", "y", "z", "red", "green", "blue", "alpha" };
+	int fields[NB_FIELDS];
+
+	for(int f = 0; f < NB_FIELDS; f++) {
+		fields[f] = -1;
+
+		for(size_t i = 0; i < properties.size(); i++) {
+			if(properties[i].name == NAMES[f])
+				fields[f] = i;
+		}
+	}
+
+	bool binary = format == "binary_little_endian";
+
+	bool ok = header_end && vertex_first && !list_property && (binary || format == "ascii") &&
+		fields[FIELD_X] >= 0 && fields[FIELD_Y] >= 0 && fields[FIELD_Z] >= 0 && properties.size() <= MAX_COLUMNS;
+
+	for(const PlyProperty& property : properties)
+		ok = ok && property.size > 0;
+
+	// colors: the three channels or none
+	if(fields[FIELD_R] < 0 || fields[FIELD_G] < 0 || fields[FIELD_B] < 0)
+		fields[FIELD_R] = fields[FIELD_G] = fields[FIELD_B] = fields[FIELD_A] = -1;
+
+	if(!ok) {
+		cout << "ERROR::CONVERT:: " << path << ": unsupported PLY (ascii or binary_little_endian, vertex element first with x y z and no list property)" << endl;
+		return false;
+	}
+
+	if(!binary) {
+		// the vertex lines, the faces (if any) follow
+		const char* vertices_end = p;
+
+		for(size_t i = 0; i < nb_vertices && vertices_end < end; i++) {
+			const char* line_end = (const char*)memchr(vertices_end, '\n', end - vertices_end);
+			vertices_end = line_end ? line_end + 1 : end;
+		}
+
+		ParseText(p, vertices_end - p, fields, cloud, pool);
+
+		if(cloud.points.size() != nb_vertices)
+			cout << "ConvertPLY: " << cloud.points.size() << " vertices read, " << nb_vertices << " in the header" << endl;
+
+		return true;
+	}
+
+	if((size_t)(end - p) < nb_vertices * stride) {
+		cout << "ERROR::CONVERT:: " << path << " is truncated" << endl;
+		return false;
+	}
+
+	const char* records = p;
+	bool colors = fields[FIELD_R] >= 0;
+
+	cloud.points.resize(nb_vertices);
+
+	if(colors)
+		cloud.colors.resize(nb_vertices);
+
+	// fixed size records: index ranges
+	pool.ParallelFor(nb_vertices, [&](size_t begin, size_t end, unsigned int)
+	{
+		for(size_t i = begin; i < end; i++) {
+			const char* record = records + i * stride;
+
+			double v[NB_FIELDS];
+
+			for(int f = 0; f < NB_FIELDS; f++) {
+				v[f] = fields[f] >= 0 ? PlyValue(record + properties[fields[f]].offset, properties[fields[f]]) : 255.0;
+			}
+
+			cloud.points[i] = glm::vec3(v[FIELD_X], v[FIELD_Y], v[FIELD_Z]);
+
+			if(colors)
+				cloud.colors[i] = PackColor(v[FIELD_R], v[FIELD_G], v[FIELD_B], v[FIELD_A]);
+		}
+	});
+
+	return true;
+}
+
+// --------------------------------------------------------------------------------------------
+
+// bounds into the [-1, 1] cube, aspect kept
+static void Fit(vector<glm::vec3>& points, WorkerPool& pool)
+{
+	vector<glm::vec3> slice_min(pool.Size(), glm::vec3(numeric_limits<float>::max()));
+	vector<glm::vec3> slice_max(pool.Size(), glm::vec3(-numeric_limits<float>::max()));
+
+	pool.ParallelFor(points.size(), [&](size_t begin, size_t end, unsigned int slice)
+	{
+		for(size_t i = begin; i < end; i++) {
+			slice_min[slice] = glm::min(slice_min[slice], points[i]);
+			slice_max[slice] = glm::max(slice_max[slice], points[i]);
+		}
+	});
+
+	glm::vec3 bmin = slice_min[0];
+	glm::vec3 bmax = slice_max[0];
+
+	for(unsigned int s = 1; s < pool.Size(); s++) {
+		bmin = glm::min(bmin, slice_min[s]);
+		bmax = glm::max(bmax, slice_max[s]);
+	}
+
+	glm::vec3 center = 0.5f * (bmin + bmax);
+	glm::vec3 extent = bmax - bmin;
+	float scale = 2.0f / max(max(extent.x, extent.y), max(extent.z, 1e-20f));
+
+	pool.ParallelFor(points.size(), [&](size_t begin, size_t end, unsigned int)
+	{
+		for(size_t i = begin; i < end; i++) {
+			points[i] = (points[i] - center) * scale;
+		}
+	});
+}
+
+// --------------------------------------------------------------------------------------------
+
+static void Usage(const char* program)
+{
+	cout << "usage: " << program << " <input.xyz|input.ply> <output.pcf> [--chunk <points>] [--quantize] [--fit] [--wide] [--threads <n>]" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+	if(argc < 3) {
+		Usage(argv[0]);
+		return 1;
+	}
+
+	string input_path = argv[1];
+	string output_path = argv[2];
+
+	unsigned int chunk_size = 4096;
+	bool quantize = false;
+	bool fit = false;
+	bool wide = false;
+	unsigned int threads = 0;
+
+	for(int i = 3; i < argc; i++) {
+		if(strcmp(argv[i], "--chunk") == 0 && i + 1 < argc) {
+			chunk_size = max(1, atoi(argv[++i]));
+		}
+		else if(strcmp(argv[i], "--quantize") == 0) {
+			quantize = true;
+		}
+		else if(strcmp(argv[i], "--fit") == 0) {
+			fit = true;
+		}
+		else if(strcmp(argv[i], "--wide") == 0) {
+			wide = true;
+		}
+		else if(strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+			threads = max(1, atoi(argv[++i]));
+		}
+		else {
+			Usage(argv[0]);
+			return 1;
+		}
+	}
+
+	WorkerPool pool(threads);
+
+	// read
+	auto start = chrono::steady_clock::now();
+
+	string extension = input_path.substr(min(input_path.size(), input_path.rfind('.')));
+	transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+	Cloud cloud;
+	bool ok;
+
+	if(extension == ".ply") {
+		ok = LoadPLY(input_path, cloud, pool);
+	}
+	else if(extension == ".xyz" || extension == ".txt" || extension == ".pts") {
+		ok = LoadXYZ(input_path, cloud, pool);
+	}
+	else {
+		cout << "ERROR::CONVERT:: " << input_path << ": unknown extension (.xyz, .txt, .pts, .ply)" << endl;
+		ok = false;
+	}
+
+	if(!ok) {
+		return 1;
+	}
+
+	if(cloud.points.empty() || cloud.points.size() > numeric_limits<uint32_t>::max()) {
+		cout << "ERROR::CONVERT:: " << input_path << ": " << cloud.points.size() << " points (1 to 2^32 - 1)" << endl;
+		return 1;
+	}
+
+	double read_ms = Milliseconds(start);
+
+	// Morton order, colors permuted along, then the chunks
+	start = chrono::steady_clock::now();
+
+	if(fit) {
+		Fit(cloud.points, pool);
+	}
+
+	MortonOrder morton(wide, pool);
+	morton.Sort(cloud.points);
+
+	if(!cloud.colors.empty()) {
+		vector<uint32_t> sorted(cloud.colors.size());
+
+		pool.ParallelFor(sorted.size(), [&](size_t begin, size_t end, unsigned int)
+		{
+			for(size_t i = begin; i < end; i++) {
+				sorted[i] = cloud.colors[morton.order[i]];
+			}
+		});
+
+		cloud.colors.swap(sorted);
+	}
+
+	vector<PointChunk> chunks = morton.BuildChunks(cloud.points, chunk_size);
+
+	double sort_ms = Milliseconds(start);
+
+	// encode + write
+	start = chrono::steady_clock::now();
+
+	if(!WriteCloudFile(output_path, cloud.points, cloud.colors, chunks, quantize ? CLOUD_UNORM16 : CLOUD_FLOAT32, pool)) {
+		return 1;
+	}
+
+	double write_ms = Milliseconds(start);
+
+	struct stat st;
+	double mb = stat(output_path.c_str(), &st) == 0 ? st.st_size / 1048576.0 : 0.0;
+
+	printf("%s: %zu points%s, %zu chunks, %s positions, %.1f MB (%u threads)\n", output_path.c_str(), cloud.points.size(),
+		cloud.colors.empty() ? "" : " with colors", chunks.size(), quantize ? "16-bit" : "float", mb, pool.Size());
+	printf("read %.0f ms, sort %.0f ms, write %.0f ms\n", read_ms, sort_ms, write_ms);
+
+	return 0;
+}
@@ -0,0 +1,252 @@
+#include "depth_sort.h"
+#include "frame_arena.h"
+#include "morton.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+// incremental sort: average number of points per depth bucket
+static const size_t BUCKET_LOAD = 32;
+static const size_t MAX_BUCKETS = 1 << 16;
+
+// neighbour pairs of the previous order checked before the incremental sort, at most
+// 1 / MAX_INVERSION_SHARE of them out of order (more: the full sort is cheaper)
+static const size_t COHERENCE_SAMPLES = 256;
+static const size_t MAX_INVERSION_SHARE = 4;
+
+/*---------------------------------------------------------------------------*/
+
+// view space z (the camera looks down -z: the smaller the farther)
+static inline float ViewDepth(const glm::vec3& p, const glm::mat4& mv)
+{
+	return mv[0][2] * p.x + mv[1][2] * p.y + mv[2][2] * p.z + mv[3][2];
+}
+
+// order preserving float -> uint32 mapping (flip the sign bit of positives, all bits of negatives)
+static inline uint32_t FloatKey(float f)
+{
+	uint32_t u;
+	memcpy(&u, &f, sizeof(u));
+
+	return u ^ ((u >> 31) ? 0xffffffffu : 0x80000000u);
+}
+
+/*---------------------------------------------------------------------------*/
+
+DepthSorter::DepthSorter(WorkerPool& pool) : pool(pool)
+{
+	this->coherent = false;
+	this->max_moves_per_point = 8;
+	this->last_was_full = false;
+}
+
+/*---------------------------------------------------------------------------*/
+
+const std::vector<uint32_t>& DepthSorter::Sort(const std::vector<glm::vec3>& points, const glm::mat4& model_view)
+{
+	// nothing moved (the caller reports point edits through Reset())
+	if(coherent && indices.size() == points.size() && model_view == last_model_view && !indices.empty()) {
+		last_was_full = false;
+		return indices;
+	}
+
+	last_model_view = model_view;
+
+	if(coherent && indices.size() == points.size() && IncrementalSort(points, model_view)) {
+		last_was_full = false;
+		return indices;
+	}
+
+	return FullSort(points, model_view);
+}
+
+/*---------------------------------------------------------------------------*/
+
+const std::vector<uint32_t>& DepthSorter::FullSort(const std::vector<glm::vec3>& points, const glm::mat4& model_view)
+{
+	size_t n = points.size();
+
+	last_model_view = model_view;
+
+	keys.resize(n);
+	values.resize(n);
+
+	pool.ParallelFor(n, [&](size_t begin, size_t end, unsigned int) {
+		for(size_t i = begin; i < end; i++) {
+			keys[i] = FloatKey(ViewDepth(points[i], model_view));
+			values[i] = i;
+		}
+	});
+
+	RadixSort<uint32_t>(keys, values, 32, pool, radix);
+
+	// both sized n: the swap keeps the two allocations
+	indices.swap(values);
+	last_was_full = true;
+
+	return indices;
+}
+
+/*---------------------------------------------------------------------------*/
+
+bool DepthSorter::IncrementalSort(const std::vector<glm::vec3>& points, const glm::mat4& model_view)
+{
+	size_t n = indices.size();
+
+	if(n == 0)
+		return true;
+
+	// 0. neighbours sampled along the previous order: the insertion sort moves about as many
+	// points as they have inversions (many: the points moved by more than their spacing)
+	size_t samples = std::min(n - 1, COHERENCE_SAMPLES);
+	size_t inversions = 0;
+
+	for(size_t s = 0; s < samples; s++) {
+		size_t i = s * (n - 1) / samples;
+
+		inversions += ViewDepth(points[indices[i]], model_view) > ViewDepth(points[indices[i + 1]], model_view);
+	}
+
+	if(inversions > samples / MAX_INVERSION_SHARE)
+		return false;
+
+	unsigned int slices = pool.Size();
+
+	// ~BUCKET_LOAD points per bucket
+	size_t nb_buckets = std::min(MAX_BUCKETS, std::max((size_t)1, n / BUCKET_LOAD));
+
+	// per frame scratch: no heap allocation once the sort is warm
+	FrameArena& arena = FrameArena::Current();
+
+	float* slice_min = arena.Allocate<float>(slices);
+	float* slice_max = arena.Allocate<float>(slices);
+
+	std::fill(slice_min, slice_min + slices, std::numeric_limits<float>::max());
+	std::fill(slice_max, slice_max + slices, -std::numeric_limits<float>::max());
+
+	// 1. new depths, in the previous order
+	pairs.resize(n);
+
+	pool.ParallelFor(n, [&](size_t begin, size_t end, unsigned int slice) {
+		float lo = slice_min[slice];
+		float hi = slice_max[slice];
+
+		for(size_t i = begin; i < end; i++) {
+			uint32_t index = indices[i];
+			float d = ViewDepth(points[index], model_view);
+
+			pairs[i].depth = d;
+			pairs[i].index = index;
+			lo = std::min(lo, d);
+			hi = std::max(hi, d);
+		}
+
+		slice_min[slice] = lo;
+		slice_max[slice] = hi;
+	});
+
+	float dmin = *std::min_element(slice_min, slice_min + slices);
+	float dmax = *std::max_element(slice_max, slice_max + slices);
+	float scale = dmax > dmin ? (nb_buckets - 1) / (dmax - dmin) : 0.0f;
+
+	auto bucket = [&](float d) { return (size_t)((d - dmin) * scale); };
+
+	// 2. stable bucket scatter (per slice histograms turned into bucket major offsets)
+	histograms.assign(slices * nb_buckets, 0);
+
+	pool.ParallelFor(n, [&](size_t begin, size_t end, unsigned int slice) {
+		uint32_t* h = &histograms[slice * nb_buckets];
+
+		for(size_t i = begin; i < end; i++)
+			h[bucket(pairs[i].depth)]++;
+	});
+
+	// bucket_first[b] = first element of bucket b after the scatter
+	size_t* bucket_first = arena.Allocate<size_t>(nb_buckets + 1);
+	size_t sum = 0;
+
+	for(size_t b = 0; b < nb_buckets; b++) {
+		bucket_first[b] = sum;
+
+		for(unsigned int s = 0; s < slices; s++) {
+			uint32_t c = histograms[s * nb_buckets + b];
+			histograms[s * nb_buckets + b] = sum;
+			sum += c;
+		}
+	}
+
+	bucket_first[nb_buckets] = n;
+	scratch.resize(n);
+
+	pool.ParallelFor(n, [&](size_t begin, size_t end, unsigned int slice) {
+		uint32_t* offsets = &histograms[slice * nb_buckets];
+
+		for(size_t i = begin; i < end; i++)
+			scratch[offsets[bucket(pairs[i].depth)]++] = pairs[i];
+	});
+
+	// 3. each bucket keeps the previous frame order: almost sorted, insertion sort it,
+	// then its indices are final
+	uint8_t* incoherent = arena.Allocate<uint8_t>(nb_buckets);
+
+	pool.ParallelFor(nb_buckets, [&](size_t first_bucket, size_t last_bucket, unsigned int) {
+		for(size_t b = first_bucket; b < last_bucket; b++) {
+			size_t begin = bucket_first[b];
+			size_t end = bucket_first[b + 1];
+
+			size_t budget = (end - begin) * max_moves_per_point;
+			size_t moves = 0;
+
+			for(size_t i = begin + 1; i < end && moves <= budget; i++) {
+				DepthIndex e = scratch[i];
+				size_t j = i;
+
+				while(j > begin && scratch[j - 1].depth > e.depth) {
+					scratch[j] = scratch[j - 1];
+					j--;
+				}
+
+				scratch[j] = e;
+				moves += i - j;
+			}
+
+			// the bucket was not coherent with the previous frame
+			incoherent[b] = moves > budget;
+
+			if(!incoherent[b]) {
+				for(size_t i = begin; i < end; i++)
+					indices[i] = scratch[i].index;
+			}
+		}
+	});
+
+	size_t incoherent_points = 0;
+
+	for(size_t b = 0; b < nb_buckets; b++) {
+		if(incoherent[b])
+			incoherent_points += bucket_first[b + 1] - bucket_first[b];
+	}
+
+	// missed by the samples: most of the previous order is stale, the radix sort is cheaper
+	if(incoherent_points > n / 2)
+		return false;
+
+	if(incoherent_points) {
+		auto less = [](const DepthIndex& a, const DepthIndex& b) { return a.depth < b.depth; };
+
+		pool.ParallelFor(nb_buckets, [&](size_t first_bucket, size_t last_bucket, unsigned int) {
+			for(size_t b = first_bucket; b < last_bucket; b++) {
+				if(!incoherent[b])
+					continue;
+
+				std::sort(scratch.begin() + bucket_first[b], scratch.begin() + bucket_first[b + 1], less);
+
+				for(size_t i = bucket_first[b]; i < bucket_first[b + 1]; i++)
+					indices[i] = scratch[i].index;
+			}
+		});
+	}
+
+	return true;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#define GLM_ENABLE_EXPERIMENTAL
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+#include "morton.h"
+#include "worker_pool.h"
+
+/*---------------------------------------------------------------------------*/
+
+/*
+	Back to front ordering of the points for alpha blending.
+
+	The first frame (or after the point count changed) is a full radix sort of the view
+	depths. The next frames start from the previous order: the camera moves little between
+	two frames so that order is almost sorted. A few hundred points sampled along it tell
+	first whether it still is (the view jumped otherwise: straight to the full sort). Then
+	a single stable bucket pass of depth / index pairs over the previous order (the scatter
+	is then almost sequential) is followed by an insertion sort of each bucket, which only
+	has a few elements to move. Every pass runs on the worker pool. Buckets that need too
+	many moves are std::sort'ed, unless they hold most of the points: full sort again.
+*/
+
+class DepthSorter
+{
+	public:
+		DepthSorter(WorkerPool& pool = WorkerPool::Instance());
+		virtual ~DepthSorter() {}
+
+		// model_view: the matrix taking the points into view space (view * model)
+		// returns the point indices, farthest first
+		const std::vector<uint32_t>& Sort(const std::vector<glm::vec3>& points, const glm::mat4& model_view);
+
+		// same result without using the previous order (benchmark reference)
+		const std::vector<uint32_t>& FullSort(const std::vector<glm::vec3>& points, const glm::mat4& model_view);
+
+		void Reset() { indices.clear(); }
+
+	public:
+		// use the previous frame order (false: always full sort). Off by default: on dense
+		// clouds the points move by more than their depth spacing even at 0.1 degree per
+		// frame, the samples then send almost every frame to the full sort anyway (bench)
+		bool coherent;
+
+		// moves the insertion sort of a bucket may do (per element) before switching to std::sort
+		unsigned int max_moves_per_point;
+
+		// result of the last sort, the starting order of the next one
+		std::vector<uint32_t> indices;
+		bool last_was_full;
+
+	private:
+		// 8 bytes: the scatter and the insertion sort move as little as possible
+		struct DepthIndex
+		{
+			float depth;
+			uint32_t index;
+		};
+
+		// false: the previous order was of no use, indices must be rebuilt
+		bool IncrementalSort(const std::vector<glm::vec3>& points, const glm::mat4& model_view);
+
+		WorkerPool& pool;
+
+		glm::mat4 last_model_view;
+
+		// scratch buffers (kept between frames to avoid re-allocations)
+		std::vector<uint32_t> keys;
+		std::vector<uint32_t> values;
+		RadixScratch<uint32_t> radix;
+		std::vector<DepthIndex> pairs;
+		std::vector<DepthIndex> scratch;
+		std::vector<uint32_t> histograms;
+};
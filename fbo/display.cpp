@@ -1,4 +1,6 @@
 #include "display.h"
+#include "gl_state.h"
+#include "gl_debug.h"
 
 #include <vector> 
 #include <limits> 
@@ -47,6 +49,10 @@ MyDisplay::MyDisplay(int screen_width, int screen_height, bool fullscreen, bool
 		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 		//glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+
+		#ifdef GLFW_SHADER_GL_DEBUG
+			glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
+		#endif
 	}
 
     // check monitors
@@ -140,9 +146,12 @@ MyDisplay::MyDisplay(int screen_width, int screen_height, bool fullscreen, bool
         std::cout << glewGetErrorString(glewInit()) << std::endl;
     }
 
-    glEnable(GL_VERTEX_PROGRAM_POINT_SIZE_ARB);
-	glEnable(GL_POINT_SMOOTH);
-	glEnable(GL_DEPTH_TEST);
+    // KHR_debug callback (debug builds only)
+    GLDEBUG_INIT();
+
+    GLState::Get().Enable(GL_VERTEX_PROGRAM_POINT_SIZE_ARB);
+	GLState::Get().Enable(GL_POINT_SMOOTH);
+	GLState::Get().Enable(GL_DEPTH_TEST);
 
 	//glEnable(GL_POINT_SPRITE);
 	//glEnable(GL_CULL_FACE);
@@ -0,0 +1,152 @@
+#include "frame_arena.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+
+/*---------------------------------------------------------------------------*/
+
+static inline uintptr_t AlignUp(uintptr_t p, size_t alignment)
+{
+	return (p + alignment - 1) & ~(uintptr_t)(alignment - 1);
+}
+
+FrameArena::FrameArena(size_t capacity)
+{
+	block.reset(new unsigned char[capacity]);
+	offset = 0;
+	overflow_bytes = 0;
+
+	stats.capacity = capacity;
+}
+
+FrameArena::~FrameArena()
+{
+}
+
+/*---------------------------------------------------------------------------*/
+
+void* FrameArena::Allocate(size_t size, size_t alignment)
+{
+	uintptr_t base = (uintptr_t)block.get();
+	uintptr_t p = AlignUp(base + offset, alignment);
+
+	if(p + size <= base + stats.capacity) {
+		stats.used += p + size - (base + offset);
+		offset = p + size - base;
+
+		return (void*)p;
+	}
+
+	// does not fit: a block of its own, the main block grows at Reset()
+	size_t bytes = std::max(stats.capacity, size + alignment);
+
+	overflow.emplace_back(new unsigned char[bytes]);
+	overflow_bytes += bytes;
+	stats.used += size;
+
+	return (void*)AlignUp((uintptr_t)overflow.back().get(), alignment);
+}
+
+/*---------------------------------------------------------------------------*/
+
+void FrameArena::Reset()
+{
+	stats.high_water = std::max(stats.high_water, stats.used);
+
+	if(!overflow.empty()) {
+		overflow.clear();
+		overflow_bytes = 0;
+
+		size_t capacity = stats.capacity;
+
+		while(capacity < stats.high_water)
+			capacity *= 2;
+
+		block.reset(new unsigned char[capacity]);
+		stats.capacity = capacity;
+		stats.overflows++;
+	}
+
+	offset = 0;
+	stats.used = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+
+// frame counter shared by every thread, bumped by NextFrame()
+static std::atomic<uint64_t> current_frame(0);
+
+namespace
+{
+	struct ThreadArenas;
+
+	std::mutex registry_mutex;
+	std::vector<ThreadArenas*> registry;
+
+	struct ThreadArenas
+	{
+		FrameArena arenas[FrameArena::FRAMES_IN_FLIGHT];
+
+		// frame each arena was last reset for
+		uint64_t frames[FrameArena::FRAMES_IN_FLIGHT];
+
+		ThreadArenas()
+		{
+			for(auto& f : frames)
+				f = 0;
+
+			std::lock_guard<std::mutex> lock(registry_mutex);
+			registry.push_back(this);
+		}
+
+		~ThreadArenas()
+		{
+			std::lock_guard<std::mutex> lock(registry_mutex);
+			registry.erase(std::find(registry.begin(), registry.end(), this));
+		}
+	};
+}
+
+FrameArena& FrameArena::Current()
+{
+	static thread_local ThreadArenas local;
+
+	uint64_t frame = current_frame.load(std::memory_order_relaxed);
+	unsigned int slot = frame % FRAMES_IN_FLIGHT;
+
+	// first use in this frame: what the slot held FRAMES_IN_FLIGHT frames ago goes
+	if(local.frames[slot] != frame) {
+		local.arenas[slot].Reset();
+		local.frames[slot] = frame;
+	}
+
+	return local.arenas[slot];
+}
+
+void FrameArena::NextFrame()
+{
+	current_frame.fetch_add(1, std::memory_order_relaxed);
+}
+
+/*---------------------------------------------------------------------------*/
+
+void FrameArena::Report()
+{
+	std::lock_guard<std::mutex> lock(registry_mutex);
+
+	for(size_t t = 0; t < registry.size(); t++) {
+		size_t high_water = 0;
+		size_t capacity = 0;
+		unsigned int overflows = 0;
+
+		for(const FrameArena& arena : registry[t]->arenas) {
+			high_water = std::max(high_water, std::max(arena.stats.high_water, arena.stats.used));
+			capacity += arena.stats.capacity;
+			overflows += arena.stats.overflows;
+		}
+
+		printf("FrameArena: thread %zu, high water %zu KB per frame, %zu KB reserved, %u overflows\n", t, high_water / 1024, capacity / 1024, overflows);
+	}
+}
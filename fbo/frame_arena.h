@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
+/*---------------------------------------------------------------------------*/
+
+struct FrameArenaStats
+{
+	// bytes handed out since the last Reset()
+	size_t used = 0;
+
+	// largest frame so far, in bytes
+	size_t high_water = 0;
+
+	// main block size
+	size_t capacity = 0;
+
+	// frames that did not fit in the main block (the block grows at their Reset())
+	unsigned int overflows = 0;
+};
+
+/*
+	Linear allocator for the transient CPU data of a frame (temporary arrays, draw lists,
+	sort keys, cull results): allocations bump a pointer, nothing is freed individually,
+	Reset() gives everything back in O(1). No destructor is run.
+
+	A frame that does not fit gets extra blocks from the heap, the main block is then
+	grown to the high water mark at the next Reset(): once the working set is known,
+	a frame does not touch the heap any more.
+
+	Current() is the calling thread's arena of the current frame. Each thread has one
+	arena per frame in flight (FRAMES_IN_FLIGHT, as FrameUniforms::RING_SIZE), reset
+	lazily the first time the thread uses it in a new frame: what a frame allocates
+	stays valid until that frame's slot comes back, FRAMES_IN_FLIGHT frames later.
+
+		FrameArena& arena = FrameArena::Current();
+		glm::vec3* p = arena.Allocate<glm::vec3>(n);
+		std::vector<float, ArenaAllocator<float>> depths(n, 0.0f, arena);
+		...
+		FrameArena::NextFrame();   // render thread, once per frame
+*/
+
+class FrameArena
+{
+	public:
+		static const unsigned int FRAMES_IN_FLIGHT = 3;
+
+		FrameArena(size_t capacity = 256 * 1024);
+		virtual ~FrameArena();
+
+		FrameArena(const FrameArena&) = delete;
+		FrameArena& operator=(const FrameArena&) = delete;
+
+		void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+		// uninitialized storage for count T (trivial types, or constructed by the caller)
+		template<typename T>
+		T* Allocate(size_t count) { return static_cast<T*>(Allocate(count * sizeof(T), alignof(T))); }
+
+		void Reset();
+
+		const FrameArenaStats& Stats() const { return stats; }
+
+		// calling thread, current frame
+		static FrameArena& Current();
+
+		// starts a new frame for every thread
+		static void NextFrame();
+
+		// high water marks of every thread's arenas (at exit, the other threads idle)
+		static void Report();
+
+	private:
+		std::unique_ptr<unsigned char[]> block;
+		size_t offset;
+
+		// frames larger than the block
+		std::vector<std::unique_ptr<unsigned char[]>> overflow;
+		size_t overflow_bytes;
+
+		FrameArenaStats stats;
+};
+
+/*---------------------------------------------------------------------------*/
+
+// standard allocator on a FrameArena: deallocate does nothing, the memory goes back at Reset()
+template<typename T>
+class ArenaAllocator
+{
+	public:
+		typedef T value_type;
+
+		ArenaAllocator(FrameArena& arena = FrameArena::Current()) : arena(&arena) {}
+
+		template<typename U>
+		ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+		T* allocate(size_t n) { return arena->Allocate<T>(n); }
+		void deallocate(T*, size_t) {}
+
+		template<typename U>
+		bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+
+		template<typename U>
+		bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+
+		FrameArena* arena;
+};
+
+template<typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
@@ -0,0 +1,198 @@
+#include "frame_uniforms.h"
+#include "gl_state.h"
+#include "gl_debug.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+/*---------------------------------------------------------------------------*/
+
+static GLsizeiptr AlignUp(GLsizeiptr value, GLsizeiptr alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+/*---------------------------------------------------------------------------*/
+
+FrameUniforms::FrameUniforms(unsigned int max_objects)
+{
+	this->max_objects = max_objects;
+	this->nb_objects = 0;
+	this->uploads = 0;
+	this->segment = 0;
+	this->used = 0;
+	this->uploaded = 0;
+
+	// glBindBufferRange offsets must be multiples of this (256 on most hardware)
+	GLint alignment = 256;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+
+	this->frame_stride = AlignUp(sizeof(FrameData), alignment);
+	this->object_stride = AlignUp(sizeof(ObjectData), alignment);
+	this->object_segment_size = object_stride * max_objects;
+
+	for(unsigned int i = 0; i < RING_SIZE; i++)
+		fences[i] = 0;
+
+	staging.resize(object_segment_size);
+
+	glGenBuffers(1, &frame_ubo);
+	glBindBuffer(GL_UNIFORM_BUFFER, frame_ubo);
+	glBufferData(GL_UNIFORM_BUFFER, frame_stride * RING_SIZE, NULL, GL_DYNAMIC_DRAW);
+
+	glGenBuffers(1, &object_ubo);
+	glBindBuffer(GL_UNIFORM_BUFFER, object_ubo);
+	glBufferData(GL_UNIFORM_BUFFER, object_segment_size * RING_SIZE, NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	GLDEBUG_LABEL(GL_BUFFER, frame_ubo, "frame uniforms");
+	GLDEBUG_LABEL(GL_BUFFER, object_ubo, "object uniforms");
+}
+
+/*---------------------------------------------------------------------------*/
+
+FrameUniforms::~FrameUniforms()
+{
+	for(unsigned int i = 0; i < RING_SIZE; i++) {
+		if(fences[i])
+			glDeleteSync(fences[i]);
+	}
+
+	glDeleteBuffers(1, &frame_ubo);
+	glDeleteBuffers(1, &object_ubo);
+}
+
+/*---------------------------------------------------------------------------*/
+
+void FrameUniforms::BeginFrame(const FrameData& frame)
+{
+	segment = (segment + 1) % RING_SIZE;
+
+	// the GPU may still read this segment (frame - RING_SIZE), usually already signaled
+	if(fences[segment]) {
+		glClientWaitSync(fences[segment], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+		glDeleteSync(fences[segment]);
+		fences[segment] = 0;
+	}
+
+	uploads = 0;
+	nb_objects = 0;
+	uploaded = 0;
+	used = 0;
+
+	Write(frame_ubo, segment * frame_stride, sizeof(FrameData), &frame);
+
+	glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_BINDING, frame_ubo, segment * frame_stride, sizeof(FrameData));
+}
+
+/*---------------------------------------------------------------------------*/
+
+void FrameUniforms::EndFrame()
+{
+	Flush();
+
+	fences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+/*---------------------------------------------------------------------------*/
+
+unsigned int FrameUniforms::Push(const ObjectData& object)
+{
+	if(nb_objects >= max_objects) {
+		std::cout << "FrameUniforms: more than " << max_objects << " objects in a frame, the last slot is overwritten" << std::endl;
+		nb_objects = max_objects - 1;
+	}
+
+	GLsizeiptr offset = nb_objects * object_stride;
+
+	memcpy(&staging[offset], &object, sizeof(ObjectData));
+
+	// an already uploaded slot (overwritten) is written again
+	used = std::max(used, offset + object_stride);
+	uploaded = std::min(uploaded, offset);
+
+	return nb_objects++;
+}
+
+/*---------------------------------------------------------------------------*/
+
+void FrameUniforms::Write(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data)
+{
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+
+	// unsynchronized: the fence of BeginFrame() guarantees the GPU is not reading this segment
+	void* ptr = glMapBufferRange(GL_UNIFORM_BUFFER, offset, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+
+	if(ptr) {
+		memcpy(ptr, data, size);
+		glUnmapBuffer(GL_UNIFORM_BUFFER);
+	}
+	else {
+		glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data);
+	}
+
+	GLState::Get().CountUpload(size);
+
+	uploads++;
+}
+
+/*---------------------------------------------------------------------------*/
+
+void FrameUniforms::Flush()
+{
+	if(used <= uploaded)
+		return;
+
+	Write(object_ubo, segment * object_segment_size + uploaded, used - uploaded, &staging[uploaded]);
+
+	uploaded = used;
+}
+
+/*---------------------------------------------------------------------------*/
+
+void FrameUniforms::BindObject(unsigned int slot)
+{
+	GLsizeiptr offset = slot * object_stride;
+
+	if(offset + object_stride > uploaded)
+		Flush();
+
+	glBindBufferRange(GL_UNIFORM_BUFFER, OBJECT_BINDING, object_ubo, segment * object_segment_size + offset, sizeof(ObjectData));
+}
+
+/*---------------------------------------------------------------------------*/
+
+bool FrameUniforms::BindObjects(unsigned int first, unsigned int count)
+{
+	GLsizeiptr offset = first * object_stride;
+	GLsizeiptr size = count * object_stride;
+
+	if(offset + size > object_segment_size)
+		return false;
+
+	if(offset + size > uploaded)
+		Flush();
+
+	glBindBufferRange(GL_UNIFORM_BUFFER, OBJECTS_BINDING, object_ubo, segment * object_segment_size + offset, size);
+
+	return true;
+}
+
+/*---------------------------------------------------------------------------*/
+
+void FrameUniforms::BindBlocks(GLuint program)
+{
+	GLuint frame_block = glGetUniformBlockIndex(program, "FrameData");
+	GLuint object_block = glGetUniformBlockIndex(program, "ObjectData");
+	GLuint objects_block = glGetUniformBlockIndex(program, "ObjectArray");
+
+	if(frame_block != GL_INVALID_INDEX)
+		glUniformBlockBinding(program, frame_block, FRAME_BINDING);
+
+	if(object_block != GL_INVALID_INDEX)
+		glUniformBlockBinding(program, object_block, OBJECT_BINDING);
+
+	if(objects_block != GL_INVALID_INDEX)
+		glUniformBlockBinding(program, objects_block, OBJECTS_BINDING);
+}
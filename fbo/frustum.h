@@ -0,0 +1,39 @@
+#pragma once
+
+#define GLM_ENABLE_EXPERIMENTAL
+
+#include <glm/glm.hpp>
+
+/*---------------------------------------------------------------------------*/
+
+// frustum planes (Gribb / Hartmann) of a view projection matrix, normals pointing inside
+inline void ExtractPlanes(const glm::mat4& m, glm::vec4 planes[6])
+{
+	glm::vec4 row[4];
+
+	for(int r = 0; r < 4; r++)
+		row[r] = glm::vec4(m[0][r], m[1][r], m[2][r], m[3][r]);
+
+	planes[0] = row[3] + row[0];
+	planes[1] = row[3] - row[0];
+	planes[2] = row[3] + row[1];
+	planes[3] = row[3] - row[1];
+	planes[4] = row[3] + row[2];
+	planes[5] = row[3] - row[2];
+}
+
+/*---------------------------------------------------------------------------*/
+
+// false if the box is fully outside one of the planes
+inline bool BoxInFrustum(const glm::vec4 planes[6], const glm::vec3& bmin, const glm::vec3& bmax)
+{
+	for(int p = 0; p < 6; p++) {
+		// the box corner the farthest along the plane normal
+		glm::vec3 v(planes[p].x > 0 ? bmax.x : bmin.x, planes[p].y > 0 ? bmax.y : bmin.y, planes[p].z > 0 ? bmax.z : bmin.z);
+
+		if(planes[p].x * v.x + planes[p].y * v.y + planes[p].z * v.z + planes[p].w < 0)
+			return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,170 @@
+#include "gl_debug.h"
+
+#ifdef GLFW_SHADER_GL_DEBUG
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+bool GLDebug::enabled = false;
+
+/*---------------------------------------------------------------------------*/
+
+struct DebugCounter
+{
+	GLenum severity;
+	unsigned long count;
+	std::string message;
+};
+
+// (source, type, id)
+typedef std::tuple<GLenum, GLenum, GLuint> DebugKey;
+
+static std::mutex counters_mutex;
+static std::map<DebugKey, DebugCounter> counters;
+
+/*---------------------------------------------------------------------------*/
+
+static const char* SourceName(GLenum source)
+{
+	switch(source) {
+		case GL_DEBUG_SOURCE_API:             return "api";
+		case GL_DEBUG_SOURCE_WINDOW_SYSTEM:   return "window";
+		case GL_DEBUG_SOURCE_SHADER_COMPILER: return "compiler";
+		case GL_DEBUG_SOURCE_THIRD_PARTY:     return "third party";
+		case GL_DEBUG_SOURCE_APPLICATION:     return "application";
+		default:                              return "other";
+	}
+}
+
+static const char* TypeName(GLenum type)
+{
+	switch(type) {
+		case GL_DEBUG_TYPE_ERROR:               return "error";
+		case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "deprecated";
+		case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:  return "undefined";
+		case GL_DEBUG_TYPE_PORTABILITY:         return "portability";
+		case GL_DEBUG_TYPE_PERFORMANCE:         return "performance";
+		case GL_DEBUG_TYPE_MARKER:              return "marker";
+		default:                                return "other";
+	}
+}
+
+static const char* SeverityName(GLenum severity)
+{
+	switch(severity) {
+		case GL_DEBUG_SEVERITY_HIGH:   return "high";
+		case GL_DEBUG_SEVERITY_MEDIUM: return "medium";
+		case GL_DEBUG_SEVERITY_LOW:    return "low";
+		default:                       return "notification";
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+
+static void APIENTRY DebugCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void*)
+{
+	// our own push / pop group markers
+	if(type == GL_DEBUG_TYPE_PUSH_GROUP || type == GL_DEBUG_TYPE_POP_GROUP)
+		return;
+
+	std::lock_guard<std::mutex> lock(counters_mutex);
+
+	DebugKey key(source, type, id);
+	auto it = counters.find(key);
+
+	if(it != counters.end()) {
+		it->second.count++;
+		return;
+	}
+
+	counters[key] = { severity, 1, std::string(message, length > 0 ? length : strlen(message)) };
+
+	// first occurrence only
+	std::cout << "GL " << TypeName(type) << " [" << SourceName(source) << ", " << SeverityName(severity) << ", id " << id << "]: " << message << std::endl;
+}
+
+/*---------------------------------------------------------------------------*/
+
+void GLDebug::Init()
+{
+	if(!GLEW_KHR_debug && !GLEW_VERSION_4_3) {
+		std::cout << "GLDebug: KHR_debug not supported, instrumentation disabled" << std::endl;
+		return;
+	}
+
+	GLint flags = 0;
+	glGetIntegerv(GL_CONTEXT_FLAGS, &flags);
+
+	if(!(flags & GL_CONTEXT_FLAG_DEBUG_BIT))
+		std::cout << "GLDebug: not a debug context, the driver may report less" << std::endl;
+
+	glEnable(GL_DEBUG_OUTPUT);
+
+	// messages are reported in the thread / call that caused them
+	glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+
+	glDebugMessageCallback(DebugCallback, NULL);
+	glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, NULL, GL_TRUE);
+
+	enabled = true;
+}
+
+/*---------------------------------------------------------------------------*/
+
+void GLDebug::Report()
+{
+	if(!enabled)
+		return;
+
+	std::lock_guard<std::mutex> lock(counters_mutex);
+
+	std::vector<std::pair<DebugKey, DebugCounter>> sorted(counters.begin(), counters.end());
+
+	// performance first, then by count
+	std::sort(sorted.begin(), sorted.end(), [](const std::pair<DebugKey, DebugCounter>& a, const std::pair<DebugKey, DebugCounter>& b) {
+		bool pa = std::get<1>(a.first) == GL_DEBUG_TYPE_PERFORMANCE;
+		bool pb = std::get<1>(b.first) == GL_DEBUG_TYPE_PERFORMANCE;
+
+		if(pa != pb)
+			return pa;
+
+		return a.second.count > b.second.count;
+	});
+
+	std::cout << "--- GL debug messages (" << sorted.size() << " distinct)" << std::endl;
+
+	for(const auto& s : sorted) {
+		std::cout << s.second.count << "x " << TypeName(std::get<1>(s.first)) << " [" << SourceName(std::get<0>(s.first)) << ", "
+			<< SeverityName(s.second.severity) << ", id " << std::get<2>(s.first) << "]: " << s.second.message << std::endl;
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+
+void GLDebug::Label(GLenum identifier, GLuint name, const char* label)
+{
+	if(enabled)
+		glObjectLabel(identifier, name, -1, label);
+}
+
+/*---------------------------------------------------------------------------*/
+
+GLDebugGroup::GLDebugGroup(const char* name)
+{
+	if(GLDebug::enabled)
+		glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+}
+
+GLDebugGroup::~GLDebugGroup()
+{
+	if(GLDebug::enabled)
+		glPopDebugGroup();
+}
+
+#endif
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <GL/glew.h>
+
+/*---------------------------------------------------------------------------*/
+
+/*
+	KHR_debug instrumentation, built only with -DGLFW_SHADER_GL_DEBUG (cmake -DGL_DEBUG=ON,
+	or a Debug build). Otherwise every macro below expands to nothing.
+
+	GLDEBUG_INIT()                  after glewInit(): installs the glDebugMessageCallback
+	GLDEBUG_LABEL(type, name, str)  glObjectLabel (GL_BUFFER, GL_VERTEX_ARRAY, GL_PROGRAM, ...)
+	GLDEBUG_GROUP(str)              glPushDebugGroup until the end of the enclosing scope
+	GLDEBUG_REPORT()                prints the deduplicated message counters
+
+	Messages are deduplicated on (source, type, id): the first occurrence is printed, the
+	next ones are only counted. Performance messages (buffer moves, recompiles, stalls)
+	are what we are after, they are listed first in the report.
+*/
+
+#ifdef GLFW_SHADER_GL_DEBUG
+
+class GLDebug
+{
+	public:
+		static void Init();
+		static void Report();
+		static void Label(GLenum identifier, GLuint name, const char* label);
+
+		static bool enabled;
+};
+
+class GLDebugGroup
+{
+	public:
+		GLDebugGroup(const char* name);
+		~GLDebugGroup();
+};
+
+#define GLDEBUG_CONCAT_(a, b) a##b
+#define GLDEBUG_CONCAT(a, b) GLDEBUG_CONCAT_(a, b)
+
+#define GLDEBUG_INIT() GLDebug::Init()
+#define GLDEBUG_REPORT() GLDebug::Report()
+#define GLDEBUG_LABEL(identifier, name, label) GLDebug::Label(identifier, name, label)
+#define GLDEBUG_GROUP(name) GLDebugGroup GLDEBUG_CONCAT(gl_debug_group_, __LINE__)(name)
+
+#else
+
+#define GLDEBUG_INIT() do {} while(0)
+#define GLDEBUG_REPORT() do {} while(0)
+#define GLDEBUG_LABEL(identifier, name, label) do {} while(0)
+#define GLDEBUG_GROUP(name) do {} while(0)
+
+#endif
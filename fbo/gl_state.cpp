@@ -0,0 +1,193 @@
+#include "gl_state.h"
+
+// never a valid GL name: forces the first call of each kind through
+static const GLuint UNKNOWN = 0xffffffff;
+
+/*---------------------------------------------------------------------------*/
+
+GLState::GLState()
+{
+	Invalidate();
+}
+
+/*---------------------------------------------------------------------------*/
+
+GLState& GLState::Get()
+{
+	static GLState state;
+	return state;
+}
+
+/*---------------------------------------------------------------------------*/
+
+void GLState::Invalidate()
+{
+	program = UNKNOWN;
+	vao = UNKNOWN;
+	read_framebuffer = UNKNOWN;
+	draw_framebuffer = UNKNOWN;
+	active_unit = UNKNOWN;
+	depth_mask = -1;
+
+	for(unsigned int i = 0; i < MAX_TEXTURE_UNITS; i++)
+		textures_2d[i] = UNKNOWN;
+
+	for(auto& c : caps)
+		c.second = -1;
+}
+
+/*---------------------------------------------------------------------------*/
+
+void GLState::BeginFrame()
+{
+	last_frame = frame;
+	frame = FrameStats();
+}
+
+/*---------------------------------------------------------------------------*/
+
+template<typename T>
+bool GLState::Set(T& cached, T value)
+{
+	if(cached == value) {
+		frame.state_changes_avoided++;
+		return false;
+	}
+
+	cached = value;
+	frame.state_changes++;
+
+	return true;
+}
+
+/*---------------------------------------------------------------------------*/
+
+void GLState::UseProgram(GLuint program)
+{
+	if(Set(this->program, program))
+		glUseProgram(program);
+}
+
+/*---------------------------------------------------------------------------*/
+
+void GLState::BindVertexArray(GLuint vao)
+{
+	if(Set(this->vao, vao))
+		glBindVertexArray(vao);
+}
+
+/*---------------------------------------------------------------------------*/
+
+void GLState::BindFramebuffer(GLenum target, GLuint framebuffer)
+{
+	if(target == GL_FRAMEBUFFER) {
+		if(read_framebuffer == framebuffer && draw_framebuffer == framebuffer) {
+			frame.state_changes_avoided++;
+			return;
+		}
+
+		read_framebuffer = framebuffer;
+		draw_framebuffer = framebuffer;
+		frame.state_changes++;
+
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	}
+	else if(target == GL_READ_FRAMEBUFFER) {
+		if(Set(read_framebuffer, framebuffer))
+			glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	}
+	else if(target == GL_DRAW_FRAMEBUFFER) {
+		if(Set(draw_framebuffer, framebuffer))
+			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+
+void GLState::ActiveTexture(unsigned int unit)
+{
+	if(Set(active_unit, unit))
+		glActiveTexture(GL_TEXTURE0 + unit);
+}
+
+/*---------------------------------------------------------------------------*/
+
+void GLState::BindTexture(GLenum target, GLuint texture)
+{
+	// only 2D textures are tracked
+	if(target != GL_TEXTURE_2D || active_unit >= MAX_TEXTURE_UNITS) {
+		frame.state_changes++;
+		glBindTexture(target, texture);
+		return;
+	}
+
+	if(Set(textures_2d[active_unit], texture))
+		glBindTexture(target, texture);
+}
+
+/*---------------------------------------------------------------------------*/
+
+void GLState::SetCap(GLenum cap, bool enabled)
+{
+	for(auto& c : caps) {
+		if(c.first == cap) {
+			int value = enabled ? 1 : 0;
+
+			if(!Set(c.second, value))
+				return;
+
+			if(enabled)
+				glEnable(cap);
+			else
+				glDisable(cap);
+
+			return;
+		}
+	}
+
+	caps.push_back(std::make_pair(cap, enabled ? 1 : 0));
+	frame.state_changes++;
+
+	if(enabled)
+		glEnable(cap);
+	else
+		glDisable(cap);
+}
+
+void GLState::Enable(GLenum cap)
+{
+	SetCap(cap, true);
+}
+
+void GLState::Disable(GLenum cap)
+{
+	SetCap(cap, false);
+}
+
+/*---------------------------------------------------------------------------*/
+
+void GLState::DepthMask(GLboolean flag)
+{
+	if(Set(depth_mask, flag ? 1 : 0))
+		glDepthMask(flag);
+}
+
+/*---------------------------------------------------------------------------*/
+
+void GLState::DrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+	frame.draw_calls++;
+	frame.vertices += count;
+
+	glDrawArrays(mode, first, count);
+}
+
+/*---------------------------------------------------------------------------*/
+
+void GLState::DrawElements(GLenum mode, GLsizei count, GLenum type, const void* offset)
+{
+	frame.draw_calls++;
+	frame.vertices += count;
+
+	glDrawElements(mode, count, type, offset);
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <vector>
+
+/*---------------------------------------------------------------------------*/
+
+// counters of one frame
+struct FrameStats
+{
+	unsigned int draw_calls = 0;
+	size_t vertices = 0;
+
+	// binds / enables actually sent to GL, and the ones skipped because the state was already set
+	unsigned int state_changes = 0;
+	unsigned int state_changes_avoided = 0;
+
+	size_t bytes_uploaded = 0;
+};
+
+/*---------------------------------------------------------------------------*/
+
+/*
+	Shadow copy of the GL state the renderer touches (program, VAO, framebuffers, 2D
+	textures, enables, depth mask): a call that would not change anything is not sent to
+	the driver. Every bind of these objects must go through here, otherwise the cache is
+	wrong; call Invalidate() after foreign code touched the state.
+
+	Draw calls and uploads are counted too, BeginFrame() moves the counters to last_frame.
+*/
+
+class GLState
+{
+	public:
+		// the application has a single context
+		static GLState& Get();
+
+		void UseProgram(GLuint program);
+		void BindVertexArray(GLuint vao);
+
+		// GL_FRAMEBUFFER sets both the read and the draw binding
+		void BindFramebuffer(GLenum target, GLuint framebuffer);
+
+		void ActiveTexture(unsigned int unit);
+		void BindTexture(GLenum target, GLuint texture);
+
+		void Enable(GLenum cap);
+		void Disable(GLenum cap);
+		void DepthMask(GLboolean flag);
+
+		void DrawArrays(GLenum mode, GLint first, GLsizei count);
+		void DrawElements(GLenum mode, GLsizei count, GLenum type, const void* offset);
+		void CountUpload(size_t bytes) { frame.bytes_uploaded += bytes; }
+
+		// forget everything (the next calls are sent whatever the cached value)
+		void Invalidate();
+
+		void BeginFrame();
+
+	public:
+		FrameStats frame;
+		FrameStats last_frame;
+
+	private:
+		GLState();
+
+		// returns true when the cached value changed (the GL call must be sent)
+		template<typename T>
+		bool Set(T& cached, T value);
+
+		void SetCap(GLenum cap, bool enabled);
+
+		static const unsigned int MAX_TEXTURE_UNITS = 16;
+
+		GLuint program;
+		GLuint vao;
+		GLuint read_framebuffer;
+		GLuint draw_framebuffer;
+		unsigned int active_unit;
+		GLuint textures_2d[MAX_TEXTURE_UNITS];
+		int depth_mask;
+
+		// (cap, 0 / 1 / -1 unknown)
+		std::vector<std::pair<GLenum, int>> caps;
+};
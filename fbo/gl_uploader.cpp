@@ -0,0 +1,245 @@
+#include "gl_uploader.h"
+#include "gl_debug.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+// bytes per glBufferSubData: the driver copies a slice before the next one is queued
+static const size_t UPLOAD_SLICE = 32 << 20;
+
+/*---------------------------------------------------------------------------*/
+
+GLUploader::GLUploader(GLFWwindow* share)
+{
+	this->stop = false;
+	this->pending = 0;
+	this->uploaded_bytes = 0;
+	this->upload_seconds = 0.0;
+
+	// same context hints as the main window (still set), never shown
+	glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+	window = glfwCreateWindow(1, 1, "loader", NULL, share);
+	glfwWindowHint(GLFW_VISIBLE, GL_TRUE);
+
+	if(!window) {
+		std::cout << "ERROR::UPLOADER:: cannot create the shared context, uploads run on the render thread" << std::endl;
+		return;
+	}
+
+	thread = std::thread(&GLUploader::Loop, this);
+}
+
+GLUploader::~GLUploader()
+{
+	if(thread.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stop = true;
+		}
+
+		cv.notify_all();
+		thread.join();
+	}
+
+	// the render context is current: the objects of the jobs never polled go with it
+	for(Job& job : fenced)
+		glDeleteSync(job.fence);
+
+	if(window)
+		glfwDestroyWindow(window);
+}
+
+/*---------------------------------------------------------------------------*/
+
+void GLUploader::Submit(std::function<void()> upload, std::function<void()> ready)
+{
+	pending++;
+
+	// no shared context: same order of events, on this thread
+	if(!window) {
+		if(upload)
+			upload();
+
+		if(ready)
+			ready();
+
+		pending--;
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		queued.push_back({std::move(upload), std::move(ready), 0});
+	}
+
+	cv.notify_all();
+}
+
+/*---------------------------------------------------------------------------*/
+
+void GLUploader::Loop()
+{
+	TRACE_THREAD("loader");
+
+	glfwMakeContextCurrent(window);
+
+	while(true) {
+		Job job;
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			cv.wait(lock, [this]() { return stop || !queued.empty(); });
+
+			if(stop && queued.empty())
+				break;
+
+			job = std::move(queued.front());
+			queued.pop_front();
+		}
+
+		{
+			TRACE_SCOPE("upload");
+
+			if(job.upload)
+				job.upload();
+
+			// what the job captured (CPU copies) is released here, not on the render thread
+			job.upload = nullptr;
+		}
+
+		job.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+		// the fence must reach the GPU: the render context only polls it
+		glFlush();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			fenced.push_back(std::move(job));
+		}
+
+		cv.notify_all();
+	}
+
+	glfwMakeContextCurrent(NULL);
+}
+
+/*---------------------------------------------------------------------------*/
+
+void GLUploader::Complete(Job& job)
+{
+	glDeleteSync(job.fence);
+
+	if(job.ready)
+		job.ready();
+
+	pending--;
+}
+
+unsigned int GLUploader::Poll()
+{
+	unsigned int completed = 0;
+
+	// fences complete in submission order: stop at the first one still pending
+	while(true) {
+		Job job;
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			if(fenced.empty())
+				break;
+
+			GLenum status = glClientWaitSync(fenced.front().fence, 0, 0);
+
+			if(status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+				break;
+
+			job = std::move(fenced.front());
+			fenced.pop_front();
+		}
+
+		Complete(job);
+		completed++;
+	}
+
+	return completed;
+}
+
+void GLUploader::Finish()
+{
+	TRACE_SCOPE("upload finish");
+
+	while(pending) {
+		Job job;
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			cv.wait(lock, [this]() { return !fenced.empty(); });
+
+			job = std::move(fenced.front());
+			fenced.pop_front();
+		}
+
+		// blocking, flushes this context first
+		while(glClientWaitSync(job.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 100000000) == GL_TIMEOUT_EXPIRED)
+			continue;
+
+		Complete(job);
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+
+void GLUploader::UploadPoints(std::vector<glm::vec3> points, std::function<void(std::shared_ptr<PointBuffer>)> ready)
+{
+	// written by the loader thread, read by ready (ordered by the fenced queue lock)
+	auto result = std::make_shared<std::shared_ptr<PointBuffer>>();
+	auto data = std::make_shared<std::vector<glm::vec3>>(std::move(points));
+
+	Submit([this, result, data]()
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		size_t bytes = data->size() * sizeof(glm::vec3);
+
+		GLuint vbo;
+		glGenBuffers(1, &vbo);
+		glBindBuffer(GL_ARRAY_BUFFER, vbo);
+
+		// storage first, then the content slice by slice
+		glBufferData(GL_ARRAY_BUFFER, std::max(bytes, sizeof(glm::vec3)), NULL, GL_DYNAMIC_DRAW);
+
+		for(size_t offset = 0; offset < bytes; offset += UPLOAD_SLICE) {
+			glBufferSubData(GL_ARRAY_BUFFER, offset, std::min(UPLOAD_SLICE, bytes - offset), (const char*)data->data() + offset);
+			glFlush();
+		}
+
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		GLDEBUG_LABEL(GL_BUFFER, vbo, "points");
+
+		*result = std::make_shared<PointBuffer>(std::move(*data), vbo);
+
+		uploaded_bytes += bytes;
+		upload_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	},
+	[result, ready]()
+	{
+		ready(std::move(*result));
+	});
+}
+
+/*---------------------------------------------------------------------------*/
+
+void GLUploader::Retire(std::shared_ptr<PointBuffer> points)
+{
+	if(!points)
+		return;
+
+	auto retired = std::make_shared<std::shared_ptr<PointBuffer>>(std::move(points));
+
+	// glDeleteBuffers on the loader context: the render context no longer references it
+	Submit([retired]() { retired->reset(); }, nullptr);
+}
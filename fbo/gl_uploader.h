@@ -0,0 +1,99 @@
+#pragma once
+
+#define GLM_ENABLE_EXPERIMENTAL
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "point_buffer.h"
+
+/*---------------------------------------------------------------------------*/
+
+/*
+	Buffer / texture uploads on a thread of their own.
+
+	The loader thread owns a hidden window whose context shares its objects with the
+	main window. Each job creates and fills GL objects there, then a fence is put
+	behind its commands. The render thread polls the fences once per frame (never
+	waits on them): the ready callback of a job, run on the render thread, is the
+	first use of its objects, they are complete by then. Big buffers are written in
+	slices, each one flushed, so the GPU keeps interleaving the frames of the render
+	context with the transfer.
+
+		GLUploader uploader(display->mainWindow);   // main thread (GLFW), after the window
+		uploader.UploadPoints(std::move(cloud), [&](std::shared_ptr<PointBuffer> points) {
+			uploader.Retire(render->SwapPoints(points, chunks));
+		});
+		...
+		uploader.Poll();                              // every frame, before the draw
+
+	Upload jobs only make raw GL calls: GLState caches the render context.
+*/
+
+class GLUploader
+{
+	public:
+		// main thread: GLFW windows are created there
+		GLUploader(GLFWwindow* share);
+		virtual ~GLUploader();
+
+		// upload: on the loader thread, with its context current
+		// ready: on the render thread, from Poll() / Finish(), once the GPU has executed upload
+		void Submit(std::function<void()> upload, std::function<void()> ready);
+
+		// points are moved in, the PointBuffer adopting the filled buffer is handed to ready
+		void UploadPoints(std::vector<glm::vec3> points, std::function<void(std::shared_ptr<PointBuffer>)> ready);
+
+		// the last reference goes on the loader thread: the GL delete and the free of a big
+		// CPU copy stay off the frame loop
+		void Retire(std::shared_ptr<PointBuffer> points);
+
+		// render thread: runs the ready callbacks of the completed jobs, never blocks
+		// returns the number of callbacks run
+		unsigned int Poll();
+
+		// render thread: waits for every submitted job and runs its callback
+		void Finish();
+
+		// submitted, callback not run yet
+		unsigned int Pending() const { return pending; }
+
+	public:
+		// loader thread totals, read on the render thread after a ready callback
+		size_t uploaded_bytes;
+		double upload_seconds;
+
+	private:
+		struct Job
+		{
+			std::function<void()> upload;
+			std::function<void()> ready;
+			GLsync fence;
+		};
+
+		void Loop();
+		void Complete(Job& job);
+
+		GLFWwindow* window;
+		std::thread thread;
+
+		std::mutex mutex;
+		std::condition_variable cv;
+		bool stop;
+
+		// to the loader thread
+		std::deque<Job> queued;
+
+		// uploaded, waiting for their fence (render thread)
+		std::deque<Job> fenced;
+
+		unsigned int pending;
+};
@@ -0,0 +1,416 @@
+#include "ingest.h"
+#include "frame_arena.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <new>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// shared memory ring: batches in flight
+static const uint32_t RING_BATCHES = 4096;
+
+/*---------------------------------------------------------------------------*/
+
+PointIngest::PointIngest(const IngestConfig& config)
+{
+	this->config = config;
+
+	listen_fd = -1;
+	client_fd = -1;
+	stop = false;
+	staged_points = 0;
+	socket_dropped = 0;
+
+	ring = nullptr;
+	ring_size = 0;
+	ring_point_capacity = 0;
+	ring_batch_capacity = 0;
+
+	period_start = std::chrono::steady_clock::now();
+	period_points = 0;
+	latency_sum = 0.0;
+	latency_max = 0.0;
+	latency_count = 0;
+}
+
+PointIngest::~PointIngest()
+{
+	if(thread.joinable()) {
+		stop = true;
+
+		// unblocks the reads of the socket thread
+		int fd = client_fd;
+
+		if(fd >= 0)
+			shutdown(fd, SHUT_RDWR);
+
+		cv.notify_all();
+		thread.join();
+	}
+
+	if(listen_fd >= 0) {
+		close(listen_fd);
+		unlink(socket_path.c_str());
+	}
+
+	if(ring) {
+		munmap(ring, ring_size);
+		shm_unlink(shm_name.c_str());
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+
+bool PointIngest::Listen(const std::string& socket_path)
+{
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+
+	if(socket_path.size() >= sizeof(address.sun_path)) {
+		std::cout << "ERROR::INGEST:: socket path too long " << socket_path << std::endl;
+		return false;
+	}
+
+	strcpy(address.sun_path, socket_path.c_str());
+
+	// left over by a previous run
+	unlink(socket_path.c_str());
+
+	listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	if(listen_fd < 0 || bind(listen_fd, (sockaddr*)&address, sizeof(address)) < 0 || listen(listen_fd, 1) < 0) {
+		std::cout << "ERROR::INGEST:: cannot listen on " << socket_path << ": " << strerror(errno) << std::endl;
+
+		if(listen_fd >= 0)
+			close(listen_fd);
+
+		listen_fd = -1;
+		return false;
+	}
+
+	this->socket_path = socket_path;
+	thread = std::thread(&PointIngest::SocketLoop, this);
+
+	std::cout << "Ingest: listening on " << socket_path << std::endl;
+
+	return true;
+}
+
+/*---------------------------------------------------------------------------*/
+
+bool PointIngest::ReadFull(int fd, void* data, size_t size)
+{
+	char* p = (char*)data;
+
+	while(size) {
+		ssize_t n = read(fd, p, size);
+
+		if(n < 0 && errno == EINTR)
+			continue;
+
+		if(n <= 0)
+			return false;
+
+		p += n;
+		size -= n;
+	}
+
+	return true;
+}
+
+void PointIngest::SocketLoop()
+{
+	TRACE_THREAD("ingest");
+
+	while(!stop) {
+		// one producer at a time, the stop flag is checked between waits
+		pollfd listener = { listen_fd, POLLIN, 0 };
+
+		if(poll(&listener, 1, 100) <= 0)
+			continue;
+
+		int fd = accept(listen_fd, nullptr, nullptr);
+
+		if(fd < 0)
+			continue;
+
+		client_fd = fd;
+
+		PointFrameHeader header;
+
+		while(!stop && ReadFull(fd, &header, sizeof(header))) {
+			if(header.magic != POINT_FRAME_MAGIC || header.count > POINT_FRAME_MAX) {
+				std::cout << "ERROR::INGEST:: bad frame, producer disconnected" << std::endl;
+				break;
+			}
+
+			Batch batch;
+			batch.timestamp = header.timestamp;
+			batch.points.resize(header.count);
+
+			if(header.count && !ReadFull(fd, &batch.points[0], header.count * sizeof(glm::vec3)))
+				break;
+
+			std::unique_lock<std::mutex> lock(mutex);
+
+			// backpressure: the socket is not read until the renderer catches up, the producer blocks in write()
+			if(config.policy == INGEST_BLOCK)
+				cv.wait(lock, [this]() { return stop || staged_points < config.backlog; });
+
+			staged_points += batch.points.size();
+			staged.push_back(std::move(batch));
+
+			// drop policy: the freshest points are kept
+			while(config.policy == INGEST_DROP_OLDEST && staged_points > config.backlog && staged.size() > 1) {
+				staged_points -= staged.front().points.size();
+				socket_dropped += staged.front().points.size();
+				staged.pop_front();
+			}
+		}
+
+		client_fd = -1;
+		close(fd);
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+
+bool PointIngest::MapRing(const std::string& shm_name)
+{
+	// capacity: a power of two, at least the backlog
+	uint32_t capacity = 1;
+
+	while(capacity < config.backlog)
+		capacity <<= 1;
+
+	ring_size = PointRingSize(capacity, RING_BATCHES);
+
+	shm_unlink(shm_name.c_str());
+
+	int fd = shm_open(shm_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+
+	if(fd < 0 || ftruncate(fd, ring_size) < 0) {
+		std::cout << "ERROR::INGEST:: cannot create the shared memory " << shm_name << ": " << strerror(errno) << std::endl;
+
+		if(fd >= 0) {
+			close(fd);
+			shm_unlink(shm_name.c_str());
+		}
+
+		return false;
+	}
+
+	void* memory = mmap(nullptr, ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if(memory == MAP_FAILED) {
+		std::cout << "ERROR::INGEST:: cannot map the shared memory " << shm_name << std::endl;
+		shm_unlink(shm_name.c_str());
+		return false;
+	}
+
+	// zero filled by ftruncate: the counters start at 0, magic last (the producer waits for it)
+	ring = new(memory) PointRingHeader();
+	ring->version = POINT_RING_VERSION;
+	ring->point_capacity = capacity;
+	ring->batch_capacity = RING_BATCHES;
+
+	ring->magic.store(POINT_RING_MAGIC, std::memory_order_release);
+
+	this->shm_name = shm_name;
+	this->ring_point_capacity = capacity;
+	this->ring_batch_capacity = RING_BATCHES;
+
+	std::cout << "Ingest: shared memory ring " << shm_name << ", " << capacity << " points" << std::endl;
+
+	return true;
+}
+
+/*---------------------------------------------------------------------------*/
+
+unsigned int PointIngest::DrainSocket(PointBuffer& buffer)
+{
+	// the batch list is frame scratch, the points were allocated by the socket thread
+	ArenaVector<Batch> batches;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		size_t points = 0;
+
+		while(!staged.empty() && (batches.empty() || points + staged.front().points.size() <= config.points_per_frame)) {
+			points += staged.front().points.size();
+			batches.push_back(std::move(staged.front()));
+			staged.pop_front();
+		}
+
+		staged_points -= points;
+	}
+
+	cv.notify_all();
+
+	unsigned int appended = 0;
+
+	for(Batch& batch : batches) {
+		if(!batch.points.empty())
+			buffer.PushRing(&batch.points[0], batch.points.size(), config.max_points);
+
+		drained.push_back(batch.timestamp);
+		appended += batch.points.size();
+	}
+
+	stats.batches += batches.size();
+
+	return appended;
+}
+
+unsigned int PointIngest::DrainRing(PointBuffer& buffer)
+{
+	// the layout of MapRing(): the header is shared, its capacities could have been overwritten
+	PointRingBatch* batches = PointRingBatches(ring);
+	const glm::vec3* points = reinterpret_cast<const glm::vec3*>(batches + ring_batch_capacity);
+
+	uint64_t head = ring->batch_head.load(std::memory_order_acquire);
+	uint64_t tail = ring->batch_tail.load(std::memory_order_relaxed);
+
+	if(tail == head)
+		return 0;
+
+	// never more descriptors than the ring holds
+	if(head - tail > ring_batch_capacity)
+		head = tail + ring_batch_capacity;
+
+	unsigned int appended = 0;
+
+	// end of the points given back so far, batches never start behind it
+	uint64_t released = ring->point_tail.load(std::memory_order_relaxed);
+	uint64_t point_head = ring->point_head.load(std::memory_order_acquire);
+
+	// copied and checked as the batches below, the published points otherwise
+	PointRingBatch newest = batches[(head - 1) % ring_batch_capacity];
+	uint64_t end = newest.first <= point_head && newest.count <= point_head - newest.first ? newest.first + newest.count : point_head;
+
+	for(; tail < head; tail++) {
+		// copied: the other process cannot change it between the checks and the reads
+		PointRingBatch batch = batches[tail % ring_batch_capacity];
+
+		// written by another process: a descriptor outside the published points is dropped, never read
+		if(batch.count > ring_point_capacity || batch.first < released || batch.first > point_head || batch.count > point_head - batch.first) {
+			stats.dropped += std::min<uint64_t>(batch.count, ring_point_capacity);
+			continue;
+		}
+
+	// drop policy: skip what is older than the last backlog points
+		if(config.policy == INGEST_DROP_OLDEST && end - batch.first > config.backlog && tail + 1 < head) {
+			stats.dropped += batch.count;
+			released = batch.first + batch.count;
+			continue;
+		}
+
+		if(appended && appended + batch.count > config.points_per_frame)
+			break;
+
+		// straight from the mapping into the CPU mirror of the GL buffer, in two parts at the end of the ring
+		uint64_t offset = batch.first % ring_point_capacity;
+		uint64_t first_part = std::min<uint64_t>(batch.count, ring_point_capacity - offset);
+
+		buffer.PushRing(points + offset, first_part, config.max_points);
+
+		if(first_part < batch.count)
+			buffer.PushRing(points, batch.count - first_part, config.max_points);
+
+		drained.push_back(batch.timestamp);
+		appended += batch.count;
+		released = batch.first + batch.count;
+		stats.batches++;
+	}
+
+	// space back to the producer (up to the last valid batch consumed)
+	if(tail > ring->batch_tail.load(std::memory_order_relaxed)) {
+		ring->point_tail.store(released, std::memory_order_release);
+		ring->batch_tail.store(tail, std::memory_order_release);
+	}
+
+	return appended;
+}
+
+unsigned int PointIngest::Drain(PointBuffer& buffer)
+{
+	TRACE_SCOPE("ingest drain");
+
+	unsigned int appended = 0;
+
+	if(thread.joinable())
+		appended += DrainSocket(buffer);
+
+	if(ring)
+		appended += DrainRing(buffer);
+
+	stats.points += appended;
+	period_points += appended;
+
+	return appended;
+}
+
+/*---------------------------------------------------------------------------*/
+
+void PointIngest::Presented()
+{
+	if(drained.empty())
+		return;
+
+	uint64_t now = PointTimestamp();
+
+	for(uint64_t timestamp : drained) {
+		double ms = now > timestamp ? (now - timestamp) / 1e6 : 0.0;
+
+		latency_sum += ms;
+		latency_max = std::max(latency_max, ms);
+		latency_count++;
+	}
+
+	drained.clear();
+}
+
+/*---------------------------------------------------------------------------*/
+
+const IngestStats& PointIngest::Period()
+{
+	auto now = std::chrono::steady_clock::now();
+	double seconds = std::chrono::duration<double>(now - period_start).count();
+
+	stats.rate = seconds > 0.0 ? period_points / seconds : 0.0;
+	stats.latency_avg_ms = latency_count ? latency_sum / latency_count : 0.0;
+	stats.latency_max_ms = latency_max;
+
+	// the ring drops are counted by the producer
+	uint64_t dropped = 0;
+
+	if(thread.joinable()) {
+		std::lock_guard<std::mutex> lock(mutex);
+		dropped += socket_dropped;
+		socket_dropped = 0;
+	}
+
+	if(ring)
+		dropped += ring->dropped.exchange(0, std::memory_order_relaxed);
+
+	stats.dropped += dropped;
+
+	period_start = now;
+	period_points = 0;
+	latency_sum = 0.0;
+	latency_max = 0.0;
+	latency_count = 0;
+
+	return stats;
+}
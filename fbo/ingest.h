@@ -0,0 +1,135 @@
+#pragma once
+
+#define GLM_ENABLE_EXPERIMENTAL
+
+#include <glm/glm.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ingest_protocol.h"
+#include "point_buffer.h"
+
+/*---------------------------------------------------------------------------*/
+
+// the renderer falls behind (more than backlog points waiting)
+enum IngestPolicy
+{
+	INGEST_BLOCK,      // backpressure: the socket is not read, the ring stays full, the producer waits
+	INGEST_DROP_OLDEST // the oldest batches are dropped: bounded latency, the producer never waits
+};
+
+struct IngestConfig
+{
+	IngestPolicy policy = INGEST_BLOCK;
+
+	// whole batches, at least one per Drain()
+	unsigned int points_per_frame = 200000;
+
+	// points waiting (socket staging, ring: also its capacity) before the policy applies
+	unsigned int backlog = 2000000;
+
+	// PointBuffer budget: past it the newest points overwrite the oldest ones (PointBuffer::PushRing)
+	unsigned int max_points = 4000000;
+};
+
+struct IngestStats
+{
+	uint64_t points = 0;
+	uint64_t batches = 0;
+
+	// by the renderer (INGEST_DROP_OLDEST) and by the producer (full ring)
+	uint64_t dropped = 0;
+
+	// last period (Period())
+	double rate = 0.0; // points/s
+	double latency_avg_ms = 0.0; // acquisition -> buffer swap
+	double latency_max_ms = 0.0;
+};
+
+/*
+	Point batches from an acquisition process, appended to the PointBuffer once per frame.
+
+	Listen(): UNIX socket server, one producer at a time, read on a thread of its own into
+	a staging queue. MapRing(): shared memory ring, created here and mapped by the
+	producer, drained on the render thread straight into the PointBuffer (no staging).
+
+		ingest.Listen("/tmp/glfw_shader.sock");
+		...
+		ingest.Drain(*render->points);   // before the draw
+		...
+		glfwSwapBuffers();
+		ingest.Presented();               // latency of the drained batches
+*/
+
+class PointIngest
+{
+	public:
+		PointIngest(const IngestConfig& config = IngestConfig());
+		virtual ~PointIngest();
+
+		bool Listen(const std::string& socket_path);
+		bool MapRing(const std::string& shm_name);
+
+		// returns the number of points written (appended, or over the oldest ones once full)
+		unsigned int Drain(PointBuffer& buffer);
+
+		void Presented();
+
+		// rate / latency since the previous call, totals since the start
+		const IngestStats& Period();
+
+	public:
+		IngestConfig config;
+		IngestStats stats;
+
+	private:
+		struct Batch
+		{
+			uint64_t timestamp;
+			std::vector<glm::vec3> points;
+		};
+
+		void SocketLoop();
+		bool ReadFull(int fd, void* data, size_t size);
+
+		unsigned int DrainSocket(PointBuffer& buffer);
+		unsigned int DrainRing(PointBuffer& buffer);
+
+		// socket
+		std::string socket_path;
+		int listen_fd;
+		std::atomic<int> client_fd;
+		std::thread thread;
+		std::atomic<bool> stop;
+
+		std::mutex mutex;
+		std::condition_variable cv;
+		std::deque<Batch> staged;
+		size_t staged_points;
+		uint64_t socket_dropped;
+
+		// ring
+		std::string shm_name;
+		PointRingHeader* ring;
+		size_t ring_size;
+
+		// as set up by MapRing(), the shared header copies are not trusted
+		uint32_t ring_point_capacity;
+		uint32_t ring_batch_capacity;
+
+		// timestamps of the batches drained this frame (latency once presented)
+		std::vector<uint64_t> drained;
+
+		// period accumulators
+		std::chrono::steady_clock::time_point period_start;
+		uint64_t period_points;
+		double latency_sum;
+		double latency_max;
+		uint64_t latency_count;
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/*---------------------------------------------------------------------------*/
+
+/*
+	Wire formats of the point ingestion, shared by PointIngest (renderer) and
+	glfw_shader_producer (acquisition side). Both ends are on the same machine:
+	native endianness, timestamps in steady_clock nanoseconds (CLOCK_MONOTONIC, the
+	same time base in every process).
+
+	UNIX socket (SOCK_STREAM): frames of a PointFrameHeader followed by count points,
+	3 floats each.
+
+	Shared memory ring (shm_open, created by the renderer): a PointRingHeader, the
+	batch descriptors, then the points. Single producer, single consumer: the producer
+	writes the points and the descriptor of a batch, then publishes it by moving
+	batch_head (release). The consumer reads the published batches and gives the space
+	back by moving the tails. Full ring: the producer waits (backpressure) or drops
+	the batch and counts it in dropped.
+*/
+
+static const uint32_t POINT_FRAME_MAGIC = 0x31535450; // "PTS1"
+static const uint32_t POINT_FRAME_MAX = 1 << 20; // points per frame
+
+struct PointFrameHeader
+{
+	uint32_t magic;
+	uint32_t count;
+	uint64_t sequence;
+	uint64_t timestamp;
+};
+
+/*---------------------------------------------------------------------------*/
+
+static const uint32_t POINT_RING_MAGIC = 0x31474e52; // "RNG1"
+static const uint32_t POINT_RING_VERSION = 1;
+
+struct PointRingBatch
+{
+	// absolute index of the first point (modulo point_capacity in the ring)
+	uint64_t first;
+	uint32_t count;
+	uint32_t padding;
+	uint64_t sequence;
+	uint64_t timestamp;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "the ring counters are shared between processes");
+
+struct PointRingHeader
+{
+	// written last by the renderer (release): the ring is set up
+	std::atomic<uint32_t> magic;
+	uint32_t version;
+
+	// powers of two
+	uint32_t point_capacity;
+	uint32_t batch_capacity;
+
+	// producer side
+	alignas(64) std::atomic<uint64_t> point_head;
+	std::atomic<uint64_t> batch_head;
+	std::atomic<uint64_t> dropped;
+
+	// consumer side
+	alignas(64) std::atomic<uint64_t> point_tail;
+	std::atomic<uint64_t> batch_tail;
+};
+
+inline size_t PointRingSize(uint32_t point_capacity, uint32_t batch_capacity)
+{
+	return sizeof(PointRingHeader) + batch_capacity * sizeof(PointRingBatch) + point_capacity * 3 * sizeof(float);
+}
+
+inline PointRingBatch* PointRingBatches(PointRingHeader* ring)
+{
+	return reinterpret_cast<PointRingBatch*>(ring + 1);
+}
+
+inline float* PointRingPoints(PointRingHeader* ring)
+{
+	return reinterpret_cast<float*>(PointRingBatches(ring) + ring->batch_capacity);
+}
+
+inline uint64_t PointTimestamp()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -23,6 +23,33 @@ void Input::ProcessKeyboard(int key, int scancode, int action, int mods)
 			glfwSetWindowShouldClose(this->window, GL_TRUE);
 		}
 
+		// poster render of the current view, reset by the main loop
+		if (key == GLFW_KEY_P && action == GLFW_PRESS) {
+			poster = true;
+		}
+
+		// new point cloud loaded in the background, reset by the main loop
+		if (key == GLFW_KEY_N && action == GLFW_PRESS) {
+			reload = true;
+		}
+
+		// sequence playback, reset by the main loop (J / L repeat while held)
+		if (key == GLFW_KEY_K && action == GLFW_PRESS) {
+			play_toggle = true;
+		}
+		if (key == GLFW_KEY_J && action != GLFW_RELEASE) {
+			play_seek--;
+		}
+		if (key == GLFW_KEY_L && action != GLFW_RELEASE) {
+			play_seek++;
+		}
+		if (key == GLFW_KEY_MINUS && action == GLFW_PRESS) {
+			play_speed--;
+		}
+		if (key == GLFW_KEY_EQUAL && action == GLFW_PRESS) {
+			play_speed++;
+		}
+
 		// KEY PRESS
 		if (glfwGetKey(this->window, GLFW_KEY_UP) == GLFW_PRESS) {
 			forward = true;
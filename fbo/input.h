@@ -24,6 +24,14 @@ class Input
 			glfwSetCursorPosCallback(w, func);
 
     		glfwSetKeyCallback(w, ProcessKeyboardCB);
+
+			// the window content was damaged (exposed, restored): it has to be presented again
+			auto refresh_func = [](GLFWwindow* w)
+			{
+				static_cast<Input*>(glfwGetWindowUserPointer(w))->refresh = true;
+			};
+
+			glfwSetWindowRefreshCallback(w, refresh_func);
 		}
 
 		virtual ~Input() {}
@@ -59,4 +67,18 @@ class Input
 
 		bool stop_motion = false;
 
+		// set by the window refresh callback, reset by the main loop
+		bool refresh = false;
+
+		// P key
+		bool poster = false;
+
+		// N key
+		bool reload = false;
+
+		// sequence playback, reset by the main loop: K pause / play, J / L seek -1 / +1 s, - / = speed / 2, x 2
+		bool play_toggle = false;
+		int play_seek = 0;
+		int play_speed = 0;
+
 };
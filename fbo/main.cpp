@@ -3,8 +3,33 @@
 #include "input.h"
 #include "shader.h"
 #include "render.h"
+#include "morton.h"
+#include "depth_sort.h"
+#include "multi_view.h"
+#include "frame_uniforms.h"
+#include "progressive.h"
+#include "change_tracker.h"
+#include "occlusion.h"
+#include "poster.h"
+#include "soft_raster.h"
+#include "regress.h"
+#include "gl_state.h"
+#include "gl_debug.h"
+#include "trace.h"
+#include "alloc_count.h"
+#include "frame_arena.h"
+#include "startup.h"
+#include "mesh.h"
+#include "ingest.h"
+#include "gl_uploader.h"
+#include "sequence.h"
+#include "cloud_file.h"
 
+#include <algorithm>
+#include <chrono>
+#include <future>
 #include <sstream>
+#include <cstring>
 #include <vector>
 #include <memory>
 
@@ -22,6 +47,7 @@ float xrand(float xl, float xh)
 	return (xl + (xh - xl) *  drand48() ); 
 }
 
+
 // --------------------------------------------------------------------------------------------
 
 // screen globals
@@ -29,8 +55,89 @@ const int screen_width = 1280;  // for non fullscreen
 const int screen_height = 800; // for non fullscreen
 bool fullscreen = false; // if true display->screen_width / screen_height are overwritten by monitor size
 bool vsync = true;
+bool idle_wait = false; // nothing changed: no render, block in glfwWaitEventsTimeout instead of polling
+double idle_timeout = 0.5; // seconds
 bool osr_framebuffer = false;
 
+// offscreen target globals (osr_framebuffer only)
+ColorFormat osr_color_format = COLOR_RGBA8; // COLOR_R11F_G11F_B10F, COLOR_RGBA16F
+bool osr_depth = true;
+bool osr_stencil = false;
+int osr_samples = 0; // > 1: MSAA, resolved with glBlitFramebuffer
+bool post_shader = true; // false: blit the offscreen target to the screen instead of the quad pass
+
+// spatial ordering globals (Morton sort of the points before the upload)
+bool morton_order = true;
+bool morton_wide_codes = false; // 63-bit codes instead of 30-bit
+unsigned int chunk_size = 4096;
+
+// blending globals (back to front sorted points)
+bool blend_points = false;
+float point_alpha = 0.3f;
+
+// multi-view globals (2x2: camera, top, side, front), drawn from a single submission
+bool multi_view = false;
+bool multi_view_bench = false; // GPU time of the multi-view path vs N naive passes, printed at startup
+
+// progressive globals (osr_framebuffer only): a point budget per frame accumulated while the view does not change
+bool progressive = false;
+unsigned int progressive_points_per_frame = 1000000;
+
+// occlusion culling globals (Morton chunks only): box queries + conditional render
+bool occlusion_culling = false;
+unsigned int occlusion_nearest = 16; // nearest chunks always drawn as occluders
+
+// live points globals (simulates a scanner streaming points into the PointBuffer)
+bool live_points = false;
+unsigned int live_points_per_frame = 500;
+unsigned int live_points_max = 200000;
+
+// point ingestion globals: batches streamed by an acquisition process (glfw_shader_producer) instead of the generated live points,
+// "--ingest-socket <path>" / "--ingest-shm <name>", the oldest points are overwritten past ingest_points_max
+string ingest_socket = ""; // UNIX socket path, e.g. "/tmp/glfw_shader.sock"
+string ingest_shm = ""; // shared memory ring, e.g. "/glfw_shader_points"
+IngestPolicy ingest_policy = INGEST_BLOCK; // INGEST_DROP_OLDEST: bounded latency when the renderer falls behind
+unsigned int ingest_points_per_frame = 200000;
+unsigned int ingest_backlog = 2000000;
+unsigned int ingest_points_max = 4000000;
+
+// poster globals: P key renders the current view, "--poster <file.ppm> <width> <height>" renders at startup and exits
+string poster_path = "poster.ppm";
+int poster_width = 16384;
+int poster_height = 10240;
+int poster_tile_width = 4096;
+int poster_tile_height = 256;
+
+// CPU rasterizer globals: "--soft <file.ppm> <width> <height>" renders without window nor GL context and exits
+bool soft_check = false; // startup: differing pixels between the CPU and GL images of the first frame
+int soft_tolerance = 8; // per channel
+
+// mesh globals: indexed triangles drawn with the points ("--mesh <file.obj|file.mesh>"), an .obj is optimized and cached as <file>.obj.mesh
+string mesh_path = "";
+bool mesh_optimize = true; // vertex cache, overdraw and vertex fetch order
+bool mesh_bench = false; // GPU time of the loaded vs the optimized order, printed at startup
+
+// background upload globals: a hidden context sharing the window objects fills the point buffers on a thread of its own,
+// N key: a new cloud of reload_points points is generated and uploaded meanwhile, then swapped in (no frame waits for it)
+bool background_upload = true;
+unsigned int reload_points = 20000000;
+
+// point cloud file globals: "--cloud <file.pcf>" (written by glfw_shader_convert) replaces the generated cloud,
+// its points are Morton sorted and chunked already
+string cloud_path = "";
+bool cloud_clip = false; // only the chunks crossing the clip box are read
+glm::vec3 cloud_clip_min = glm::vec3(-1.0f);
+glm::vec3 cloud_clip_max = glm::vec3(1.0f);
+
+// sequence globals: "--sequence <dir>" plays a recorded scan back, one frame file per cloud (KITTI velodyne .bin) read ahead on I/O threads,
+// K: pause / play, J / L: -1 / +1 s, - / =: half / double speed
+string sequence_dir = "";
+double sequence_rate = 10.0; // recorded frames per second
+float sequence_scale = 1.0f / 40.0f; // meters -> the view of the [-1, 1] cube
+unsigned int sequence_prefetch = 8; // frames read ahead
+unsigned int sequence_io_threads = 2;
+bool sequence_loop = true;
+
 // camera globals
 float keyboard_sensitivity = 0.01f;
 float mouse_sensitivity = 0.1f;
@@ -39,135 +146,1062 @@ float zfar = 100.0f;
 float fov = 45.0f;
 glm::vec3 camera_pos = glm::vec3(0, 0, 5);
 
+// --------------------------------------------------------------------------------------------
+
+struct Cloud
+{
+	vector<glm::vec3> points;
+	vector<PointChunk> chunks;
+};
+
+// N key: random cloud in the [-1, 1] cube, Morton sorted (same options as the startup cloud), off the frame loop
+Cloud GenerateCloud(unsigned int nb_points, bool build_chunks)
+{
+	Cloud cloud;
+	cloud.points.resize(nb_points);
+
+	// a pool of its own: the frame's ParallelFor (depth sort) does not queue behind these slices
+	WorkerPool pool(max(1u, thread::hardware_concurrency() / 2));
+
+	// erand48: one state per slice, drand48 belongs to the frame loop
+	pool.ParallelFor(nb_points, [&](size_t begin, size_t end, unsigned int slice) {
+		unsigned short seed[3] = { (unsigned short)slice, (unsigned short)nb_points, (unsigned short)time(NULL) };
+
+		for(size_t i = begin; i < end; i++) {
+			cloud.points[i] = glm::vec3(2.0 * erand48(seed) - 1.0, 2.0 * erand48(seed) - 1.0, 2.0 * erand48(seed) - 1.0);
+		}
+	});
+
+	if(::morton_order) {
+		MortonOrder morton(::morton_wide_codes, pool);
+		morton.Sort(cloud.points);
+
+		if(build_chunks) {
+			cloud.chunks = morton.BuildChunks(cloud.points, ::chunk_size);
+		}
+	}
+
+	return cloud;
+}
+
 
 int main(int argc, char* argv[])
 {     
-	auto display = make_shared<MyDisplay>(::screen_width, ::screen_height, ::fullscreen, ::vsync);
+	TRACE_THREAD("main");
 
-	srand(time(NULL));
+	bool poster_only = false;
+	bool soft_only = false;
+	string soft_path;
+	int soft_width = 0;
+	int soft_height = 0;
+
+	if(argc >= 5 && strcmp(argv[1], "--poster") == 0) {
+		::poster_path = argv[2];
+		::poster_width = atoi(argv[3]);
+		::poster_height = atoi(argv[4]);
+		poster_only = true;
+
+		if(::poster_width <= 0 || ::poster_height <= 0) {
+			cout << "usage: " << argv[0] << " --poster <file.ppm> <width> <height>" << endl;
+			return 1;
+		}
+	}
+
+	// golden images + frame times of fixed scenes (see regress.sh), "--update" records them again
+	string regress_dir;
+	bool regress_update = false;
+
+	if(argc >= 3 && strcmp(argv[1], "--regress") == 0) {
+		regress_dir = argv[2];
+		regress_update = argc >= 4 && strcmp(argv[3], "--update") == 0;
+
+		// deterministic data and target: same cloud every run, 8 bit offscreen image, no MSAA, not vsync bound
+		srand48(1234);
+		::osr_framebuffer = true;
+		::osr_color_format = COLOR_RGBA8;
+		::osr_samples = 0;
+		::live_points = false;
+		::vsync = false;
+		::fullscreen = false;
+	}
+
+	if(argc >= 3 && strcmp(argv[1], "--mesh") == 0) {
+		::mesh_path = argv[2];
+	}
+
+	if(argc >= 3 && strcmp(argv[1], "--ingest-socket") == 0) {
+		::ingest_socket = argv[2];
+	}
+
+	if(argc >= 3 && strcmp(argv[1], "--ingest-shm") == 0) {
+		::ingest_shm = argv[2];
+	}
+
+	if(argc >= 3 && strcmp(argv[1], "--cloud") == 0) {
+		::cloud_path = argv[2];
+	}
+
+	if(argc >= 3 && strcmp(argv[1], "--sequence") == 0) {
+		::sequence_dir = argv[2];
+		::live_points = false;
+	}
+
+	bool ingest_points = !::ingest_socket.empty() || !::ingest_shm.empty();
+
+	if(argc >= 5 && strcmp(argv[1], "--soft") == 0) {
+		soft_path = argv[2];
+		soft_width = atoi(argv[3]);
+		soft_height = atoi(argv[4]);
+		soft_only = true;
+
+		if(soft_width <= 0 || soft_height <= 0) {
+			cout << "usage: " << argv[0] << " --soft <file.ppm> <width> <height>" << endl;
+			return 1;
+		}
+	}
+
+	// startup: data generation and file reads on workers while the window and the context come up
+	StartupGraph startup;
 
 	// cube vertices
 	vector<glm::vec3> cube;
+	vector<PointChunk> chunks;
+
+	// .pcf: sorted and chunked by the converter (the generated cloud otherwise)
+	bool cloud_loaded = false;
+
+	int points_stage = startup.Add("points", {}, [&]()
+	{
+		if(!::cloud_path.empty()) {
+			CloudFile file;
+
+			if(file.Open(::cloud_path)) {
+				// chunks outside the clip box: decided from the chunk table, never read
+				function<bool(const glm::vec3&, const glm::vec3&)> keep;
+
+				if(::cloud_clip) {
+					keep = [](const glm::vec3& bmin, const glm::vec3& bmax)
+					{
+						return bmin.x <= ::cloud_clip_max.x && bmin.y <= ::cloud_clip_max.y && bmin.z <= ::cloud_clip_max.z &&
+							bmax.x >= ::cloud_clip_min.x && bmax.y >= ::cloud_clip_min.y && bmax.z >= ::cloud_clip_min.z;
+					};
+				}
+
+				unsigned int skipped = file.Load(cube, chunks, keep);
+				cloud_loaded = true;
+
+				printf("CloudFile: %zu points, %zu chunks read (%u skipped)\n", cube.size(), chunks.size(), skipped);
+				return;
+			}
+		}
+
+		for(unsigned int i = 0; i < 10000; i++) {
+			cube.push_back(glm::vec3(xrand(-1.0, 1.0), xrand(-1.0, 1.0), xrand(-1.0, 1.0)));
+		}
+	});
+
+	// sort along a Z-order curve: spatially coherent buffer + contiguous chunks
+	MortonOrder morton(::morton_wide_codes);
+
+	int morton_stage = startup.Add("morton", {points_stage}, [&]()
+	{
+		if(cloud_loaded) {
+			// chunk ranges are only valid as long as the points are not edited
+			if(::live_points || ingest_points) {
+				chunks.clear();
+			}
+		}
+		else if(::morton_order) {
+			morton.Sort(cube);
+
+			// chunk ranges are only valid as long as the points are not edited
+			if(!::live_points && !ingest_points) {
+				chunks = morton.BuildChunks(cube, ::chunk_size);
+			}
+		}
+	});
+
+	shared_ptr<MyDisplay> display;
+	shared_ptr<Input> input;
+	shared_ptr<Render> render;
+	shared_ptr<Shader> scene_shader;
+	shared_ptr<Shader> quad_screen_shader;
+	shared_ptr<Shader> mesh_shader;
+	shared_ptr<GLUploader> uploader;
+
+	// triangle mesh (mesh_path), original: as loaded, for mesh_bench
+	Mesh mesh;
+	Mesh mesh_original;
+	MeshStats mesh_stats;
+	bool mesh_loaded = false;
+
+	// no window nor GL context for the CPU rasterizer
+	if(!soft_only) {
+		ShaderSource scene_source;
+		ShaderSource quad_source;
+		ShaderSource mesh_source;
+
+		int files_stage = startup.Add("shader files", {}, [&]()
+		{
+			scene_source = Shader::Load("../shaders/scene_vs.glsl", "../shaders/scene_fs.glsl");
+			quad_source = Shader::Load("../shaders/quad_vs.glsl", "../shaders/quad_fs.glsl");
+
+			if(!::mesh_path.empty()) {
+				mesh_source = Shader::Load("../shaders/mesh_vs.glsl", "../shaders/mesh_fs.glsl");
+			}
+		});
 
-    for(unsigned int i = 0; i < 10000; i++) {
-		cube.push_back(glm::vec3(xrand(-1.0, 1.0), xrand(-1.0, 1.0), xrand(-1.0, 1.0)));
+		// glfwInit, monitors, window, context, GLEW (GLFW: main thread only)
+		int window_stage = startup.AddMain("window", {}, [&]()
+		{
+			display = make_shared<MyDisplay>(::screen_width, ::screen_height, ::fullscreen, ::vsync);
+
+			// keyboard / mouse callbacks binded to display->mainWindow
+			input = make_shared<Input>(display->mainWindow);
+		});
+
+		startup.AddMain("shaders", {window_stage, files_stage}, [&]()
+		{
+			// scene shader
+			scene_shader = make_shared<Shader>(scene_source);
+
+			if(!::mesh_path.empty()) {
+				mesh_shader = make_shared<Shader>(mesh_source);
+			}
+
+			// quad screen shader
+			quad_screen_shader = make_shared<Shader>(quad_source);
+			quad_screen_shader -> Use();
+			quad_screen_shader -> setInt("screenTexture", 0);
+			//glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+		});
+
+		// hidden window sharing the objects of the main one (GLFW: main thread only)
+		int loader_stage = startup.AddMain("loader context", {window_stage}, [&]()
+		{
+			if(::background_upload) {
+				uploader = make_shared<GLUploader>(display->mainWindow);
+			}
+		});
+
+		// data vao/vbo
+		int upload_stage = startup.AddMain("upload", {window_stage, loader_stage, morton_stage}, [&]()
+		{
+			FramebufferDesc fb_desc;
+			fb_desc.color_format = ::osr_color_format;
+			fb_desc.depth = ::osr_depth;
+			fb_desc.stencil = ::osr_stencil;
+			fb_desc.samples = ::osr_samples;
+
+			if(uploader) {
+				// the points go through the loader context while the next main stages (shaders, mesh) run
+				render = make_shared<Render>(vector<glm::vec3>(), display->screen_width, display->screen_height, ::osr_framebuffer, fb_desc);
+
+				uploader -> UploadPoints(std::move(cube), [&](shared_ptr<PointBuffer> points)
+				{
+					uploader -> Retire(render -> SwapPoints(points, chunks));
+				});
+			}
+			else {
+				render = make_shared<Render>(cube, display->screen_width, display->screen_height, ::osr_framebuffer, fb_desc);
+				render -> chunks = chunks;
+			}
+		});
+
+		// triangle mesh: parse + optimize (or cache read) on a worker, upload once the render exists
+		if(!::mesh_path.empty()) {
+			int mesh_stage = startup.Add("mesh", {}, [&]()
+			{
+				mesh_loaded = LoadMesh(::mesh_path, ::mesh_optimize, mesh, mesh_stats, ::mesh_bench ? &mesh_original : nullptr);
+			});
+
+			startup.AddMain("mesh upload", {upload_stage, mesh_stage}, [&]()
+			{
+				if(mesh_loaded) {
+					render -> UploadMesh(mesh);
+				}
+			});
+		}
+
+		startup.Run();
+
+		// the first frame (and the regression, poster, bench modes) draws the whole cloud
+		if(uploader) {
+			uploader -> Finish();
+		}
 	}
+	else {
+		startup.Run();
 
-	// keyboard / mouse callbacks binded to display->mainWindow
-	auto input = make_shared<Input>(display->mainWindow);
+		// GPU-less render of the first frame view
+		Camera soft_camera(::camera_pos, ::fov, (float)soft_width / (float)soft_height, ::znear, ::zfar, ::mouse_sensitivity, ::keyboard_sensitivity);
+		SoftRasterizer raster(soft_width, soft_height);
 
-	// data vao/vbo
-	auto render = make_shared<Render>(cube, display->screen_width, display->screen_height, ::osr_framebuffer);
+		auto start = chrono::steady_clock::now();
+		raster.Draw(cube, soft_camera.GetViewProjection());
+		double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
 
-	// scene shader
-	auto scene_shader = make_shared<Shader>("../shaders/scene_vs.glsl", "../shaders/scene_fs.glsl");
+		cout << "SoftRasterizer: " << cube.size() << " points (" << raster.visible << " visible) in " << seconds * 1e3 << " ms" << endl;
 
-	// quad screen shader
-	auto quad_screen_shader = make_shared<Shader>("../shaders/quad_vs.glsl", "../shaders/quad_fs.glsl");
-	quad_screen_shader -> Use();
-	quad_screen_shader -> setInt("screenTexture", 0);
-	//glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+		return raster.WritePPM(soft_path) ? 0 : 1;
+	}
+
+	srand(time(NULL));
 
 	// camera
 	auto camera = make_shared<Camera>(::camera_pos, ::fov, (float)display->screen_width/(float)display->screen_height, ::znear, ::zfar, ::mouse_sensitivity, ::keyboard_sensitivity);
 
+	// per-frame / per-object uniform blocks shared by the programs
+	FrameUniforms uniforms;
+	FrameData frame_data;
+
+	frame_data.viewport = glm::vec4(display->screen_width, display->screen_height, 1.0f / display->screen_width, 1.0f / display->screen_height);
+
+	// back to front order, re-sorted from the previous frame order
+	DepthSorter depth_sorter;
+
+	// chunk occlusion queries
+	shared_ptr<OcclusionCuller> occlusion;
+
+	if(::occlusion_culling) {
+		occlusion = make_shared<OcclusionCuller>(::occlusion_nearest);
+	}
+
+	// accumulates into custom_framebuffer: needs the offscreen target
+	ProgressiveRender progressive(::progressive_points_per_frame);
+
+	if(::progressive && !::osr_framebuffer) {
+		cout << "progressive rendering needs osr_framebuffer, disabled" << endl;
+		::progressive = false;
+	}
+
+	// 2x2 views
+	shared_ptr<MultiView> multi;
+	vector<View> views(4);
+
+	if(::multi_view) {
+		multi = make_shared<MultiView>("../shaders/scene_fs.glsl", uniforms);
+
+		int w = display->screen_width / 2;
+		int h = display->screen_height / 2;
+
+		for(unsigned int v = 0; v < views.size(); v++) {
+			views[v].x = (v % 2) * w;
+			views[v].y = (1 - v / 2) * h;
+			views[v].width = w;
+			views[v].height = h;
+		}
+
+		// the tiles have the aspect ratio of the screen: the camera projection is reused
+		glm::mat4 projection = camera->GetProjection();
+		views[1].view_projection = projection * glm::lookAt(glm::vec3(0, 5, 0), glm::vec3(0, 0, 0), glm::vec3(0, 0, -1));
+		views[2].view_projection = projection * glm::lookAt(glm::vec3(5, 0, 0), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
+		views[3].view_projection = projection * glm::lookAt(glm::vec3(0, 0, 5), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
+		views[0].view_projection = camera->GetViewProjection();
+
+		if(::multi_view_bench) {
+			render -> Sync();
+			frame_data.view = camera->GetView();
+			frame_data.projection = camera->GetProjection();
+			frame_data.view_projection = camera->GetViewProjection();
+			frame_data.time = glfwGetTime();
+
+			multi -> Benchmark(*render, *scene_shader, uniforms, frame_data, views, glm::mat4(1.0f), 100);
+		}
+	}
+
+	// mesh fitted in the [-1, 1] cube of the points
+	glm::mat4 mesh_fit = mesh.FitMatrix();
+
+	if(mesh_loaded) {
+		cout << "Mesh: " << mesh.vertices.size() << " vertices, " << mesh.NbTriangles() << " triangles, ACMR " << mesh_stats.acmr_before << " -> " << mesh_stats.acmr_after
+			<< ", " << (mesh_stats.from_cache ? "read from the cache" : "loaded") << " in " << mesh_stats.load_ms << " ms, optimized in " << mesh_stats.optimize_ms << " ms" << endl;
+	}
+
+	// GPU time of the same draw with the order as loaded, then optimized (default framebuffer)
+	if(mesh_loaded && ::mesh_bench) {
+		const int frames = 100;
+		const Mesh* orders[2] = { &mesh_original, &mesh };
+		double ms[2] = { 0.0, 0.0 };
+
+		GLuint query;
+		glGenQueries(1, &query);
+
+		frame_data.view = camera->GetView();
+		frame_data.projection = camera->GetProjection();
+		frame_data.view_projection = camera->GetViewProjection();
+		frame_data.time = glfwGetTime();
+
+		GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, 0);
+		GLState::Get().Enable(GL_DEPTH_TEST);
+
+		for(int pass = 0; pass < 2; pass++) {
+			render -> UploadMesh(*orders[pass]);
+
+			for(int f = 0; f < frames; f++) {
+				display -> Clear(0.0f, 0.0f, 0.0f, 1.0f);
+				uniforms.BeginFrame(frame_data);
+
+				mesh_shader -> Use();
+
+				ObjectData bench_data = { mesh_fit, frame_data.view_projection * mesh_fit, glm::vec4(1.0f, 0.0f, 0.0f, 0.0f) };
+				uniforms.BindObject(uniforms.Push(bench_data));
+
+				glBeginQuery(GL_TIME_ELAPSED, query);
+				render -> DrawMesh();
+				glEndQuery(GL_TIME_ELAPSED);
+
+				uniforms.EndFrame();
+
+				// waits for the GPU, fine for a benchmark
+				GLuint64 ns = 0;
+				glGetQueryObjectui64v(query, GL_QUERY_RESULT, &ns);
+
+				ms[pass] += ns / 1e6;
+			}
+		}
+
+		glDeleteQueries(1, &query);
+
+		cout << "Mesh benchmark, GPU ms per frame: as loaded " << ms[0] / frames << ", optimized " << ms[1] / frames << endl;
+	}
+
+	// the GL buffers are all that is drawn
+	mesh = Mesh();
+	mesh_original = Mesh();
+
+	// opaque triangles, same model matrix as the points
+	auto draw_mesh = [&](const glm::mat4& view_projection, const glm::mat4& model)
+	{
+		mesh_shader -> Use();
+
+		ObjectData mesh_data = { model * mesh_fit, view_projection * model * mesh_fit, glm::vec4(1.0f, 0.0f, 0.0f, 0.0f) };
+		uniforms.BindObject(uniforms.Push(mesh_data));
+
+		render -> DrawMesh();
+	};
+
+	// streamed points
+	shared_ptr<PointIngest> ingest;
+
+	if(ingest_points) {
+		IngestConfig ingest_config;
+		ingest_config.policy = ::ingest_policy;
+		ingest_config.points_per_frame = ::ingest_points_per_frame;
+		ingest_config.backlog = ::ingest_backlog;
+		ingest_config.max_points = ::ingest_points_max;
+
+		ingest = make_shared<PointIngest>(ingest_config);
+
+		if(!::ingest_socket.empty() && !ingest->Listen(::ingest_socket)) {
+			return 1;
+		}
+
+		if(!::ingest_shm.empty() && !ingest->MapRing(::ingest_shm)) {
+			return 1;
+		}
+	}
+
+	// recorded frames, swapped in whole: the cube stays up until the first one is read
+	shared_ptr<SequencePlayer> sequence;
+
+	if(!::sequence_dir.empty()) {
+		sequence = make_shared<SequencePlayer>(::sequence_prefetch, ::sequence_io_threads);
+		sequence -> loop = ::sequence_loop;
+
+		if(!sequence->Open(::sequence_dir, ::sequence_rate, ::sequence_scale)) {
+			return 1;
+		}
+	}
+
 	// cube motion
 	float motion_counter = 0.0f;
 
+	// N key: cloud being generated, uploaded by the loader context once ready
+	future<Cloud> next_cloud;
+
+    // offscreen target -> default framebuffer (osr_framebuffer only)
+    auto present = [&]()
+    {
+        if(::post_shader) {
+            // 2. now bind back to default framebuffer and draw a quad plane with the attached framebuffer color texture
+            GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, 0);
+            GLState::Get().Disable(GL_DEPTH_TEST); // disable depth test so screen-space quad isn't discarded due to depth test.
+
+            display -> Clear(1.0f, 1.0f, 1.0f, 1.0f);
+
+            // 3. Draw a quad that spans the entire screen with the new framebuffer's color buffer as its texture
+            quad_screen_shader -> Use();
+            //quad_screen_shader -> setMat4("mvp", vp);
+
+            render -> DrawQuadScreen();
+        }
+        else {
+            // no post processing: a plain copy, no clear and no full screen quad
+            render -> BlitToScreen();
+        }
+    };
+
+    // idle frame detection (idle_wait)
+    ChangeTracker changes;
+    bool progressive_done = true;
+    int idle_frames = 0;
+
+    // tiled offline render of the camera view (opaque points, no motion blur of the cube: the model of the frame)
+    shared_ptr<PosterRender> poster;
+
+    auto render_poster = [&](const glm::mat4& model) -> bool
+    {
+        if(!poster) {
+            poster = make_shared<PosterRender>(::poster_tile_width, ::poster_tile_height);
+        }
+
+        render -> Sync();
+
+        auto draw = [&](const glm::mat4& projection, int width, int height)
+        {
+            FrameData tile_data = frame_data;
+            tile_data.view = camera->GetView();
+            tile_data.projection = projection;
+            tile_data.view_projection = projection * tile_data.view;
+            tile_data.viewport = glm::vec4(width, height, 1.0f / width, 1.0f / height);
+
+            uniforms.BeginFrame(tile_data);
+
+            scene_shader -> Use();
+
+            ObjectData tile_object = { model, tile_data.view_projection * model, glm::vec4(1.0f, 0.0f, 0.0f, 0.0f) };
+            uniforms.BindObject(uniforms.Push(tile_object));
+
+            render -> DrawScene();
+
+            if(mesh_loaded) {
+                draw_mesh(tile_data.view_projection, model);
+            }
+
+            uniforms.EndFrame();
+        };
+
+        bool ok = poster -> Render(::poster_path, ::poster_width, ::poster_height, *camera, draw);
+
+        // back to the window
+        glViewport(0, 0, display->screen_width, display->screen_height);
+        changes.Invalidate();
+
+        return ok;
+    };
+
+    // CPU rasterizer vs GL: a view drawn both ways (opaque points, default framebuffer), the GL image into gl_pixels
+    auto soft_compare = [&](const glm::mat4& view, SoftRasterizer& raster, vector<unsigned char>& gl_pixels)
+    {
+        render -> Sync();
+
+        frame_data.view = view;
+        frame_data.projection = camera->GetProjection();
+        frame_data.view_projection = frame_data.projection * view;
+        uniforms.BeginFrame(frame_data);
+
+        GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, 0);
+        GLState::Get().Enable(GL_DEPTH_TEST);
+        glViewport(0, 0, raster.width, raster.height);
+        display -> Clear(0.0f, 0.0f, 0.0f, 1.0f);
+
+        scene_shader -> Use();
+
+        ObjectData check_data = { glm::mat4(1.0f), frame_data.view_projection, glm::vec4(1.0f, 0.0f, 0.0f, 0.0f) };
+        uniforms.BindObject(uniforms.Push(check_data));
+
+        render -> DrawScene();
+        uniforms.EndFrame();
+
+        gl_pixels.resize((size_t)raster.width * raster.height * 4);
+        glReadBuffer(GL_BACK);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glReadPixels(0, 0, raster.width, raster.height, GL_RGBA, GL_UNSIGNED_BYTE, &gl_pixels[0]);
+
+        raster.Draw(render->points->points, frame_data.view_projection);
+    };
+
+    // first frame view
+    if(::soft_check) {
+        int fb_width, fb_height;
+        glfwGetFramebufferSize(display->mainWindow, &fb_width, &fb_height);
+
+        SoftRasterizer raster(fb_width, fb_height);
+        vector<unsigned char> gl_pixels;
+
+        soft_compare(camera->GetView(), raster, gl_pixels);
+
+        printf("SoftRasterizer: %.3f%% of the pixels differ from the GL image (tolerance %d)\n", 100.0 * raster.Compare(&gl_pixels[0], ::soft_tolerance), ::soft_tolerance);
+    }
+
+    // regression mode: fixed cameras x draw paths, offscreen image + screen after the quad / blit pass
+    if(!regress_dir.empty()) {
+        Regression regression(regress_dir, regress_update);
+        OcclusionCuller regress_culler(::occlusion_nearest);
+
+        enum { PATH_OPAQUE, PATH_BLENDED, PATH_OCCLUSION };
+
+        const char* path_names[] = { "opaque", "blended", "occlusion" };
+
+        const glm::vec3 eyes[] = { glm::vec3(0.0f, 0.0f, 5.0f), glm::vec3(3.0f, 2.0f, 3.0f), glm::vec3(0.3f, 0.2f, 1.2f) };
+        const char* eye_names[] = { "front", "corner", "close" };
+
+        int width = render->screen_width;
+        int height = render->screen_height;
+        vector<unsigned char> pixels((size_t)width * height * 4);
+
+        render -> Sync();
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+        for(int e = 0; e < 3; e++) {
+            for(int path = PATH_OPAQUE; path <= PATH_OCCLUSION; path++) {
+                string name = string(eye_names[e]) + "_" + path_names[path];
+
+                frame_data.view = glm::lookAt(eyes[e], glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+                frame_data.projection = camera->GetProjection();
+                frame_data.view_projection = frame_data.projection * frame_data.view;
+                frame_data.time = 0.0f;
+
+                glm::mat4 vp = frame_data.view_projection;
+
+                // 2 warm-up frames (shader compilation, first sort), median of the next ones
+                const int frames = 12;
+                vector<double> times;
+
+                depth_sorter.Reset();
+
+                for(int f = 0; f < frames; f++) {
+                    auto start = chrono::steady_clock::now();
+
+                    FrameArena::NextFrame();
+
+                    GLState::Get().BeginFrame();
+                    GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, render->custom_framebuffer);
+                    GLState::Get().Enable(GL_DEPTH_TEST);
+                    glViewport(0, 0, width, height);
+                    display -> Clear(0.0f, 0.0f, 0.0f, 1.0f);
+
+                    uniforms.BeginFrame(frame_data);
+                    scene_shader -> Use();
+
+                    ObjectData regress_data = { glm::mat4(1.0f), vp, glm::vec4(path == PATH_BLENDED ? ::point_alpha : 1.0f, 0.0f, 0.0f, 0.0f) };
+                    uniforms.BindObject(uniforms.Push(regress_data));
+
+                    if(path == PATH_BLENDED) {
+                        render -> UploadSortedIndices(depth_sorter.Sort(render->points->points, frame_data.view));
+
+                        GLState::Get().Enable(GL_BLEND);
+                        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+                        GLState::Get().DepthMask(GL_FALSE);
+
+                        render -> DrawSceneSorted();
+
+                        GLState::Get().DepthMask(GL_TRUE);
+                        GLState::Get().Disable(GL_BLEND);
+                    }
+                    else if(path == PATH_OCCLUSION) {
+                        regress_culler.Draw(*render, *scene_shader, frame_data.view, glm::mat4(1.0f), vp);
+                    }
+                    else {
+                        render -> DrawScene();
+                    }
+
+                    render -> ResolveFramebuffer();
+                    uniforms.EndFrame();
+                    glFinish();
+
+                    if(f >= 2) {
+                        times.push_back(chrono::duration<double>(chrono::steady_clock::now() - start).count() * 1e3);
+                    }
+                }
+
+                sort(times.begin(), times.end());
+
+                // offscreen image
+                GLState::Get().BindTexture(GL_TEXTURE_2D, render->textureColorbuffer);
+                glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+
+                regression.CheckImage(name, width, height, &pixels[0]);
+                regression.CheckTime(name, times[times.size() / 2]);
+
+                // what reaches the screen: post shader (quad_fs.glsl) and plain blit
+                if(path == PATH_OPAQUE) {
+                    bool post = ::post_shader;
+
+                    for(bool quad : {true, false}) {
+                        ::post_shader = quad;
+                        present();
+
+                        glReadBuffer(GL_BACK);
+                        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+
+                        regression.CheckImage(name + (quad ? "_screen_quad" : "_screen_blit"), width, height, &pixels[0]);
+                    }
+
+                    ::post_shader = post;
+                }
+            }
+        }
+
+        // the CPU rasterizer against GL, same frame: no golden, fails past soft_tolerance
+        int fb_width, fb_height;
+        glfwGetFramebufferSize(display->mainWindow, &fb_width, &fb_height);
+
+        SoftRasterizer raster(fb_width, fb_height);
+        vector<unsigned char> gl_pixels;
+
+        for(int e = 0; e < 3; e++) {
+            soft_compare(glm::lookAt(eyes[e], glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)), raster, gl_pixels);
+
+            regression.CheckMatch(string(eye_names[e]) + "_soft", raster.width, raster.height, &gl_pixels[0], raster.Pixels(), ::soft_tolerance);
+        }
+
+        return regression.Finish();
+    }
+
+    // offline only: the first frame view, nothing is shown
+    if(poster_only) {
+        return render_poster(glm::mat4(1.0f)) ? 0 : 1;
+    }
+
     // FPS
     double t, t0, fps;
-    char fpstr[50];
+    char fpstr[512];
     int frames = 0;
+    bool first_frame = true;
 
     t0 = glfwGetTime();
 
     // loop until ESC press
 	while(!glfwWindowShouldClose(display->mainWindow))
 	{
+        TRACE_SCOPE("frame");
+
+        // transient data of the frame FRAMES_IN_FLIGHT frames ago goes, heap allocations of the previous frame
+        FrameArena::NextFrame();
+        ALLOC_CHECK_FRAME();
+
         // FPS
         t = glfwGetTime();
 
         if( (t-t0) > 1.0 || frames == 0 )
         {
-            fps = (double)frames / (t-t0);
-            sprintf( fpstr, "FPS = %.1f", fps );
+            fps = (double)(frames - idle_frames) / (t-t0);
+
+            // counters of the previous frame
+            const FrameStats& stats = GLState::Get().last_frame;
+
+            sprintf( fpstr, "FPS = %.1f (idle %d) | draws %u, vertices %zu, state changes %u (avoided %u), upload %zu KB", fps, idle_frames,
+                stats.draw_calls, stats.vertices, stats.state_changes, stats.state_changes_avoided, stats.bytes_uploaded / 1024 );
+
+            if(occlusion) {
+                const OcclusionStats& os = occlusion->stats;
+
+                snprintf( fpstr + strlen(fpstr), sizeof(fpstr) - strlen(fpstr), " | chunks %u: frustum %u, occluded %u/%u",
+                    os.chunks, os.frustum_culled, os.occluded, os.queried );
+            }
+
+            if(ingest) {
+                const IngestStats& is = ingest->Period();
+
+                snprintf( fpstr + strlen(fpstr), sizeof(fpstr) - strlen(fpstr), " | ingest %.2f Mpts/s, latency %.1f ms (max %.1f), dropped %llu",
+                    is.rate / 1e6, is.latency_avg_ms, is.latency_max_ms, (unsigned long long)is.dropped );
+            }
+
+            if(sequence) {
+                const SequenceStats& ss = sequence->stats;
+
+                snprintf( fpstr + strlen(fpstr), sizeof(fpstr) - strlen(fpstr), " | frame %d/%u x%.3g%s, starved %u, skipped %u",
+                    sequence->Shown() + 1, sequence->NbFrames(), sequence->Speed(), sequence->Paused() ? " (paused)" : "", ss.starved, ss.skipped );
+            }
+
+            if(uploader && (next_cloud.valid() || uploader->Pending())) {
+                snprintf( fpstr + strlen(fpstr), sizeof(fpstr) - strlen(fpstr), " | loading" );
+            }
+
             glfwSetWindowTitle(display->mainWindow, fpstr);
             t0 = t;
             frames = 0;
+            idle_frames = 0;
         }
 
         frames ++;
 
-		// 1. Render the scene into a color texture attached to our new custom framebuffer object (bound as the active framebuffer)
-
-		if(::osr_framebuffer) {
-			// bind to framebuffer and draw scene as we normally would to color texture 
-			glBindFramebuffer(GL_FRAMEBUFFER, render->custom_framebuffer);
-			glEnable(GL_DEPTH_TEST);
-		}
-
-		// clear
-		display -> Clear(0.0f, 0.0f, 0.0f, 1.0f);
+        GLState::Get().BeginFrame();
 
-		// glUseProgram
-		scene_shader -> Use();
+        // GPU scopes of the previous frames that are done
+        TRACE_GPU_COLLECT();
 
 		// compute the ViewProjection matrix (projection * lookAt)
-		camera -> ProcessMouse(input->mdx, input->mdy, true);
-		input -> mdx = 0;
-		input -> mdy = 0;
+		{
+			TRACE_SCOPE("camera");
 
-		camera -> ProcessKeyboard(input->forward, input->backward, input->left, input->right, input->up, input->down, 10.0);
+			camera -> ProcessMouse(input->mdx, input->mdy, true);
+			input -> mdx = 0;
+			input -> mdy = 0;
+
+			camera -> ProcessKeyboard(input->forward, input->backward, input->left, input->right, input->up, input->down, 10.0);
+		}
 
 		// compute a Model matrix (some motion for our cube)
-		glm::vec3 pos = glm::vec3();
-		pos.x = 1 * sinf(motion_counter);
-		glm::mat4 tr_mx = glm::translate(pos);
+		glm::mat4 model;
+
+		{
+			TRACE_SCOPE("matrices");
+
+			glm::vec3 pos = glm::vec3();
+			pos.x = 1 * sinf(motion_counter);
+			glm::mat4 tr_mx = glm::translate(pos);
+
+			glm::vec3 rotx = glm::vec3();
+			rotx.x = motion_counter;
+			glm::mat4 rotx_mx = glm::rotate(rotx.x, glm::vec3(1.0f, 0.0f, 0.0f));
 
-		glm::vec3 rotx = glm::vec3();
-		rotx.x = motion_counter;
-		glm::mat4 rotx_mx = glm::rotate(rotx.x, glm::vec3(1.0f, 0.0f, 0.0f));
+			glm::vec3 roty = glm::vec3();
+			roty.y = -motion_counter;
+			glm::mat4 rot_my = glm::rotate(roty.y, glm::vec3(0.0f, 1.0f, 0.0f));
 
-		glm::vec3 roty = glm::vec3();
-		roty.y = -motion_counter;
-		glm::mat4 rot_my = glm::rotate(roty.y, glm::vec3(0.0f, 1.0f, 0.0f));
+			glm::vec3 rotz = glm::vec3();
+			rotz.z = -motion_counter;
+			glm::mat4 rot_mz = glm::rotate(rotz.z, glm::vec3(0.0f, 0.0f, 1.0f));
 
-		glm::vec3 rotz = glm::vec3();
-		rotz.z = -motion_counter;
-		glm::mat4 rot_mz = glm::rotate(rotz.z, glm::vec3(0.0f, 0.0f, 1.0f));
+			model = tr_mx * rotx_mx * rot_my * rot_mz;
+		}
 
-		// send our MVP matrix to the currently bound shader
 		glm::mat4 vp = camera->GetViewProjection();
-		scene_shader -> setMat4("mvp", vp * tr_mx * rotx_mx * rot_my * rot_mz);
 
-		// vao / vbo
-		render -> DrawScene();
+		// live scan: append new points, the oldest ones are overwritten once the budget is reached
+		if(::live_points) {
+			TRACE_SCOPE("live points");
+
+			glm::vec3* new_points = FrameArena::Current().Allocate<glm::vec3>(::live_points_per_frame);
+
+			for(unsigned int i = 0; i < ::live_points_per_frame; i++) {
+				new_points[i] = glm::vec3(xrand(-1.0, 1.0), xrand(-1.0, 1.0), xrand(-1.0, 1.0));
+			}
+
+			render -> points -> PushRing(new_points, ::live_points_per_frame, ::live_points_max);
+		}
+
+		// streamed points: ring / socket -> PointBuffer, uploaded with the other dirty ranges by Sync()
+		if(ingest) {
+			ingest -> Drain(*render->points);
+		}
+
+		// N key: new cloud generated then uploaded in the background, swapped in once the GPU has it (the frames go on)
+		if(uploader) {
+			if(input->reload && !sequence && !next_cloud.valid() && !uploader->Pending()) {
+				bool build_chunks = !::live_points && !ingest_points;
+
+				next_cloud = async(launch::async, [build_chunks]() { return GenerateCloud(::reload_points, build_chunks); });
+			}
+
+			input -> reload = false;
+
+			if(next_cloud.valid() && next_cloud.wait_for(chrono::seconds(0)) == future_status::ready) {
+				Cloud cloud = next_cloud.get();
+
+				uploader -> UploadPoints(std::move(cloud.points), [&, chunks = std::move(cloud.chunks)](shared_ptr<PointBuffer> points)
+				{
+					uploader -> Retire(render -> SwapPoints(points, chunks));
+					depth_sorter.Reset();
+
+					printf("GLUploader: %u points swapped in (%.0f MB uploaded in %.0f ms so far)\n", points->Size(), uploader->uploaded_bytes / 1048576.0, uploader->upload_seconds * 1e3);
+				});
+			}
+
+			uploader -> Poll();
+		}
+
+		// recorded scan: the back buffer is filled as soon as the next frame is read, swapped in when its time comes
+		if(sequence) {
+			if(input->play_toggle) {
+				sequence -> Pause(!sequence->Paused());
+			}
+
+			if(input->play_seek) {
+				sequence -> Seek(sequence->Shown() + input->play_seek * (int)::sequence_rate);
+			}
+
+			if(input->play_speed) {
+				sequence -> SetSpeed(sequence->Speed() * pow(2.0, input->play_speed));
+			}
+
+			input -> play_toggle = false;
+			input -> play_seek = 0;
+			input -> play_speed = 0;
+
+			// the loader fences were polled above: a frame uploaded there is swapped in this frame
+			if(sequence->Update(*render, uploader.get(), t)) {
+				depth_sorter.Reset();
+			}
+		}
+
+		// P key: poster of what is on screen (the next frame is rendered again)
+		if(input->poster) {
+			input -> poster = false;
+			render_poster(model);
+		}
+
+		// idle frame: same camera, motion, points and window size (and nothing left to accumulate)
+		int fb_width, fb_height;
+		glfwGetFramebufferSize(display->mainWindow, &fb_width, &fb_height);
+
+		bool changed = changes.Changed(vp, model, render->points->version, fb_width, fb_height);
+
+		// a damaged window without offscreen copy is rendered again
+		bool redraw = changed || !progressive_done || (input->refresh && !::osr_framebuffer);
+
+		if(::idle_wait && !redraw) {
+			// damaged window: the cached offscreen image is presented again, the scene is not rendered
+			if(input->refresh && ::osr_framebuffer) {
+				present();
+				display -> SwapBuffers();
+			}
+
+			input -> refresh = false;
+			idle_frames ++;
+
+			TRACE_SCOPE("idle wait");
+
+			// sleeps until an event (input, expose) or the timeout (streamed points, playback: polled every few ms)
+			glfwWaitEventsTimeout(ingest || (sequence && !sequence->Paused()) ? 0.005 : ::idle_timeout);
+			continue;
+		}
+
+		input -> refresh = false;
+
+		// 1. Render the scene into a color texture attached to our new custom framebuffer object (bound as the active framebuffer)
+		{
+			TRACE_SCOPE("draw");
+			TRACE_GPU_SCOPE("draw");
+
+			if(::osr_framebuffer) {
+				// bind to framebuffer and draw scene as we normally would to color texture 
+				GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, render->custom_framebuffer);
+				GLState::Get().Enable(GL_DEPTH_TEST);
+			}
+
+			// clear (progressive: only when the accumulation restarts, the mesh is drawn over it every frame)
+			if(!::progressive || progressive.NeedsRestart(*render, vp * model)) {
+				display -> Clear(0.0f, 0.0f, 0.0f, 1.0f);
+			}
+
+			// glUseProgram
+			scene_shader -> Use();
+
+			// camera block, written once for every program
+			frame_data.view = camera->GetView();
+			frame_data.projection = camera->GetProjection();
+			frame_data.view_projection = vp;
+			frame_data.time = t;
+
+			uniforms.BeginFrame(frame_data);
+
+			// opaque mesh first: the blended points go over it
+			if(mesh_loaded) {
+				draw_mesh(vp, model);
+				scene_shader -> Use();
+			}
+
+			// our cube: MVP matrix and alpha in the object block
+			ObjectData cube_data = { model, vp * model, glm::vec4(::blend_points ? ::point_alpha : 1.0f, 0.0f, 0.0f, 0.0f) };
+			uniforms.BindObject(uniforms.Push(cube_data));
+
+			// upload the dirty point ranges
+			if(render->points->IsDirty()) {
+				depth_sorter.Reset();
+			}
+
+			render -> Sync();
+
+			// vao / vbo
+			if(::blend_points) {
+				render -> UploadSortedIndices(depth_sorter.Sort(render->points->points, camera->GetView() * model));
+
+				// sorted: no depth writes, every point is blended over the farther ones
+				GLState::Get().Enable(GL_BLEND);
+				glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+				GLState::Get().DepthMask(GL_FALSE);
+
+				render -> DrawSceneSorted();
+
+				GLState::Get().DepthMask(GL_TRUE);
+				GLState::Get().Disable(GL_BLEND);
+			}
+			else if(::progressive) {
+				progressive_done = progressive.Draw(*render, vp * model);
+			}
+			else if(::occlusion_culling) {
+				occlusion -> Draw(*render, *scene_shader, camera->GetView(), model, vp * model);
+			}
+			else if(::multi_view) {
+				views[0].view_projection = vp;
+
+				multi -> Draw(*render, *scene_shader, uniforms, views, model);
+			}
+			else {
+				render -> DrawScene();
+			}
+		}
 
 		if(::osr_framebuffer) {
-			// 2. now bind back to default framebuffer and draw a quad plane with the attached framebuffer color texture
-			glBindFramebuffer(GL_FRAMEBUFFER, 0);
-			glDisable(GL_DEPTH_TEST); // disable depth test so screen-space quad isn't discarded due to depth test.
-			
-			display -> Clear(1.0f, 1.0f, 1.0f, 1.0f);
+			TRACE_SCOPE("present");
+			TRACE_GPU_SCOPE("present");
 
-			// 3. Draw a quad that spans the entire screen with the new framebuffer's color buffer as its texture
-			quad_screen_shader -> Use();
-			//quad_screen_shader -> setMat4("mvp", vp);
+			// MSAA samples -> textureColorbuffer
+			render -> ResolveFramebuffer();
 
-			render -> DrawQuadScreen();
+			present();
 		}
 
+		// the ring segment of this frame is reused once the GPU is done with it
+		uniforms.EndFrame();
+
 		// show back buffer
-		display -> SwapBuffers();
+		{
+			TRACE_SCOPE("swap");
+			display -> SwapBuffers();
+		}
+
+		// acquisition -> on screen latency of the points drained this frame
+		if(ingest) {
+			ingest -> Presented();
+		}
+
+		// stage times, time to first frame
+		if(first_frame) {
+			startup.Report();
+			first_frame = false;
+		}
 
 		// for our cube motion
 		if(!input->stop_motion) {
 			motion_counter += 0.01f;
 		}
 
-    	glfwPollEvents();
+		{
+			TRACE_SCOPE("poll");
+			glfwPollEvents();
+		}
 
 	} // end while loop
 
+	// playback: starved frames, I/O times
+	if(sequence) {
+		sequence -> Report();
+	}
+
+	// deduplicated driver messages (debug builds only)
+	GLDEBUG_REPORT();
+
+	// transient memory per frame, steady state frames that allocated (ALLOC_COUNT builds only)
+	FrameArena::Report();
+	ALLOC_CHECK_REPORT();
+
+	// Chrome trace-event JSON (TRACE builds only)
+	TRACE_FLUSH("trace.json");
+
     return 0;
 }
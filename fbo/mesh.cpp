@@ -0,0 +1,365 @@
+#include "mesh.h"
+#include "mesh_optimizer.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <unordered_map>
+
+static const char MESH_MAGIC[8] = { 'G', 'L', 'F', 'W', 'M', 'S', 'H', '\0' };
+static const uint32_t MESH_VERSION = 1;
+
+static_assert(sizeof(MeshHeader) == 40, "MeshHeader is written as is");
+
+/*---------------------------------------------------------------------------*/
+
+void Mesh::ComputeBounds()
+{
+	bmin = glm::vec3(0.0f);
+	bmax = glm::vec3(0.0f);
+
+	if(vertices.empty())
+		return;
+
+	bmin = bmax = vertices[0].Get<Position>();
+
+	for(const MeshFormat::Vertex& v : vertices) {
+		bmin = glm::min(bmin, v.Get<Position>());
+		bmax = glm::max(bmax, v.Get<Position>());
+	}
+}
+
+glm::mat4 Mesh::FitMatrix() const
+{
+	glm::vec3 size = bmax - bmin;
+	float extent = std::max(size.x, std::max(size.y, size.z));
+
+	if(extent <= 0.0f)
+		return glm::mat4(1.0f);
+
+	return glm::scale(glm::mat4(1.0f), glm::vec3(2.0f / extent)) * glm::translate(glm::mat4(1.0f), -0.5f * (bmin + bmax));
+}
+
+/*---------------------------------------------------------------------------*/
+
+// "v", "v/vt", "v//vn" or "v/vt/vn", 1-based or negative (relative to the end): false at the end of the line
+static bool ParseCorner(const char*& p, long nb_positions, long nb_normals, long& position, long& normal)
+{
+	char* end;
+
+	position = strtol(p, &end, 10);
+
+	if(end == p)
+		return false;
+
+	p = end;
+	normal = 0;
+
+	if(*p == '/') {
+		p++;
+
+		// texture coordinate, not used
+		if(*p != '/') {
+			strtol(p, &end, 10);
+			p = end;
+		}
+
+		if(*p == '/') {
+			p++;
+			normal = strtol(p, &end, 10);
+			p = end;
+		}
+	}
+
+	position = position < 0 ? nb_positions + position : position - 1;
+	normal = normal < 0 ? nb_normals + normal : normal - 1;
+
+	return true;
+}
+
+bool LoadOBJ(const std::string& path, Mesh& mesh)
+{
+	std::ifstream file(path, std::ios::binary);
+
+	if(!file) {
+		std::cout << "ERROR::MESH:: cannot read " << path << std::endl;
+		return false;
+	}
+
+	std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+
+	// (position, normal + 1) -> vertex
+	std::unordered_map<uint64_t, uint32_t> unique;
+	std::vector<bool> has_normal;
+	std::vector<uint32_t> polygon;
+
+	mesh.vertices.clear();
+	mesh.indices.clear();
+
+	std::string line;
+	size_t line_number = 0;
+
+	for(size_t begin = 0; begin < text.size(); ) {
+		size_t end = text.find('\n', begin);
+
+		if(end == std::string::npos)
+			end = text.size();
+
+		line.assign(text, begin, end - begin);
+		begin = end + 1;
+		line_number++;
+
+		const char* p = line.c_str();
+
+		while(*p == ' ' || *p == '\t')
+			p++;
+
+		if(p[0] == 'v' && (p[1] == ' ' || p[1] == '\t')) {
+			glm::vec3 v(0.0f);
+			sscanf(p + 2, "%f %f %f", &v.x, &v.y, &v.z);
+			positions.push_back(v);
+		}
+		else if(p[0] == 'v' && p[1] == 'n' && (p[2] == ' ' || p[2] == '\t')) {
+			glm::vec3 n(0.0f);
+			sscanf(p + 3, "%f %f %f", &n.x, &n.y, &n.z);
+			normals.push_back(n);
+		}
+		else if(p[0] == 'f' && (p[1] == ' ' || p[1] == '\t')) {
+			polygon.clear();
+			p += 2;
+
+			long position, normal;
+
+			while(ParseCorner(p, positions.size(), normals.size(), position, normal)) {
+				if(position < 0 || position >= (long)positions.size() || normal >= (long)normals.size()) {
+					std::cout << "ERROR::MESH:: " << path << ":" << line_number << ": index out of range" << std::endl;
+					return false;
+				}
+
+				uint64_t key = ((uint64_t)position << 32) | (uint64_t)(normal + 1);
+				auto found = unique.find(key);
+
+				if(found == unique.end()) {
+					MeshFormat::Vertex vertex;
+					vertex.Get<Position>() = positions[position];
+					vertex.Get<Normal>() = normal >= 0 ? normals[normal] : glm::vec3(0.0f);
+
+					found = unique.emplace(key, (uint32_t)mesh.vertices.size()).first;
+					mesh.vertices.push_back(vertex);
+					has_normal.push_back(normal >= 0);
+				}
+
+				polygon.push_back(found->second);
+			}
+
+			// fan
+			for(size_t i = 1; i + 1 < polygon.size(); i++) {
+				mesh.indices.push_back(polygon[0]);
+				mesh.indices.push_back(polygon[i]);
+				mesh.indices.push_back(polygon[i + 1]);
+			}
+		}
+	}
+
+	// missing normals: area weighted sum of the face normals
+	for(size_t i = 0; i < mesh.indices.size(); i += 3) {
+		uint32_t a = mesh.indices[i + 0];
+		uint32_t b = mesh.indices[i + 1];
+		uint32_t c = mesh.indices[i + 2];
+
+		glm::vec3 pa = mesh.vertices[a].Get<Position>();
+		glm::vec3 n = glm::cross(mesh.vertices[b].Get<Position>() - pa, mesh.vertices[c].Get<Position>() - pa);
+
+		for(uint32_t v : {a, b, c}) {
+			if(!has_normal[v])
+				mesh.vertices[v].Get<Normal>() += n;
+		}
+	}
+
+	for(size_t v = 0; v < mesh.vertices.size(); v++) {
+		glm::vec3& n = mesh.vertices[v].Get<Normal>();
+
+		if(!has_normal[v] && glm::length(n) > 0.0f)
+			n = glm::normalize(n);
+	}
+
+	mesh.ComputeBounds();
+
+	return true;
+}
+
+/*---------------------------------------------------------------------------*/
+
+bool WriteMesh(const std::string& path, const Mesh& mesh, const MeshHeader& header)
+{
+	// written aside then renamed: an interrupted write never leaves a truncated cache
+	std::string tmp_path = path + ".tmp";
+
+	FILE* file = fopen(tmp_path.c_str(), "wb");
+
+	if(!file) {
+		std::cout << "ERROR::MESH:: cannot write " << path << std::endl;
+		return false;
+	}
+
+	MeshHeader h = header;
+	h.version = MESH_VERSION;
+	h.nb_vertices = mesh.vertices.size();
+	h.nb_indices = mesh.indices.size();
+
+	bool ok = fwrite(MESH_MAGIC, sizeof(MESH_MAGIC), 1, file) == 1 && fwrite(&h, sizeof(h), 1, file) == 1;
+
+	if(ok && !mesh.vertices.empty())
+		ok = fwrite(&mesh.vertices[0], sizeof(MeshFormat::Vertex), mesh.vertices.size(), file) == mesh.vertices.size();
+
+	if(ok && !mesh.indices.empty())
+		ok = fwrite(&mesh.indices[0], sizeof(uint32_t), mesh.indices.size(), file) == mesh.indices.size();
+
+	ok = fclose(file) == 0 && ok;
+
+	if(!ok || std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+		std::cout << "ERROR::MESH:: cannot write " << path << std::endl;
+		std::remove(tmp_path.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+bool ReadMesh(const std::string& path, Mesh& mesh, MeshHeader& header)
+{
+	FILE* file = fopen(path.c_str(), "rb");
+
+	if(!file) {
+		std::cout << "ERROR::MESH:: cannot read " << path << std::endl;
+		return false;
+	}
+
+	char magic[sizeof(MESH_MAGIC)];
+
+	bool ok = fread(magic, sizeof(magic), 1, file) == 1 && memcmp(magic, MESH_MAGIC, sizeof(magic)) == 0 &&
+		fread(&header, sizeof(header), 1, file) == 1 && header.version == MESH_VERSION && header.nb_indices % 3 == 0;
+
+	if(ok) {
+		mesh.vertices.resize(header.nb_vertices);
+		mesh.indices.resize(header.nb_indices);
+
+		if(header.nb_vertices)
+			ok = fread(&mesh.vertices[0], sizeof(MeshFormat::Vertex), header.nb_vertices, file) == header.nb_vertices;
+
+		if(ok && header.nb_indices)
+			ok = fread(&mesh.indices[0], sizeof(uint32_t), header.nb_indices, file) == header.nb_indices;
+	}
+
+	fclose(file);
+
+	// never hand out of range indices to glDrawElements
+	for(size_t i = 0; ok && i < mesh.indices.size(); i++)
+		ok = mesh.indices[i] < mesh.vertices.size();
+
+	if(!ok) {
+		std::cout << "ERROR::MESH:: " << path << " is not a valid mesh file" << std::endl;
+		mesh.vertices.clear();
+		mesh.indices.clear();
+		return false;
+	}
+
+	mesh.ComputeBounds();
+
+	return true;
+}
+
+/*---------------------------------------------------------------------------*/
+
+static double Milliseconds(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() * 1e3;
+}
+
+bool LoadMesh(const std::string& path, bool optimize, Mesh& mesh, MeshStats& stats, Mesh* original)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	stats = MeshStats();
+
+	MeshHeader header;
+	memset(&header, 0, sizeof(header));
+
+	// binary mesh, as is
+	if(path.size() > 5 && path.compare(path.size() - 5, 5, ".mesh") == 0) {
+		if(!ReadMesh(path, mesh, header))
+			return false;
+
+		stats.load_ms = Milliseconds(start);
+		stats.acmr_before = header.acmr_before;
+		stats.acmr_after = header.acmr_after;
+
+		if(original)
+			*original = mesh;
+
+		return true;
+	}
+
+	std::error_code error;
+	uint64_t source_size = std::filesystem::file_size(path, error);
+	int64_t source_time = std::filesystem::last_write_time(path, error).time_since_epoch().count();
+
+	if(error) {
+		std::cout << "ERROR::MESH:: cannot read " << path << std::endl;
+		return false;
+	}
+
+	std::string cache_path = path + ".mesh";
+
+	if(!original && std::filesystem::exists(cache_path, error)) {
+		if(ReadMesh(cache_path, mesh, header) && header.source_size == source_size && header.source_time == source_time && header.optimized == (optimize ? 1u : 0u)) {
+			stats.from_cache = true;
+			stats.load_ms = Milliseconds(start);
+			stats.acmr_before = header.acmr_before;
+			stats.acmr_after = header.acmr_after;
+			return true;
+		}
+	}
+
+	if(!LoadOBJ(path, mesh))
+		return false;
+
+	stats.load_ms = Milliseconds(start);
+
+	if(original)
+		*original = mesh;
+
+	MeshOptimizer optimizer;
+
+	stats.acmr_before = optimizer.ACMR(mesh.indices, mesh.vertices.size());
+
+	if(optimize) {
+		auto optimize_start = std::chrono::steady_clock::now();
+		optimizer.Optimize(mesh);
+		stats.optimize_ms = Milliseconds(optimize_start);
+	}
+
+	stats.acmr_after = optimizer.ACMR(mesh.indices, mesh.vertices.size());
+
+	header.optimized = optimize ? 1 : 0;
+	header.source_size = source_size;
+	header.source_time = source_time;
+	header.acmr_before = stats.acmr_before;
+	header.acmr_after = stats.acmr_after;
+
+	// a failed cache write only costs the next load
+	WriteMesh(cache_path, mesh, header);
+
+	return true;
+}
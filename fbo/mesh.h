@@ -0,0 +1,83 @@
+#pragma once
+
+#define GLM_ENABLE_EXPERIMENTAL
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "vertex_format.h"
+
+/*---------------------------------------------------------------------------*/
+
+typedef VertexFormat<Position, Normal> MeshFormat;
+
+// indexed triangle list
+struct Mesh
+{
+	std::vector<MeshFormat::Vertex> vertices;
+	std::vector<uint32_t> indices;
+
+	glm::vec3 bmin = glm::vec3(0.0f);
+	glm::vec3 bmax = glm::vec3(0.0f);
+
+	unsigned int NbTriangles() const { return (unsigned int)(indices.size() / 3); }
+
+	void ComputeBounds();
+
+	// model matrix bringing the bounds into the [-1, 1] cube (aspect kept)
+	glm::mat4 FitMatrix() const;
+};
+
+/*---------------------------------------------------------------------------*/
+
+// "v", "vn" and "f" lines (polygons are fanned, missing normals are computed from the faces)
+bool LoadOBJ(const std::string& path, Mesh& mesh);
+
+/*
+	Binary mesh: header, MeshFormat vertices, 32-bit indices. Also the cache of the
+	optimized meshes: the header keeps the size / time of the source file and the
+	optimizer numbers, so a cached mesh is reused only while the source is unchanged.
+*/
+
+struct MeshHeader
+{
+	uint32_t version;
+	uint32_t nb_vertices;
+	uint32_t nb_indices;
+	uint32_t optimized;
+
+	// source file (0 when the mesh has no source)
+	uint64_t source_size;
+	int64_t source_time;
+
+	// post-transform cache misses per triangle before / after the optimization
+	float acmr_before;
+	float acmr_after;
+};
+
+bool WriteMesh(const std::string& path, const Mesh& mesh, const MeshHeader& header);
+bool ReadMesh(const std::string& path, Mesh& mesh, MeshHeader& header);
+
+/*---------------------------------------------------------------------------*/
+
+struct MeshStats
+{
+	bool from_cache = false;
+
+	double load_ms = 0.0;
+	double optimize_ms = 0.0;
+
+	float acmr_before = 0.0f;
+	float acmr_after = 0.0f;
+};
+
+/*
+	.obj: loaded, optimized (vertex cache, overdraw, vertex fetch) and cached as
+	<path>.mesh, reused as long as the .obj is unchanged. .mesh: read as is.
+
+	original: filled with the mesh as loaded (before / after benchmarks, the cache is
+	not read then).
+*/
+bool LoadMesh(const std::string& path, bool optimize, Mesh& mesh, MeshStats& stats, Mesh* original = nullptr);
@@ -0,0 +1,340 @@
+#include "mesh_optimizer.h"
+
+#include <algorithm>
+#include <numeric>
+
+/*---------------------------------------------------------------------------*/
+
+MeshOptimizer::MeshOptimizer(unsigned int cache_size, WorkerPool& pool) : pool(pool)
+{
+	this->cache_size = cache_size;
+}
+
+/*---------------------------------------------------------------------------*/
+
+// FIFO cache: a vertex is still cached while fewer than cache_size misses happened since its own
+// (stamps[v] = time of its miss), time += cache_size + 1 empties the cache
+unsigned int MeshOptimizer::CacheMisses(const std::vector<uint32_t>& indices, unsigned int first, unsigned int last, std::vector<uint32_t>& stamps, uint32_t& time) const
+{
+	unsigned int misses = 0;
+
+	time += cache_size + 1;
+
+	for(size_t i = 3 * (size_t)first; i < 3 * (size_t)last; i++) {
+		uint32_t v = indices[i];
+
+		if(time - stamps[v] > cache_size) {
+			stamps[v] = time++;
+			misses++;
+		}
+	}
+
+	return misses;
+}
+
+double MeshOptimizer::ACMR(const std::vector<uint32_t>& indices, unsigned int nb_vertices) const
+{
+	unsigned int nb_triangles = indices.size() / 3;
+
+	if(!nb_triangles)
+		return 0.0;
+
+	std::vector<uint32_t> stamps(nb_vertices, 0);
+	uint32_t time = 0;
+
+	return (double)CacheMisses(indices, 0, nb_triangles, stamps, time) / nb_triangles;
+}
+
+double MeshOptimizer::ATVR(const std::vector<uint32_t>& indices, unsigned int nb_vertices) const
+{
+	if(!nb_vertices)
+		return 0.0;
+
+	return ACMR(indices, nb_vertices) * (indices.size() / 3) / nb_vertices;
+}
+
+/*---------------------------------------------------------------------------*/
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<uint32_t>& indices, unsigned int nb_vertices)
+{
+	unsigned int nb_triangles = indices.size() / 3;
+
+	clusters.clear();
+
+	if(!nb_triangles)
+		return;
+
+	// vertex -> triangles using it
+	std::vector<uint32_t> offsets(nb_vertices + 1, 0);
+
+	for(uint32_t v : indices)
+		offsets[v + 1]++;
+
+	std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+	std::vector<uint32_t> adjacency(indices.size());
+	std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+
+	for(unsigned int t = 0; t < nb_triangles; t++) {
+		for(int k = 0; k < 3; k++)
+			adjacency[fill[indices[3 * t + k]]++] = t;
+	}
+
+	// triangles not emitted yet, per vertex
+	std::vector<uint32_t> live(nb_vertices);
+
+	for(unsigned int v = 0; v < nb_vertices; v++)
+		live[v] = offsets[v + 1] - offsets[v];
+
+	std::vector<uint32_t> stamps(nb_vertices, 0);
+	uint32_t time = cache_size + 1;
+
+	std::vector<bool> emitted(nb_triangles, false);
+	std::vector<uint32_t> dead_end;
+	std::vector<uint32_t> candidates;
+
+	std::vector<uint32_t> output;
+	output.reserve(indices.size());
+
+	unsigned int cursor = 0;
+	int fan = 0;
+
+	clusters.push_back(0);
+
+	while(fan >= 0) {
+		candidates.clear();
+
+		// every live triangle around the fanning vertex
+		for(uint32_t a = offsets[fan]; a < offsets[fan + 1]; a++) {
+			uint32_t t = adjacency[a];
+
+			if(emitted[t])
+				continue;
+
+			for(int k = 0; k < 3; k++) {
+				uint32_t v = indices[3 * t + k];
+
+				output.push_back(v);
+				dead_end.push_back(v);
+				candidates.push_back(v);
+				live[v]--;
+
+				if(time - stamps[v] > cache_size)
+					stamps[v] = time++;
+			}
+
+			emitted[t] = true;
+		}
+
+		// next fan: the oldest candidate that stays cached while its own triangles are emitted
+		int next = -1;
+		int64_t best = -1;
+
+		for(uint32_t v : candidates) {
+			if(!live[v])
+				continue;
+
+			int64_t priority = 0;
+
+			if(time - stamps[v] + 2 * live[v] <= cache_size)
+				priority = time - stamps[v];
+
+			if(priority > best) {
+				best = priority;
+				next = v;
+			}
+		}
+
+		if(next < 0) {
+			// dead end: the latest emitted vertex with live triangles, else the next one in input order
+			while(!dead_end.empty() && next < 0) {
+				uint32_t d = dead_end.back();
+				dead_end.pop_back();
+
+				if(live[d])
+					next = d;
+			}
+
+			while(next < 0 && cursor < nb_vertices) {
+				if(live[cursor])
+					next = cursor;
+
+				cursor++;
+			}
+
+			// hard boundary: the cache contents are unrelated to the next fan
+			if(next >= 0 && output.size() / 3 > clusters.back())
+				clusters.push_back(output.size() / 3);
+		}
+
+		fan = next;
+	}
+
+	indices.swap(output);
+}
+
+/*---------------------------------------------------------------------------*/
+
+void MeshOptimizer::OptimizeOverdraw(Mesh& mesh, float threshold)
+{
+	std::vector<uint32_t>& indices = mesh.indices;
+	unsigned int nb_triangles = mesh.NbTriangles();
+
+	if(!nb_triangles)
+		return;
+
+	if(clusters.empty() || clusters.back() >= nb_triangles)
+		clusters.assign(1, 0);
+
+	// soft boundaries: cut a cluster as soon as the part so far is within threshold of the whole cluster ACMR
+	std::vector<uint32_t> pieces;
+	std::vector<uint32_t> stamps(mesh.vertices.size(), 0);
+	uint32_t time = 0;
+
+	for(size_t c = 0; c < clusters.size(); c++) {
+		unsigned int first = clusters[c];
+		unsigned int last = c + 1 < clusters.size() ? clusters[c + 1] : nb_triangles;
+
+		double cluster_acmr = (double)CacheMisses(indices, first, last, stamps, time) / (last - first);
+
+		unsigned int start = first;
+		unsigned int misses = 0;
+
+		pieces.push_back(first);
+		time += cache_size + 1;
+
+		for(unsigned int t = first; t < last; t++) {
+			for(int k = 0; k < 3; k++) {
+				uint32_t v = indices[3 * t + k];
+
+				if(time - stamps[v] > cache_size) {
+					stamps[v] = time++;
+					misses++;
+				}
+			}
+
+			if(t + 1 < last && misses <= threshold * cluster_acmr * (t + 1 - start)) {
+				pieces.push_back(t + 1);
+				start = t + 1;
+				misses = 0;
+				time += cache_size + 1;
+			}
+		}
+	}
+
+	// area weighted centroid and normal of each piece
+	size_t nb_pieces = pieces.size();
+
+	std::vector<glm::vec3> centroids(nb_pieces);
+	std::vector<glm::vec3> normals(nb_pieces);
+	std::vector<float> areas(nb_pieces);
+
+	pool.ParallelFor(nb_pieces, [&](size_t begin, size_t end, unsigned int)
+	{
+		for(size_t p = begin; p < end; p++) {
+			unsigned int last = p + 1 < nb_pieces ? pieces[p + 1] : nb_triangles;
+
+			glm::vec3 centroid(0.0f);
+			glm::vec3 normal(0.0f);
+			float area = 0.0f;
+
+			for(unsigned int t = pieces[p]; t < last; t++) {
+				const glm::vec3& a = mesh.vertices[indices[3 * t + 0]].Get<Position>();
+				const glm::vec3& b = mesh.vertices[indices[3 * t + 1]].Get<Position>();
+				const glm::vec3& c = mesh.vertices[indices[3 * t + 2]].Get<Position>();
+
+				glm::vec3 n = glm::cross(b - a, c - a);
+				float w = glm::length(n);
+
+				centroid += (a + b + c) * (w / 3.0f);
+				normal += n;
+				area += w;
+			}
+
+			centroids[p] = centroid;
+			normals[p] = normal;
+			areas[p] = area;
+		}
+	});
+
+	glm::vec3 mesh_centroid(0.0f);
+	float mesh_area = 0.0f;
+
+	for(size_t p = 0; p < nb_pieces; p++) {
+		mesh_centroid += centroids[p];
+		mesh_area += areas[p];
+	}
+
+	if(mesh_area > 0.0f)
+		mesh_centroid /= mesh_area;
+
+	// facing away from the mesh center first
+	std::vector<float> keys(nb_pieces, 0.0f);
+
+	for(size_t p = 0; p < nb_pieces; p++) {
+		float length = glm::length(normals[p]);
+
+		if(areas[p] > 0.0f && length > 0.0f)
+			keys[p] = glm::dot(centroids[p] / areas[p] - mesh_centroid, normals[p] / length);
+	}
+
+	std::vector<uint32_t> order(nb_pieces);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return keys[a] > keys[b]; });
+
+	std::vector<uint32_t> sorted;
+	sorted.reserve(indices.size());
+	clusters.clear();
+
+	for(uint32_t p : order) {
+		unsigned int last = p + 1 < nb_pieces ? pieces[p + 1] : nb_triangles;
+
+		clusters.push_back(sorted.size() / 3);
+		sorted.insert(sorted.end(), indices.begin() + 3 * (size_t)pieces[p], indices.begin() + 3 * (size_t)last);
+	}
+
+	indices.swap(sorted);
+}
+
+/*---------------------------------------------------------------------------*/
+
+void MeshOptimizer::OptimizeVertexFetch(Mesh& mesh)
+{
+	const uint32_t unused = ~0u;
+
+	std::vector<uint32_t> remap(mesh.vertices.size(), unused);
+	uint32_t next = 0;
+
+	// first use order
+	for(uint32_t v : mesh.indices) {
+		if(remap[v] == unused)
+			remap[v] = next++;
+	}
+
+	std::vector<MeshFormat::Vertex> vertices(next);
+
+	pool.ParallelFor(mesh.vertices.size(), [&](size_t begin, size_t end, unsigned int)
+	{
+		for(size_t v = begin; v < end; v++) {
+			if(remap[v] != unused)
+				vertices[remap[v]] = mesh.vertices[v];
+		}
+	});
+
+	pool.ParallelFor(mesh.indices.size(), [&](size_t begin, size_t end, unsigned int)
+	{
+		for(size_t i = begin; i < end; i++)
+			mesh.indices[i] = remap[mesh.indices[i]];
+	});
+
+	mesh.vertices.swap(vertices);
+}
+
+/*---------------------------------------------------------------------------*/
+
+void MeshOptimizer::Optimize(Mesh& mesh)
+{
+	OptimizeVertexCache(mesh.indices, mesh.vertices.size());
+	OptimizeOverdraw(mesh);
+	OptimizeVertexFetch(mesh);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "mesh.h"
+#include "worker_pool.h"
+
+/*---------------------------------------------------------------------------*/
+
+/*
+	Triangle and vertex reordering of indexed meshes.
+
+	OptimizeVertexCache: Tipsify (Sander, Nehab, Barczak 2007), triangles are emitted
+	fanning around the vertex most likely still in a FIFO post-transform cache of
+	cache_size entries. The jumps to a vertex out of the cache are cluster boundaries.
+
+	OptimizeOverdraw: the clusters (split again where the cache hit rate allows it,
+	threshold: ACMR increase accepted) are sorted so that the ones facing away from the
+	mesh center are drawn first: outer surfaces occlude the inner ones, fewer fragments
+	are shaded for nothing.
+
+	OptimizeVertexFetch: vertices renumbered in first use order, the vertex fetch reads
+	the buffer nearly sequentially (unused vertices are dropped).
+*/
+
+class MeshOptimizer
+{
+	public:
+		MeshOptimizer(unsigned int cache_size = 16, WorkerPool& pool = WorkerPool::Instance());
+		virtual ~MeshOptimizer() {}
+
+		// FIFO cache simulation: transformed vertices per triangle (0.5 at best, 3 at worst)
+		double ACMR(const std::vector<uint32_t>& indices, unsigned int nb_vertices) const;
+
+		// transformed vertices per vertex (1 at best)
+		double ATVR(const std::vector<uint32_t>& indices, unsigned int nb_vertices) const;
+
+		void OptimizeVertexCache(std::vector<uint32_t>& indices, unsigned int nb_vertices);
+
+		// after OptimizeVertexCache (uses its clusters)
+		void OptimizeOverdraw(Mesh& mesh, float threshold = 1.05f);
+
+		void OptimizeVertexFetch(Mesh& mesh);
+
+		// the three, in that order
+		void Optimize(Mesh& mesh);
+
+	public:
+		unsigned int cache_size;
+
+		// first triangle of each cluster of the last OptimizeVertexCache()
+		std::vector<uint32_t> clusters;
+
+	private:
+		// misses of triangles [first, last) with an empty cache
+		unsigned int CacheMisses(const std::vector<uint32_t>& indices, unsigned int first, unsigned int last, std::vector<uint32_t>& stamps, uint32_t& time) const;
+
+		WorkerPool& pool;
+};
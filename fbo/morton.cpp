@@ -0,0 +1,247 @@
+#include "morton.h"
+
+#include <algorithm>
+#include <limits>
+
+static const unsigned int RADIX_BITS = 11;
+static const unsigned int RADIX_BUCKETS = 1 << RADIX_BITS;
+
+/*---------------------------------------------------------------------------*/
+
+// insert two 0 bits between each of the 10 low bits of x
+static inline uint32_t Spread10(uint32_t x)
+{
+	x &= 0x3ff;
+	x = (x | (x << 16)) & 0x030000ff;
+	x = (x | (x << 8))  & 0x0300f00f;
+	x = (x | (x << 4))  & 0x030c30c3;
+	x = (x | (x << 2))  & 0x09249249;
+	return x;
+}
+
+// insert two 0 bits between each of the 21 low bits of x
+static inline uint64_t Spread21(uint64_t x)
+{
+	x &= 0x1fffff;
+	x = (x | (x << 32)) & 0x001f00000000ffffull;
+	x = (x | (x << 16)) & 0x001f0000ff0000ffull;
+	x = (x | (x << 8))  & 0x100f00f00f00f00full;
+	x = (x | (x << 4))  & 0x10c30c30c30c30c3ull;
+	x = (x | (x << 2))  & 0x1249249249249249ull;
+	return x;
+}
+
+/*---------------------------------------------------------------------------*/
+
+template<typename Key>
+void RadixSort(std::vector<Key>& keys, std::vector<uint32_t>& values, unsigned int key_bits, WorkerPool& pool)
+{
+	RadixScratch<Key> scratch;
+	RadixSort(keys, values, key_bits, pool, scratch);
+}
+
+template<typename Key>
+void RadixSort(std::vector<Key>& keys, std::vector<uint32_t>& values, unsigned int key_bits, WorkerPool& pool, RadixScratch<Key>& scratch)
+{
+	size_t n = keys.size();
+
+	if(n < 2)
+		return;
+
+	unsigned int passes = (key_bits + RADIX_BITS - 1) / RADIX_BITS;
+	unsigned int slices = pool.Size();
+
+	std::vector<Key>& tmp_keys = scratch.keys;
+	std::vector<uint32_t>& tmp_values = scratch.values;
+
+	tmp_keys.resize(n);
+	tmp_values.resize(n);
+
+	// one histogram per slice, turned into per slice scatter offsets (bucket major so the sort stays stable)
+	std::vector<size_t>& histograms = scratch.histograms;
+	histograms.resize(slices * RADIX_BUCKETS);
+
+	for(unsigned int pass = 0; pass < passes; pass++) {
+		unsigned int shift = pass * RADIX_BITS;
+
+		std::fill(histograms.begin(), histograms.end(), 0);
+
+		pool.ParallelFor(n, [&](size_t begin, size_t end, unsigned int slice) {
+			size_t* h = &histograms[slice * RADIX_BUCKETS];
+
+			for(size_t i = begin; i < end; i++)
+				h[(keys[i] >> shift) & (RADIX_BUCKETS - 1)]++;
+		});
+
+		size_t sum = 0;
+
+		for(unsigned int d = 0; d < RADIX_BUCKETS; d++) {
+			for(unsigned int s = 0; s < slices; s++) {
+				size_t c = histograms[s * RADIX_BUCKETS + d];
+				histograms[s * RADIX_BUCKETS + d] = sum;
+				sum += c;
+			}
+		}
+
+		// ParallelFor cuts [0, n) the same way for the same n: each slice scatters the elements it counted
+		pool.ParallelFor(n, [&](size_t begin, size_t end, unsigned int slice) {
+			size_t* offsets = &histograms[slice * RADIX_BUCKETS];
+
+			for(size_t i = begin; i < end; i++) {
+				size_t pos = offsets[(keys[i] >> shift) & (RADIX_BUCKETS - 1)]++;
+				tmp_keys[pos] = keys[i];
+				tmp_values[pos] = values[i];
+			}
+		});
+
+		keys.swap(tmp_keys);
+		values.swap(tmp_values);
+	}
+}
+
+template void RadixSort<uint32_t>(std::vector<uint32_t>&, std::vector<uint32_t>&, unsigned int, WorkerPool&);
+template void RadixSort<uint64_t>(std::vector<uint64_t>&, std::vector<uint32_t>&, unsigned int, WorkerPool&);
+template void RadixSort<uint32_t>(std::vector<uint32_t>&, std::vector<uint32_t>&, unsigned int, WorkerPool&, RadixScratch<uint32_t>&);
+template void RadixSort<uint64_t>(std::vector<uint64_t>&, std::vector<uint32_t>&, unsigned int, WorkerPool&, RadixScratch<uint64_t>&);
+
+/*---------------------------------------------------------------------------*/
+
+MortonOrder::MortonOrder(bool wide_codes, WorkerPool& pool) : pool(pool)
+{
+	this->wide_codes = wide_codes;
+	this->bmin = glm::vec3(0.0f);
+	this->bmax = glm::vec3(0.0f);
+}
+
+/*---------------------------------------------------------------------------*/
+
+uint32_t MortonOrder::Encode30(const glm::vec3& p, const glm::vec3& bmin, const glm::vec3& scale)
+{
+	glm::vec3 q = (p - bmin) * scale;
+
+	uint32_t x = (uint32_t)std::min(std::max(q.x, 0.0f), 1023.0f);
+	uint32_t y = (uint32_t)std::min(std::max(q.y, 0.0f), 1023.0f);
+	uint32_t z = (uint32_t)std::min(std::max(q.z, 0.0f), 1023.0f);
+
+	return (Spread10(x) << 2) | (Spread10(y) << 1) | Spread10(z);
+}
+
+/*---------------------------------------------------------------------------*/
+
+uint64_t MortonOrder::Encode63(const glm::vec3& p, const glm::vec3& bmin, const glm::vec3& scale)
+{
+	glm::vec3 q = (p - bmin) * scale;
+
+	uint64_t x = (uint64_t)std::min(std::max(q.x, 0.0f), 2097151.0f);
+	uint64_t y = (uint64_t)std::min(std::max(q.y, 0.0f), 2097151.0f);
+	uint64_t z = (uint64_t)std::min(std::max(q.z, 0.0f), 2097151.0f);
+
+	return (Spread21(x) << 2) | (Spread21(y) << 1) | Spread21(z);
+}
+
+/*---------------------------------------------------------------------------*/
+
+void MortonOrder::ComputeBounds(const std::vector<glm::vec3>& points)
+{
+	std::vector<glm::vec3> slice_min(pool.Size(), glm::vec3(std::numeric_limits<float>::max()));
+	std::vector<glm::vec3> slice_max(pool.Size(), glm::vec3(-std::numeric_limits<float>::max()));
+
+	pool.ParallelFor(points.size(), [&](size_t begin, size_t end, unsigned int slice) {
+		for(size_t i = begin; i < end; i++) {
+			slice_min[slice] = glm::min(slice_min[slice], points[i]);
+			slice_max[slice] = glm::max(slice_max[slice], points[i]);
+		}
+	});
+
+	bmin = slice_min[0];
+	bmax = slice_max[0];
+
+	for(unsigned int s = 1; s < pool.Size(); s++) {
+		bmin = glm::min(bmin, slice_min[s]);
+		bmax = glm::max(bmax, slice_max[s]);
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+
+template<typename Key>
+void MortonOrder::SortKeys(std::vector<glm::vec3>& points, unsigned int key_bits)
+{
+	size_t n = points.size();
+
+	// quantization scale per axis (flat axes collapse to 0)
+	float cells = (float)((1u << (key_bits / 3)) - 1);
+	glm::vec3 extent = bmax - bmin;
+	glm::vec3 scale;
+
+	for(int a = 0; a < 3; a++)
+		scale[a] = extent[a] > 0.0f ? cells / extent[a] : 0.0f;
+
+	std::vector<Key> keys(n);
+	order.resize(n);
+
+	pool.ParallelFor(n, [&](size_t begin, size_t end, unsigned int) {
+		for(size_t i = begin; i < end; i++) {
+			if(sizeof(Key) == 4)
+				keys[i] = Encode30(points[i], bmin, scale);
+			else
+				keys[i] = Encode63(points[i], bmin, scale);
+
+			order[i] = i;
+		}
+	});
+
+	RadixSort<Key>(keys, order, key_bits, pool);
+
+	// gather
+	std::vector<glm::vec3> sorted(n);
+
+	pool.ParallelFor(n, [&](size_t begin, size_t end, unsigned int) {
+		for(size_t i = begin; i < end; i++)
+			sorted[i] = points[order[i]];
+	});
+
+	points.swap(sorted);
+}
+
+/*---------------------------------------------------------------------------*/
+
+void MortonOrder::Sort(std::vector<glm::vec3>& points)
+{
+	ComputeBounds(points);
+
+	if(wide_codes)
+		SortKeys<uint64_t>(points, 63);
+	else
+		SortKeys<uint32_t>(points, 30);
+}
+
+/*---------------------------------------------------------------------------*/
+
+std::vector<PointChunk> MortonOrder::BuildChunks(const std::vector<glm::vec3>& points, unsigned int chunk_size)
+{
+	std::vector<PointChunk> chunks;
+
+	if(points.empty() || chunk_size == 0)
+		return chunks;
+
+	chunks.resize((points.size() + chunk_size - 1) / chunk_size);
+
+	pool.ParallelFor(chunks.size(), [&](size_t begin, size_t end, unsigned int) {
+		for(size_t c = begin; c < end; c++) {
+			PointChunk& chunk = chunks[c];
+
+			chunk.first = c * chunk_size;
+			chunk.count = std::min((size_t)chunk_size, points.size() - chunk.first);
+			chunk.bmin = points[chunk.first];
+			chunk.bmax = points[chunk.first];
+
+			for(unsigned int i = chunk.first + 1; i < chunk.first + chunk.count; i++) {
+				chunk.bmin = glm::min(chunk.bmin, points[i]);
+				chunk.bmax = glm::max(chunk.bmax, points[i]);
+			}
+		}
+	});
+
+	return chunks;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#define GLM_ENABLE_EXPERIMENTAL
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+#include "worker_pool.h"
+
+/*---------------------------------------------------------------------------*/
+
+// contiguous range of the (sorted) point buffer and its bounds
+struct PointChunk
+{
+	unsigned int first;
+	unsigned int count;
+
+	glm::vec3 bmin;
+	glm::vec3 bmax;
+};
+
+/*---------------------------------------------------------------------------*/
+
+// buffers of RadixSort, kept by callers sorting every frame (sized once, no allocation after)
+template<typename Key>
+struct RadixScratch
+{
+	std::vector<Key> keys;
+	std::vector<uint32_t> values;
+	std::vector<size_t> histograms;
+};
+
+// LSD radix sort of keys, values are permuted along (stable), 11 bits per pass
+// key_bits limits the number of passes (30 bits: 3 passes, 63 bits: 6 passes)
+template<typename Key>
+void RadixSort(std::vector<Key>& keys, std::vector<uint32_t>& values, unsigned int key_bits, WorkerPool& pool);
+
+template<typename Key>
+void RadixSort(std::vector<Key>& keys, std::vector<uint32_t>& values, unsigned int key_bits, WorkerPool& pool, RadixScratch<Key>& scratch);
+
+/*---------------------------------------------------------------------------*/
+
+/*
+	Spatial reordering of a point cloud along a Z-order curve.
+
+	Codes are computed against the cloud bounds (10 bits per axis for 30-bit codes,
+	21 bits per axis for 63-bit codes), the points are sorted by code and then cut in
+	chunks of at most chunk_size points: neighbours in the buffer are neighbours in space,
+	so culling / LOD ranges are contiguous and the chunk bounds are tight.
+*/
+
+class MortonOrder
+{
+	public:
+		MortonOrder(bool wide_codes = false, WorkerPool& pool = WorkerPool::Instance());
+		virtual ~MortonOrder() {}
+
+		static uint32_t Encode30(const glm::vec3& p, const glm::vec3& bmin, const glm::vec3& scale);
+		static uint64_t Encode63(const glm::vec3& p, const glm::vec3& bmin, const glm::vec3& scale);
+
+		// reorders points in place
+		void Sort(std::vector<glm::vec3>& points);
+
+		// bounds of the cloud and chunk ranges of the sorted points
+		std::vector<PointChunk> BuildChunks(const std::vector<glm::vec3>& points, unsigned int chunk_size);
+
+	public:
+		bool wide_codes;
+
+		glm::vec3 bmin;
+		glm::vec3 bmax;
+
+		// the permutation applied by the last Sort(): sorted[i] = original[order[i]]
+		std::vector<uint32_t> order;
+
+	private:
+		void ComputeBounds(const std::vector<glm::vec3>& points);
+
+		template<typename Key>
+		void SortKeys(std::vector<glm::vec3>& points, unsigned int key_bits);
+
+		WorkerPool& pool;
+};
@@ -0,0 +1,295 @@
+#include "multi_view.h"
+#include "gl_state.h"
+#include "gl_debug.h"
+#include "frustum.h"
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+/*---------------------------------------------------------------------------*/
+
+MultiView::MultiView(const std::string& fragment_shader, const FrameUniforms& uniforms)
+{
+	this->visible_chunks = 0;
+	this->total_chunks = 0;
+
+	// the vertex shader needs to write gl_ViewportIndex
+	if(GLEW_ARB_viewport_array && (GLEW_ARB_shader_viewport_layer_array || GLEW_AMD_vertex_shader_viewport_index)) {
+		this->mode = MODE_INSTANCED;
+
+		// the view matrices are read from the object slots, VIEW_STRIDE: vec4 between two slots
+		ShaderSource source = Shader::Load("../shaders/scene_multiview_vs.glsl", fragment_shader);
+		source.vertex.insert(source.vertex.find('\n') + 1, "#define VIEW_STRIDE " + std::to_string(uniforms.ObjectStride() / 16) + "\n");
+
+		this->instanced_shader = std::make_shared<Shader>(source);
+	}
+	else {
+		this->mode = MODE_SCISSORED;
+	}
+
+	std::cout << "MultiView: " << (mode == MODE_INSTANCED ? "instanced (gl_ViewportIndex)" : "scissored fallback") << std::endl;
+}
+
+/*---------------------------------------------------------------------------*/
+
+void MultiView::Cull(const Render& render, const std::vector<View>& views, const glm::mat4& model)
+{
+	total_chunks = render.chunks.size();
+	view_masks.assign(total_chunks, 0);
+
+	for(unsigned int v = 0; v < views.size() && v < MAX_VIEWS; v++) {
+		glm::vec4 planes[6];
+
+		// planes in model space: the chunk bounds do not have to be transformed
+		ExtractPlanes(views[v].view_projection * model, planes);
+
+		for(unsigned int c = 0; c < total_chunks; c++) {
+			if(BoxInFrustum(planes, render.chunks[c].bmin, render.chunks[c].bmax))
+				view_masks[c] |= 1u << v;
+		}
+	}
+
+	visible_chunks = 0;
+
+	for(unsigned int c = 0; c < total_chunks; c++) {
+		if(view_masks[c])
+			visible_chunks++;
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+
+void MultiView::AddRange(const PointChunk& chunk)
+{
+	// contiguous chunks are merged into a single range
+	if(!range_first.empty() && (unsigned int)(range_first.back() + range_count.back()) == chunk.first)
+		range_count.back() += chunk.count;
+	else {
+		range_first.push_back(chunk.first);
+		range_count.push_back(chunk.count);
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+
+void MultiView::BuildRanges(const Render& render, unsigned int view_bits)
+{
+	range_first.clear();
+	range_count.clear();
+
+	// no chunks: the whole buffer
+	if(render.chunks.empty()) {
+		range_first.push_back(0);
+		range_count.push_back(render.points->Size());
+		return;
+	}
+
+	for(unsigned int c = 0; c < render.chunks.size(); c++) {
+		if(view_masks[c] & view_bits)
+			AddRange(render.chunks[c]);
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+
+void MultiView::DrawRanges()
+{
+	size_t vertices = 0;
+
+	for(auto c : range_count)
+		vertices += c;
+
+	if(range_first.empty())
+		return;
+
+	glMultiDrawArrays(GL_POINTS, &range_first[0], &range_count[0], range_first.size());
+
+	GLState::Get().frame.draw_calls++;
+	GLState::Get().frame.vertices += vertices;
+}
+
+/*---------------------------------------------------------------------------*/
+
+void MultiView::DrawInstanced(const Render& render, unsigned int nb_views)
+{
+	GLint location = instanced_shader -> Location("view_index");
+	GLint instance_views[MAX_VIEWS];
+
+	// no chunks: the whole buffer in every view
+	if(render.chunks.empty()) {
+		for(unsigned int v = 0; v < nb_views; v++)
+			instance_views[v] = v;
+
+		glUniform1iv(location, nb_views, instance_views);
+		glDrawArraysInstanced(GL_POINTS, 0, render.points->Size(), nb_views);
+
+		GLState::Get().frame.draw_calls++;
+		GLState::Get().frame.vertices += (size_t)render.points->Size() * nb_views;
+		return;
+	}
+
+	// visible chunks by view mask, in buffer order within a mask
+	groups.clear();
+
+	for(unsigned int c = 0; c < render.chunks.size(); c++) {
+		if(view_masks[c])
+			groups.push_back((uint64_t)view_masks[c] << 32 | c);
+	}
+
+	std::sort(groups.begin(), groups.end());
+
+	// one group per mask: its ranges drawn once per view of the mask, nothing more
+	for(size_t g = 0; g < groups.size();) {
+		unsigned int mask = groups[g] >> 32;
+		GLsizei nb_instances = 0;
+
+		for(unsigned int v = 0; v < nb_views; v++) {
+			if(mask & (1u << v))
+				instance_views[nb_instances++] = v;
+		}
+
+		range_first.clear();
+		range_count.clear();
+
+		for(; g < groups.size() && (unsigned int)(groups[g] >> 32) == mask; g++)
+			AddRange(render.chunks[(uint32_t)groups[g]]);
+
+		glUniform1iv(location, nb_instances, instance_views);
+
+		for(unsigned int r = 0; r < range_first.size(); r++) {
+			glDrawArraysInstanced(GL_POINTS, range_first[r], range_count[r], nb_instances);
+
+			GLState::Get().frame.draw_calls++;
+			GLState::Get().frame.vertices += (size_t)range_count[r] * nb_instances;
+		}
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+
+unsigned int MultiView::PushViews(FrameUniforms& uniforms, const std::vector<View>& views, const glm::mat4& model)
+{
+	unsigned int first = 0;
+
+	for(unsigned int v = 0; v < views.size() && v < MAX_VIEWS; v++) {
+		ObjectData object = { model, views[v].view_projection * model, glm::vec4(1.0f, 0.0f, 0.0f, 0.0f) };
+		unsigned int slot = uniforms.Push(object);
+
+		if(v == 0)
+			first = slot;
+	}
+
+	return first;
+}
+
+/*---------------------------------------------------------------------------*/
+
+void MultiView::Draw(Render& render, Shader& scene_shader, FrameUniforms& uniforms, const std::vector<View>& views, const glm::mat4& model)
+{
+	GLDEBUG_GROUP("MultiView::Draw");
+
+	unsigned int nb_views = std::min((unsigned int)views.size(), MAX_VIEWS);
+
+	Cull(render, views, model);
+
+	// consecutive slots, uploaded together by the first BindObject()
+	unsigned int first_slot = PushViews(uniforms, views, model);
+
+	GLState::Get().BindVertexArray(render.vao);
+	GLState::Get().Enable(GL_SCISSOR_TEST);
+
+	// the vertex shader reads the view matrices from the slots, bound together (a frame
+	// with almost max_objects objects falls back to the scissored draws)
+	if(mode == MODE_INSTANCED && uniforms.BindObjects(first_slot, MAX_VIEWS)) {
+		instanced_shader -> Use();
+
+		for(unsigned int v = 0; v < nb_views; v++) {
+			glViewportIndexedf(v, views[v].x, views[v].y, views[v].width, views[v].height);
+			glScissorIndexed(v, views[v].x, views[v].y, views[v].width, views[v].height);
+		}
+
+		// the fragment shader only reads the alpha of the object block
+		uniforms.BindObject(first_slot);
+
+		DrawInstanced(render, nb_views);
+	}
+	else {
+		scene_shader.Use();
+
+		for(unsigned int v = 0; v < nb_views; v++) {
+			glViewport(views[v].x, views[v].y, views[v].width, views[v].height);
+			glScissor(views[v].x, views[v].y, views[v].width, views[v].height);
+
+			uniforms.BindObject(first_slot + v);
+
+			// only the chunks this view sees (culled once for all the views above)
+			BuildRanges(render, 1u << v);
+			DrawRanges();
+		}
+	}
+
+	GLState::Get().Disable(GL_SCISSOR_TEST);
+	glViewport(0, 0, render.screen_width, render.screen_height);
+}
+
+/*---------------------------------------------------------------------------*/
+
+void MultiView::DrawNaive(Render& render, Shader& scene_shader, FrameUniforms& uniforms, const std::vector<View>& views, const glm::mat4& model)
+{
+	GLDEBUG_GROUP("MultiView::DrawNaive");
+
+	unsigned int first_slot = PushViews(uniforms, views, model);
+
+	scene_shader.Use();
+
+	for(unsigned int v = 0; v < views.size() && v < MAX_VIEWS; v++) {
+		glViewport(views[v].x, views[v].y, views[v].width, views[v].height);
+
+		uniforms.BindObject(first_slot + v);
+		render.DrawScene();
+	}
+
+	glViewport(0, 0, render.screen_width, render.screen_height);
+}
+
+/*---------------------------------------------------------------------------*/
+
+void MultiView::Benchmark(Render& render, Shader& scene_shader, FrameUniforms& uniforms, const FrameData& frame, const std::vector<View>& views, const glm::mat4& model, int frames)
+{
+	GLuint query;
+	glGenQueries(1, &query);
+
+	double ms[2] = { 0.0, 0.0 };
+
+	for(int pass = 0; pass < 2; pass++) {
+		for(int f = 0; f < frames; f++) {
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+			uniforms.BeginFrame(frame);
+
+			glBeginQuery(GL_TIME_ELAPSED, query);
+
+			if(pass == 0)
+				DrawNaive(render, scene_shader, uniforms, views, model);
+			else
+				Draw(render, scene_shader, uniforms, views, model);
+
+			glEndQuery(GL_TIME_ELAPSED);
+
+			uniforms.EndFrame();
+
+			// waits for the GPU, fine for a benchmark
+			GLuint64 ns = 0;
+			glGetQueryObjectui64v(query, GL_QUERY_RESULT, &ns);
+
+			ms[pass] += ns / 1e6;
+		}
+	}
+
+	glDeleteQueries(1, &query);
+
+	std::cout << "MultiView benchmark, " << views.size() << " views, " << render.points->Size() << " points, GPU ms per frame: naive "
+		<< ms[0] / frames << ", " << (mode == MODE_INSTANCED ? "instanced " : "scissored ") << ms[1] / frames
+		<< " (" << visible_chunks << "/" << total_chunks << " chunks visible)" << std::endl;
+}
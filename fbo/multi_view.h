@@ -0,0 +1,100 @@
+#pragma once
+
+#define GLM_ENABLE_EXPERIMENTAL
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+
+#include "render.h"
+#include "shader.h"
+#include "frame_uniforms.h"
+
+/*---------------------------------------------------------------------------*/
+
+// one camera and its rectangle of the framebuffer
+struct View
+{
+	glm::mat4 view_projection;
+
+	int x;
+	int y;
+	int width;
+	int height;
+};
+
+/*---------------------------------------------------------------------------*/
+
+/*
+	Several views of the scene from a single submission.
+
+	MODE_INSTANCED (ARB_viewport_array + ARB_shader_viewport_layer_array or
+	AMD_vertex_shader_viewport_index): the visible chunks are grouped by view mask, the
+	ranges of a group are drawn with one instance per view of the mask. The instance picks
+	its view, whose matrix the vertex shader reads from the pushed ObjectData (the view
+	slots bound together, FrameUniforms::BindObjects) and its viewport (gl_ViewportIndex).
+
+	MODE_SCISSORED (fallback): one scissored draw per view, but the chunk culling is done
+	once for all the views (a view mask per chunk) and each view draws its merged ranges.
+
+	Culling uses Render::chunks (Morton sorted points), without chunks everything is drawn.
+*/
+
+class MultiView
+{
+	public:
+		enum Mode
+		{
+			MODE_INSTANCED,
+			MODE_SCISSORED
+		};
+
+		static const unsigned int MAX_VIEWS = 16;
+
+		// uniforms: the object stride the instanced shader is built for
+		MultiView(const std::string& fragment_shader, const FrameUniforms& uniforms);
+		virtual ~MultiView() {}
+
+		// scene_shader: the single view shader, used by the scissored path (one ObjectData per view)
+		void Draw(Render& render, Shader& scene_shader, FrameUniforms& uniforms, const std::vector<View>& views, const glm::mat4& model);
+
+		// N full single view passes, the reference of the benchmark
+		void DrawNaive(Render& render, Shader& scene_shader, FrameUniforms& uniforms, const std::vector<View>& views, const glm::mat4& model);
+
+		// GPU time (GL_TIME_ELAPSED) of the naive and the multi-view paths, printed to stdout
+		void Benchmark(Render& render, Shader& scene_shader, FrameUniforms& uniforms, const FrameData& frame, const std::vector<View>& views, const glm::mat4& model, int frames);
+
+	public:
+		Mode mode;
+
+		// last Draw(): chunks drawn by at least one view / total
+		unsigned int visible_chunks;
+		unsigned int total_chunks;
+
+	private:
+		// view_masks[c]: bit v set if chunk c intersects the frustum of view v
+		void Cull(const Render& render, const std::vector<View>& views, const glm::mat4& model);
+
+		// merged (first, count) ranges of the chunks whose mask intersects view_bits
+		void BuildRanges(const Render& render, unsigned int view_bits);
+
+		void AddRange(const PointChunk& chunk);
+
+		void DrawRanges();
+
+		// the chunks of every view mask, one instance per view of the mask
+		void DrawInstanced(const Render& render, unsigned int nb_views);
+
+		// one ObjectData per view, returns the slot of the first one
+		unsigned int PushViews(FrameUniforms& uniforms, const std::vector<View>& views, const glm::mat4& model);
+
+		std::shared_ptr<Shader> instanced_shader;
+
+		std::vector<unsigned int> view_masks;
+
+		// mask << 32 | chunk, the visible chunks sorted by mask
+		std::vector<uint64_t> groups;
+		std::vector<GLint> range_first;
+		std::vector<GLsizei> range_count;
+};
@@ -0,0 +1,221 @@
+#include "occlusion.h"
+#include "gl_state.h"
+#include "gl_debug.h"
+#include "frustum.h"
+
+#include <algorithm>
+
+// queried[] values
+static const unsigned char QUERY_NONE = 0;
+static const unsigned char QUERY_DRAW = 1; // the query wraps the draw of the points
+static const unsigned char QUERY_BOX = 2;  // the query wraps the bounding box
+
+/*---------------------------------------------------------------------------*/
+
+OcclusionCuller::OcclusionCuller(unsigned int nearest_occluders)
+{
+	this->nearest_occluders = nearest_occluders;
+
+	bbox_shader = std::make_shared<Shader>("../shaders/bbox_vs.glsl", "../shaders/bbox_fs.glsl");
+
+	// unit cube, 12 triangles (both faces are rasterized: no culling is enabled)
+	const float c[8][3] = {
+		{0, 0, 0}, {1, 0, 0}, {1, 1, 0}, {0, 1, 0},
+		{0, 0, 1}, {1, 0, 1}, {1, 1, 1}, {0, 1, 1}
+	};
+
+	const int faces[12][3] = {
+		{0, 1, 2}, {0, 2, 3}, {4, 6, 5}, {4, 7, 6},
+		{0, 4, 5}, {0, 5, 1}, {3, 2, 6}, {3, 6, 7},
+		{0, 3, 7}, {0, 7, 4}, {1, 5, 6}, {1, 6, 2}
+	};
+
+	std::vector<float> vertices;
+
+	for(int f = 0; f < 12; f++) {
+		for(int v = 0; v < 3; v++)
+			vertices.insert(vertices.end(), c[faces[f][v]], c[faces[f][v]] + 3);
+	}
+
+	glGenVertexArrays(1, &box_vao);
+	glGenBuffers(1, &box_vbo);
+	GLState::Get().BindVertexArray(box_vao);
+	glBindBuffer(GL_ARRAY_BUFFER, box_vbo);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), &vertices[0], GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+
+	GLDEBUG_LABEL(GL_VERTEX_ARRAY, box_vao, "occlusion box vao");
+}
+
+/*---------------------------------------------------------------------------*/
+
+OcclusionCuller::~OcclusionCuller()
+{
+	if(!queries.empty())
+		glDeleteQueries(queries.size(), &queries[0]);
+
+	glDeleteVertexArrays(1, &box_vao);
+	glDeleteBuffers(1, &box_vbo);
+}
+
+/*---------------------------------------------------------------------------*/
+
+void OcclusionCuller::Resize(unsigned int nb_chunks)
+{
+	if(!queries.empty())
+		glDeleteQueries(queries.size(), &queries[0]);
+
+	queries.assign(nb_chunks, 0);
+
+	if(nb_chunks)
+		glGenQueries(nb_chunks, &queries[0]);
+
+	// everything is assumed visible until tested
+	visible.assign(nb_chunks, 1);
+	queried.assign(nb_chunks, QUERY_NONE);
+}
+
+/*---------------------------------------------------------------------------*/
+
+void OcclusionCuller::ReadBack()
+{
+	stats.occluded = 0;
+
+	for(unsigned int c = 0; c < queries.size(); c++) {
+		if(queried[c] == QUERY_NONE)
+			continue;
+
+		GLuint available = 0;
+		glGetQueryObjectuiv(queries[c], GL_QUERY_RESULT_AVAILABLE, &available);
+
+		// not there yet: conservatively visible (drawn as an occluder, queried again)
+		if(!available) {
+			visible[c] = 1;
+			continue;
+		}
+
+		GLuint any_samples = 0;
+		glGetQueryObjectuiv(queries[c], GL_QUERY_RESULT, &any_samples);
+
+		visible[c] = any_samples ? 1 : 0;
+
+		if(!any_samples && queried[c] == QUERY_BOX)
+			stats.occluded++;
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+
+void OcclusionCuller::Draw(Render& render, Shader& scene_shader, const glm::mat4& view, const glm::mat4& model, const glm::mat4& mvp)
+{
+	GLDEBUG_GROUP("OcclusionCuller::Draw");
+
+	const std::vector<PointChunk>& chunks = render.chunks;
+
+	// no chunks (live points, no Morton order): nothing to cull
+	if(chunks.empty()) {
+		render.DrawScene();
+		return;
+	}
+
+	if(queries.size() != chunks.size())
+		Resize(chunks.size());
+
+	ReadBack();
+
+	unsigned int occluded = stats.occluded;
+	stats = OcclusionStats();
+	stats.chunks = chunks.size();
+	stats.occluded = occluded;
+
+	glm::mat4 model_view = view * model;
+	// camera position in model space (chunk bounds space)
+	glm::vec4 eye = glm::inverse(model_view) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+
+	glm::vec4 planes[6];
+	ExtractPlanes(mvp, planes);
+
+	order.clear();
+
+	for(unsigned int c = 0; c < chunks.size(); c++) {
+		queried[c] = QUERY_NONE;
+
+		if(!BoxInFrustum(planes, chunks[c].bmin, chunks[c].bmax)) {
+			// tested again when it comes back into view
+			visible[c] = 0;
+			stats.frustum_culled++;
+			continue;
+		}
+
+		glm::vec3 center = (chunks[c].bmin + chunks[c].bmax) * 0.5f;
+		float depth = -(model_view * glm::vec4(center, 1.0f)).z;
+
+		order.push_back(std::make_pair(depth, c));
+	}
+
+	std::sort(order.begin(), order.end());
+
+	// 1. occluders, front to back: their draw is queried too (still visible next frame?)
+	tested.clear();
+
+	GLState::Get().BindVertexArray(render.vao);
+
+	for(unsigned int i = 0; i < order.size(); i++) {
+		unsigned int c = order[i].second;
+		const PointChunk& chunk = chunks[c];
+
+		// the box of a chunk around the camera is clipped by the near plane: never tested
+		glm::vec3 margin = (chunk.bmax - chunk.bmin) * 0.05f + glm::vec3(0.01f);
+		bool eye_inside = true;
+
+		for(int k = 0; k < 3; k++)
+			eye_inside = eye_inside && eye[k] >= chunk.bmin[k] - margin[k] && eye[k] <= chunk.bmax[k] + margin[k];
+
+		if(i < nearest_occluders || visible[c] || eye_inside) {
+			glBeginQuery(GL_ANY_SAMPLES_PASSED, queries[c]);
+			GLState::Get().DrawArrays(GL_POINTS, chunk.first, chunk.count);
+			glEndQuery(GL_ANY_SAMPLES_PASSED);
+
+			queried[c] = QUERY_DRAW;
+			stats.occluders++;
+		}
+		else {
+			tested.push_back(c);
+		}
+	}
+
+	if(tested.empty())
+		return;
+
+	// 2. bounding boxes against the occluders depth: no color, no depth writes
+	bbox_shader -> Use();
+	GLState::Get().BindVertexArray(box_vao);
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	GLState::Get().DepthMask(GL_FALSE);
+
+	for(auto c : tested) {
+		bbox_shader -> setVec3("bmin", chunks[c].bmin);
+		bbox_shader -> setVec3("bmax", chunks[c].bmax);
+
+		glBeginQuery(GL_ANY_SAMPLES_PASSED, queries[c]);
+		GLState::Get().DrawArrays(GL_TRIANGLES, 0, 36);
+		glEndQuery(GL_ANY_SAMPLES_PASSED);
+
+		queried[c] = QUERY_BOX;
+		stats.queried++;
+	}
+
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	GLState::Get().DepthMask(GL_TRUE);
+
+	// 3. the tested chunks, skipped by the GPU when their box was hidden (no CPU readback)
+	scene_shader.Use();
+	GLState::Get().BindVertexArray(render.vao);
+
+	for(auto c : tested) {
+		glBeginConditionalRender(queries[c], GL_QUERY_WAIT);
+		GLState::Get().DrawArrays(GL_POINTS, chunks[c].first, chunks[c].count);
+		glEndConditionalRender();
+	}
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#define GLM_ENABLE_EXPERIMENTAL
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+
+#include "render.h"
+#include "shader.h"
+
+/*---------------------------------------------------------------------------*/
+
+// chunk counts of the last Draw()
+struct OcclusionStats
+{
+	unsigned int chunks = 0;
+	unsigned int frustum_culled = 0;
+
+	// drawn unconditionally: nearest chunks, chunks visible last frame, camera inside the box
+	unsigned int occluders = 0;
+
+	// bounding box tested, drawn under glBeginConditionalRender
+	unsigned int queried = 0;
+
+	// queried chunks of the previous frame that were found hidden (read back without waiting)
+	unsigned int occluded = 0;
+};
+
+/*---------------------------------------------------------------------------*/
+
+/*
+	Occlusion culling of the Render::chunks with hardware queries, no CPU readback on
+	the draw path.
+
+	1. the chunks outside the frustum are skipped
+	2. occluders: the nearest_occluders nearest chunks and the chunks found visible by
+	   the previous frame queries are drawn first, they fill the depth buffer
+	3. each other chunk draws its bounding box (no color, no depth writes) inside a
+	   GL_ANY_SAMPLES_PASSED query
+	4. each queried chunk is drawn inside glBeginConditionalRender(query): the GPU skips
+	   it when no sample of its box passed
+
+	The query results are read on the next frame only if available, they seed the
+	occluder set (a chunk that was visible is likely to be visible again). The object
+	block (FrameUniforms) must hold the mvp of the points.
+*/
+
+class OcclusionCuller
+{
+	public:
+		OcclusionCuller(unsigned int nearest_occluders = 16);
+		virtual ~OcclusionCuller();
+
+		// scene_shader is in use with the object block bound, custom_framebuffer (or the screen) bound with depth test
+		void Draw(Render& render, Shader& scene_shader, const glm::mat4& view, const glm::mat4& model, const glm::mat4& mvp);
+
+	public:
+		unsigned int nearest_occluders;
+
+		OcclusionStats stats;
+
+	private:
+		void Resize(unsigned int nb_chunks);
+
+		// previous frame query results, when available
+		void ReadBack();
+
+		std::shared_ptr<Shader> bbox_shader;
+		GLuint box_vao;
+		GLuint box_vbo;
+
+		std::vector<GLuint> queries;
+
+		// visible[c]: last known visibility, queried[c]: a query was issued for c last frame
+		std::vector<unsigned char> visible;
+		std::vector<unsigned char> queried;
+
+		// frustum visible chunks sorted front to back (scratch)
+		std::vector<std::pair<float, unsigned int>> order;
+
+		// chunks drawn under conditional render (scratch)
+		std::vector<unsigned int> tested;
+};
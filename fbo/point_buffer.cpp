@@ -0,0 +1,305 @@
+#include "point_buffer.h"
+#include "gl_state.h"
+#include "gl_debug.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+// ranges closer than this (in points) are merged into a single upload
+static const unsigned int MERGE_GAP = 256;
+
+// ranges bigger than this (in bytes) are written through glMapBufferRange instead of glBufferSubData
+static const size_t MAP_THRESHOLD = 1 << 20;
+
+/*---------------------------------------------------------------------------*/
+
+PointBuffer::PointBuffer(const std::vector<glm::vec3>& points)
+{
+	this->points = points;
+	this->capacity = std::max((unsigned int)points.size(), 1u);
+	this->gpu_size = points.size();
+	this->upload_calls = 0;
+	this->uploaded_bytes = 0;
+	this->version = 0;
+	this->ring_cursor = 0;
+
+	glGenBuffers(1, &vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+
+	// DYNAMIC: the content is edited in place by Upload()
+	glBufferData(GL_ARRAY_BUFFER, this->capacity * sizeof(glm::vec3), points.empty() ? NULL : &points[0], GL_DYNAMIC_DRAW);
+
+	GLDEBUG_LABEL(GL_BUFFER, vbo, "points");
+}
+
+PointBuffer::PointBuffer(std::vector<glm::vec3>&& points, GLuint vbo)
+{
+	this->points = std::move(points);
+	this->vbo = vbo;
+	this->capacity = std::max((unsigned int)this->points.size(), 1u);
+	this->gpu_size = this->points.size();
+	this->upload_calls = 0;
+	this->uploaded_bytes = 0;
+	this->version = 0;
+	this->ring_cursor = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+
+PointBuffer::~PointBuffer()
+{
+	glDeleteBuffers(1, &vbo);
+}
+
+/*---------------------------------------------------------------------------*/
+
+unsigned int PointBuffer::AppendPoints(const std::vector<glm::vec3>& new_points)
+{
+	return AppendPoints(new_points.data(), new_points.size());
+}
+
+unsigned int PointBuffer::AppendPoints(const glm::vec3* new_points, unsigned int count)
+{
+	unsigned int first = points.size();
+
+	points.insert(points.end(), new_points, new_points + count);
+	MarkDirty(first, count);
+
+	return first;
+}
+
+/*---------------------------------------------------------------------------*/
+
+void PointBuffer::UpdateRange(unsigned int first, const std::vector<glm::vec3>& new_points)
+{
+	UpdateRange(first, new_points.data(), new_points.size());
+}
+
+void PointBuffer::UpdateRange(unsigned int first, const glm::vec3* new_points, unsigned int count)
+{
+	if(first + count > points.size()) {
+		std::cout << "PointBuffer::UpdateRange out of range (" << first << "+" << count << " > " << points.size() << ")" << std::endl;
+		return;
+	}
+
+	std::copy(new_points, new_points + count, points.begin() + first);
+	MarkDirty(first, count);
+}
+
+/*---------------------------------------------------------------------------*/
+
+void PointBuffer::PushRing(const glm::vec3* new_points, unsigned int count, unsigned int max_points)
+{
+	if(max_points == 0)
+		return;
+
+	// only the newest max_points of a bigger batch would survive it
+	if(count > max_points) {
+		new_points += count - max_points;
+		count = max_points;
+	}
+
+	// bigger than the ring (loaded that way): the end goes, the cursor restarts at the front
+	if(points.size() > max_points) {
+		RemoveRange(max_points, points.size() - max_points);
+		ring_cursor = 0;
+	}
+
+	// filling up
+	if(points.size() < max_points) {
+		unsigned int appended = std::min(count, max_points - (unsigned int)points.size());
+
+		AppendPoints(new_points, appended);
+
+		new_points += appended;
+		count -= appended;
+	}
+
+	// full: the oldest slots take the new points, in at most two parts at the wrap
+	while(count) {
+		ring_cursor %= max_points;
+
+		unsigned int written = std::min(count, max_points - ring_cursor);
+
+		UpdateRange(ring_cursor, new_points, written);
+
+		ring_cursor += written;
+		new_points += written;
+		count -= written;
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+
+void PointBuffer::RemoveRange(unsigned int first, unsigned int count)
+{
+	if(first >= points.size() || count == 0)
+		return;
+
+	count = std::min(count, (unsigned int)points.size() - first);
+
+	// fill the hole with the tail of the buffer (only the part of the tail that is not removed itself)
+	unsigned int tail_first = std::max(first + count, (unsigned int)points.size() - count);
+	unsigned int moved = points.size() - tail_first;
+
+	std::copy(points.begin() + tail_first, points.end(), points.begin() + first);
+	points.resize(points.size() - count);
+
+	// the tail is simply not drawn anymore, only the filled hole has to be re-uploaded
+	if(moved > 0)
+		MarkDirty(first, moved);
+
+	gpu_size = std::min(gpu_size, (unsigned int)points.size());
+
+	// drop (or clip) the dirty ranges that now point past the end
+	unsigned int size = points.size();
+	dirty.erase(std::remove_if(dirty.begin(), dirty.end(), [size](const Range& r) { return r.first >= size; }), dirty.end());
+	for(auto& r : dirty)
+		r.last = std::min(r.last, size);
+
+	version++;
+}
+
+/*---------------------------------------------------------------------------*/
+
+void PointBuffer::Replace(std::vector<glm::vec3>& new_points, bool write_store)
+{
+	points.swap(new_points);
+
+	Replaced(write_store);
+}
+
+void PointBuffer::Replace(const glm::vec3* new_points, unsigned int count, bool write_store)
+{
+	points.assign(new_points, new_points + count);
+
+	Replaced(write_store);
+}
+
+void PointBuffer::Replaced(bool write_store)
+{
+	capacity = std::max((unsigned int)points.size(), 1u);
+	gpu_size = points.size();
+	dirty.clear();
+	ring_cursor = 0;
+	version++;
+
+	if(write_store)
+		WriteStore();
+}
+
+void PointBuffer::WriteStore() const
+{
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(glm::vec3), points.empty() ? NULL : &points[0], GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/*---------------------------------------------------------------------------*/
+
+void PointBuffer::MarkDirty(unsigned int first, unsigned int count)
+{
+	if(count == 0)
+		return;
+
+	dirty.push_back({first, first + count});
+	version++;
+}
+
+/*---------------------------------------------------------------------------*/
+
+void PointBuffer::Grow(unsigned int min_capacity)
+{
+	unsigned int new_capacity = std::max(min_capacity, capacity * 2);
+
+	GLuint new_vbo;
+	glGenBuffers(1, &new_vbo);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, new_vbo);
+	glBufferData(GL_COPY_WRITE_BUFFER, new_capacity * sizeof(glm::vec3), NULL, GL_DYNAMIC_DRAW);
+
+	// keep what is already on the GPU, the rest is covered by the dirty ranges
+	if(gpu_size > 0) {
+		glBindBuffer(GL_COPY_READ_BUFFER, vbo);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, gpu_size * sizeof(glm::vec3));
+	}
+
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	glDeleteBuffers(1, &vbo);
+
+	vbo = new_vbo;
+	capacity = new_capacity;
+
+	GLDEBUG_LABEL(GL_BUFFER, vbo, "points");
+}
+
+/*---------------------------------------------------------------------------*/
+
+void PointBuffer::UploadRange(const Range& range)
+{
+	GLintptr offset = range.first * sizeof(glm::vec3);
+	GLsizeiptr size = (range.last - range.first) * sizeof(glm::vec3);
+
+	if((size_t)size >= MAP_THRESHOLD) {
+		// invalidate the range: the driver does not have to preserve (nor wait for) the previous content
+		void* ptr = glMapBufferRange(GL_ARRAY_BUFFER, offset, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+
+		if(ptr) {
+			memcpy(ptr, &points[range.first], size);
+			glUnmapBuffer(GL_ARRAY_BUFFER);
+		}
+		else {
+			glBufferSubData(GL_ARRAY_BUFFER, offset, size, &points[range.first]);
+		}
+	}
+	else {
+		glBufferSubData(GL_ARRAY_BUFFER, offset, size, &points[range.first]);
+	}
+
+	upload_calls++;
+	uploaded_bytes += size;
+
+	GLState::Get().CountUpload(size);
+}
+
+/*---------------------------------------------------------------------------*/
+
+bool PointBuffer::Upload()
+{
+	upload_calls = 0;
+	uploaded_bytes = 0;
+
+	if(!IsDirty())
+		return false;
+
+	bool reallocated = false;
+
+	if(points.size() > capacity) {
+		Grow(points.size());
+		reallocated = true;
+	}
+
+	// sort and merge (overlapping, adjacent or close enough) ranges
+	std::sort(dirty.begin(), dirty.end(), [](const Range& a, const Range& b) { return a.first < b.first; });
+
+	// merged in place: dirty[0, merged) are the ranges to send
+	size_t merged = 0;
+
+	for(size_t i = 0; i < dirty.size(); i++) {
+		if(merged && dirty[i].first <= dirty[merged - 1].last + MERGE_GAP)
+			dirty[merged - 1].last = std::max(dirty[merged - 1].last, dirty[i].last);
+		else
+			dirty[merged++] = dirty[i];
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+
+	for(size_t i = 0; i < merged; i++)
+		UploadRange(dirty[i]);
+
+	dirty.clear();
+	gpu_size = points.size();
+
+	return reallocated;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#define GLM_ENABLE_EXPERIMENTAL
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+/*---------------------------------------------------------------------------*/
+
+/*
+	Growable point VBO with a CPU mirror.
+
+	Edits (append / update / remove) only touch the CPU copy and record a dirty range,
+	Upload() then merges the dirty ranges and sends them with glBufferSubData (or a mapped
+	range for large spans). When the point count exceeds the GPU capacity the buffer grows
+	geometrically and the already uploaded part is copied GPU side with glCopyBufferSubData.
+*/
+
+class PointBuffer
+{
+	public:
+		PointBuffer(const std::vector<glm::vec3>& points);
+
+		// adopts vbo, already holding the points (filled on another context, see GLUploader)
+		PointBuffer(std::vector<glm::vec3>&& points, GLuint vbo);
+		virtual ~PointBuffer();
+
+		// returns the index of the first appended point
+		unsigned int AppendPoints(const std::vector<glm::vec3>& new_points);
+		unsigned int AppendPoints(const glm::vec3* new_points, unsigned int count);
+		void UpdateRange(unsigned int first, const std::vector<glm::vec3>& new_points);
+		void UpdateRange(unsigned int first, const glm::vec3* new_points, unsigned int count);
+
+		// bounded FIFO: appends up to max_points, then overwrites the oldest points in place
+		// (from ring_cursor, wrapping): nothing moves, only the written slots are uploaded
+		void PushRing(const glm::vec3* new_points, unsigned int count, unsigned int max_points);
+
+		// swap-remove: the hole is filled with the points at the end of the buffer (order is not preserved)
+		void RemoveRange(unsigned int first, unsigned int count);
+
+		// flush the dirty ranges, returns true if the GL buffer object changed (the VAO must be re-pointed)
+		bool Upload();
+
+		// whole content at once: swaps the points with new_points (no copy), then WriteStore()
+		// unless write_store is false (the store is then written on another context)
+		void Replace(std::vector<glm::vec3>& new_points, bool write_store = true);
+
+		// same, copied into the current block: no allocation once it has held count points
+		void Replace(const glm::vec3* new_points, unsigned int count, bool write_store = true);
+
+		// glBufferData of the whole CPU copy: the previous store is orphaned, draws in flight keep it
+		void WriteStore() const;
+
+		unsigned int Size() const { return (unsigned int)points.size(); }
+		bool IsDirty() const { return !dirty.empty() || points.size() > gpu_size; }
+
+	public:
+		GLuint vbo;
+
+		// in points
+		unsigned int capacity;
+		unsigned int gpu_size;
+
+		// stats of the last Upload()
+		unsigned int upload_calls;
+		size_t uploaded_bytes;
+
+		// bumped on every edit, lets the caller detect scene changes
+		unsigned int version;
+
+		// PushRing(): oldest point once the ring is full
+		unsigned int ring_cursor;
+
+		std::vector<glm::vec3> points;
+
+	private:
+		// [first, last) in points
+		struct Range
+		{
+			unsigned int first;
+			unsigned int last;
+		};
+
+		// the bookkeeping of a whole new content
+		void Replaced(bool write_store);
+
+		void MarkDirty(unsigned int first, unsigned int count);
+		void Grow(unsigned int min_capacity);
+		void UploadRange(const Range& range);
+
+		std::vector<Range> dirty;
+};
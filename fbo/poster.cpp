@@ -0,0 +1,219 @@
+#include "poster.h"
+#include "gl_state.h"
+#include "gl_debug.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+/*---------------------------------------------------------------------------*/
+
+PosterRender::PosterRender(int tile_width, int tile_height, int guard)
+{
+	GLint max_renderbuffer = 0;
+	GLint max_viewport[2] = {0, 0};
+
+	glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &max_renderbuffer);
+	glGetIntegerv(GL_MAX_VIEWPORT_DIMS, max_viewport);
+
+	// tile + guard band on both sides must fit the target
+	this->guard = guard;
+	this->tile_width = std::max(1, std::min(tile_width, std::min(max_renderbuffer, max_viewport[0]) - 2 * guard));
+	this->tile_height = std::max(1, std::min(tile_height, std::min(max_renderbuffer, max_viewport[1]) - 2 * guard));
+	this->image_width = 0;
+
+	int target_width = this->tile_width + 2 * guard;
+	int target_height = this->tile_height + 2 * guard;
+
+	glGenRenderbuffers(1, &color_rbo);
+	glBindRenderbuffer(GL_RENDERBUFFER, color_rbo);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, target_width, target_height);
+
+	glGenRenderbuffers(1, &depth_rbo);
+	glBindRenderbuffer(GL_RENDERBUFFER, depth_rbo);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, target_width, target_height);
+
+	glGenFramebuffers(1, &framebuffer);
+	GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_rbo);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth_rbo);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cout << "ERROR::FRAMEBUFFER:: Poster framebuffer is not complete!" << std::endl;
+
+	GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	GLDEBUG_LABEL(GL_FRAMEBUFFER, framebuffer, "poster tile framebuffer");
+
+	// RGBA readback of the tile without its guard band
+	glGenBuffers(NB_PBOS, pbos);
+
+	for(unsigned int i = 0; i < NB_PBOS; i++) {
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[i]);
+		glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)this->tile_width * this->tile_height * 4, NULL, GL_STREAM_READ);
+		fences[i] = 0;
+	}
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+/*---------------------------------------------------------------------------*/
+
+PosterRender::~PosterRender()
+{
+	for(unsigned int i = 0; i < NB_PBOS; i++) {
+		if(fences[i])
+			glDeleteSync(fences[i]);
+	}
+
+	glDeleteBuffers(NB_PBOS, pbos);
+
+	glDeleteFramebuffers(1, &framebuffer);
+	glDeleteRenderbuffers(1, &color_rbo);
+	glDeleteRenderbuffers(1, &depth_rbo);
+}
+
+/*---------------------------------------------------------------------------*/
+
+bool PosterRender::ReadTile()
+{
+	PendingTile tile = pending.front();
+	pending.erase(pending.begin());
+
+	// NB_PBOS - 1 tiles were issued since: usually signaled already (offline, no timeout)
+	while(glClientWaitSync(fences[tile.pbo], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED)
+		;
+
+	glDeleteSync(fences[tile.pbo]);
+	fences[tile.pbo] = 0;
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[tile.pbo]);
+
+	const unsigned char* rgba = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)tile.width * tile.height * 4, GL_MAP_READ_BIT);
+
+	if(rgba) {
+		// GL rows are bottom up, the band (and the file) top down
+		for(int y = 0; y < tile.height; y++) {
+			const unsigned char* src = rgba + (size_t)(tile.height - 1 - y) * tile.width * 4;
+			unsigned char* dst = &band[((size_t)y * image_width + tile.x) * 3];
+
+			for(int x = 0; x < tile.width; x++) {
+				dst[3 * x + 0] = src[4 * x + 0];
+				dst[3 * x + 1] = src[4 * x + 1];
+				dst[3 * x + 2] = src[4 * x + 2];
+			}
+		}
+
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	else {
+		std::cout << "ERROR::POSTER:: tile readback failed" << std::endl;
+	}
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	// complete band: its rows go straight to the file
+	if(tile.last)
+		file.write((const char*)&band[0], (std::streamsize)image_width * tile.height * 3);
+
+	return rgba && file.good();
+}
+
+/*---------------------------------------------------------------------------*/
+
+bool PosterRender::Render(const std::string& path, int width, int height, const Camera& camera, const DrawFunction& draw)
+{
+	GLDEBUG_GROUP("PosterRender::Render");
+
+	file.open(path, std::ios::binary | std::ios::trunc);
+
+	if(!file) {
+		std::cout << "ERROR::POSTER:: cannot write " << path << std::endl;
+		return false;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	// binary PPM header, then the rows top to bottom
+	file << "P6\n" << width << " " << height << "\n255\n";
+
+	image_width = width;
+	band.assign((size_t)width * tile_height * 3, 0);
+
+	float aspect = (float)width / (float)height;
+	unsigned int slot = 0;
+	unsigned int nb_tiles = 0;
+	bool ok = true;
+
+	GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	GLState::Get().Enable(GL_DEPTH_TEST);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+	for(int top = 0; top < height && ok; top += tile_height) {
+		int h = std::min(tile_height, height - top);
+
+		// GL window coordinates: y up from the bottom of the image
+		int y = height - top - h;
+
+		for(int x = 0; x < width && ok; x += tile_width) {
+			int w = std::min(tile_width, width - x);
+
+			// every PBO in flight: the oldest one is mapped first
+			if(pending.size() == NB_PBOS)
+				ok = ReadTile();
+
+			// tile + guard band in NDC of the whole image
+			float left = 2.0f * (x - guard) / width - 1.0f;
+			float right = 2.0f * (x + w + guard) / width - 1.0f;
+			float bottom = 2.0f * (y - guard) / height - 1.0f;
+			float top_ndc = 2.0f * (y + h + guard) / height - 1.0f;
+
+			glViewport(0, 0, w + 2 * guard, h + 2 * guard);
+			glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+			draw(camera.GetTileProjection(aspect, left, right, bottom, top_ndc), w + 2 * guard, h + 2 * guard);
+
+			// asynchronous copy, the guard band is left out
+			GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[slot]);
+			glReadPixels(guard, guard, w, h, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+			fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+			PendingTile tile = { x, w, h, slot, x + w >= width };
+			pending.push_back(tile);
+
+			slot = (slot + 1) % NB_PBOS;
+			nb_tiles++;
+		}
+	}
+
+	// tiles still in flight (on error: released, not written)
+	while(!pending.empty()) {
+		bool read = ReadTile();
+		ok = ok && read;
+	}
+
+	file.close();
+	ok = ok && !file.fail();
+
+	GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	if(ok) {
+		std::cout << "PosterRender: " << path << " " << width << "x" << height << ", " << nb_tiles << " tiles of " << tile_width << "x" << tile_height
+			<< " in " << seconds << " s (" << (double)width * height / seconds / 1e6 << " Mpixels/s)" << std::endl;
+	}
+	else {
+		std::cout << "ERROR::POSTER:: " << path << " is incomplete" << std::endl;
+	}
+
+	// band memory back
+	std::vector<unsigned char>().swap(band);
+
+	return ok;
+}
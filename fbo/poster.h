@@ -0,0 +1,86 @@
+#pragma once
+
+#define GLM_ENABLE_EXPERIMENTAL
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "camera.h"
+
+/*---------------------------------------------------------------------------*/
+
+/*
+	Offline render of an image of any size (far beyond GL_MAX_TEXTURE_SIZE and the
+	screen) into a binary PPM file, the whole image is never held in memory.
+
+	The image is cut into tiles rendered one after the other into a small offscreen
+	target, each one with a sub-frustum of the camera (Camera::GetTileProjection): the
+	tiles of a band (one row of tiles) are assembled in a band buffer which is written
+	to the file as soon as it is complete, top band first. The tiles are read back in
+	order: the band is written before the first tile of the next one lands in it.
+
+	Readback is asynchronous: each tile is copied into a pixel pack buffer (NB_PBOS in
+	flight, fenced) and mapped only NB_PBOS - 1 tiles later, while the GPU renders the
+	next ones.
+
+	Every tile is rendered with a guard band of `guard` pixels around it, not read back:
+	a point is clipped by its center, without the margin the points overlapping a tile
+	border would be cut.
+
+	draw(projection, width, height) renders the scene into the bound target (cleared,
+	depth test on) for the given projection and viewport size.
+*/
+
+class PosterRender
+{
+	public:
+		// tile size, clamped to GL_MAX_RENDERBUFFER_SIZE / GL_MAX_VIEWPORT_DIMS
+		PosterRender(int tile_width = 4096, int tile_height = 256, int guard = 4);
+		virtual ~PosterRender();
+
+		typedef std::function<void(const glm::mat4& projection, int width, int height)> DrawFunction;
+
+		// false if the file cannot be written (the image is not complete)
+		bool Render(const std::string& path, int width, int height, const Camera& camera, const DrawFunction& draw);
+
+	public:
+		int tile_width;
+		int tile_height;
+		int guard;
+
+	private:
+		// tile waiting in a PBO
+		struct PendingTile
+		{
+			int x, width, height;
+			unsigned int pbo;
+
+			// last tile of its band: the band is written after it
+			bool last;
+		};
+
+		// maps the oldest tile in flight into its band
+		bool ReadTile();
+
+		static const unsigned int NB_PBOS = 3;
+
+		GLuint framebuffer;
+		GLuint color_rbo;
+		GLuint depth_rbo;
+
+		GLuint pbos[NB_PBOS];
+		GLsync fences[NB_PBOS];
+
+		// tiles in flight, issue order
+		std::vector<PendingTile> pending;
+
+		// RGB rows top to bottom (image width x tile_height)
+		std::vector<unsigned char> band;
+		int image_width;
+
+		std::ofstream file;
+};
@@ -0,0 +1,74 @@
+#include "ppm.h"
+
+#include <fstream>
+#include <iostream>
+
+/*---------------------------------------------------------------------------*/
+
+bool WritePPM(const std::string& path, int width, int height, const unsigned char* rgba)
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+
+	if(!file) {
+		std::cout << "ERROR::PPM:: cannot write " << path << std::endl;
+		return false;
+	}
+
+	file << "P6\n" << width << " " << height << "\n255\n";
+
+	std::vector<unsigned char> row((size_t)width * 3);
+
+	for(int y = height - 1; y >= 0; y--) {
+		const unsigned char* src = rgba + (size_t)y * width * 4;
+
+		for(int x = 0; x < width; x++) {
+			row[3 * x + 0] = src[4 * x + 0];
+			row[3 * x + 1] = src[4 * x + 1];
+			row[3 * x + 2] = src[4 * x + 2];
+		}
+
+		file.write((const char*)&row[0], row.size());
+	}
+
+	return file.good();
+}
+
+/*---------------------------------------------------------------------------*/
+
+bool ReadPPM(const std::string& path, int& width, int& height, std::vector<unsigned char>& rgba)
+{
+	std::ifstream file(path, std::ios::binary);
+
+	if(!file)
+		return false;
+
+	std::string magic;
+	int max_value = 0;
+
+	file >> magic >> width >> height >> max_value;
+	file.get(); // single whitespace before the pixels
+
+	if(!file || magic != "P6" || max_value != 255 || width <= 0 || height <= 0)
+		return false;
+
+	std::vector<unsigned char> row((size_t)width * 3);
+	rgba.resize((size_t)width * height * 4);
+
+	for(int y = height - 1; y >= 0; y--) {
+		file.read((char*)&row[0], row.size());
+
+		if(!file)
+			return false;
+
+		unsigned char* dst = &rgba[(size_t)y * width * 4];
+
+		for(int x = 0; x < width; x++) {
+			dst[4 * x + 0] = row[3 * x + 0];
+			dst[4 * x + 1] = row[3 * x + 1];
+			dst[4 * x + 2] = row[3 * x + 2];
+			dst[4 * x + 3] = 255;
+		}
+	}
+
+	return true;
+}
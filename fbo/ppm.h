@@ -0,0 +1,19 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+/*---------------------------------------------------------------------------*/
+
+/*
+	Binary PPM (P6) images, top row first in the file.
+
+	In memory the pixels are RGBA8 with rows bottom up: the layout glReadPixels /
+	glGetTexImage (GL_RGBA, GL_UNSIGNED_BYTE) return. Alpha is not stored, it reads
+	back as 255.
+*/
+
+bool WritePPM(const std::string& path, int width, int height, const unsigned char* rgba);
+
+// false if the file is missing or not a 8 bit P6 image
+bool ReadPPM(const std::string& path, int& width, int& height, std::vector<unsigned char>& rgba);
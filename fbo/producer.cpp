@@ -0,0 +1,279 @@
+#include "ingest_protocol.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+/*
+	Point stream producer, stands in for the acquisition process (see PointIngest)
+
+	./glfw_shader_producer --socket /tmp/glfw_shader.sock [options]
+	./glfw_shader_producer --shm /glfw_shader_points [options]
+
+	--rate <points/s>    (default 1000000)
+	--batch <points>     points per batch (default 4096)
+	--seconds <s>        stops after s seconds (default 0: until killed)
+	--drop               shared memory: drop the batch when the ring is full instead of waiting
+
+	A scanner head sweeping a sphere: each batch is a vertical scan line, the head turns.
+*/
+
+// --------------------------------------------------------------------------------------------
+
+static void ScanLine(vector<float>& points, uint64_t sequence)
+{
+	size_t n = points.size() / 3;
+
+	float azimuth = sequence * 0.01f;
+
+	for(size_t i = 0; i < n; i++) {
+		float elevation = (float)M_PI * ((float)i / n - 0.5f);
+		float radius = 0.8f + 0.02f * sinf(13.0f * azimuth) * cosf(17.0f * elevation) + 0.005f * (float)(drand48() - 0.5);
+
+		points[3 * i + 0] = radius * cosf(elevation) * sinf(azimuth);
+		points[3 * i + 1] = radius * sinf(elevation);
+		points[3 * i + 2] = radius * cosf(elevation) * cosf(azimuth);
+	}
+}
+
+static bool WriteFull(int fd, const void* data, size_t size)
+{
+	const char* p = (const char*)data;
+
+	while(size) {
+		ssize_t n = write(fd, p, size);
+
+		if(n < 0 && errno == EINTR)
+			continue;
+
+		if(n <= 0)
+			return false;
+
+		p += n;
+		size -= n;
+	}
+
+	return true;
+}
+
+// --------------------------------------------------------------------------------------------
+
+static int ConnectSocket(const string& path)
+{
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+	// the renderer may not be up yet
+	for(int attempt = 0; attempt < 100; attempt++) {
+		int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+		if(fd >= 0 && connect(fd, (sockaddr*)&address, sizeof(address)) == 0)
+			return fd;
+
+		if(fd >= 0)
+			close(fd);
+
+		this_thread::sleep_for(chrono::milliseconds(100));
+	}
+
+	cout << "ERROR::PRODUCER:: cannot connect to " << path << endl;
+	return -1;
+}
+
+static PointRingHeader* OpenRing(const string& name, size_t& size)
+{
+	for(int attempt = 0; attempt < 100; attempt++) {
+		int fd = shm_open(name.c_str(), O_RDWR, 0);
+		struct stat st;
+
+		if(fd >= 0 && fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(PointRingHeader)) {
+			size = st.st_size;
+			void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			close(fd);
+
+			if(memory == MAP_FAILED)
+				break;
+
+			PointRingHeader* ring = (PointRingHeader*)memory;
+
+			// set up by the renderer
+			if(ring->magic.load(std::memory_order_acquire) == POINT_RING_MAGIC && ring->version == POINT_RING_VERSION)
+				return ring;
+
+			munmap(memory, size);
+		}
+		else if(fd >= 0) {
+			close(fd);
+		}
+
+		this_thread::sleep_for(chrono::milliseconds(100));
+	}
+
+	cout << "ERROR::PRODUCER:: cannot open the shared memory " << name << endl;
+	return nullptr;
+}
+
+// false: full ring and drop, the batch is lost
+static bool PushRing(PointRingHeader* ring, const vector<float>& points, uint64_t sequence, uint64_t timestamp, bool drop)
+{
+	uint32_t count = points.size() / 3;
+
+	uint64_t point_head = ring->point_head.load(std::memory_order_relaxed);
+	uint64_t batch_head = ring->batch_head.load(std::memory_order_relaxed);
+
+	// backpressure: wait for the renderer to give space back
+	while(point_head + count - ring->point_tail.load(std::memory_order_acquire) > ring->point_capacity ||
+		batch_head - ring->batch_tail.load(std::memory_order_acquire) >= ring->batch_capacity) {
+
+		if(drop) {
+			ring->dropped.fetch_add(count, std::memory_order_relaxed);
+			return false;
+		}
+
+		this_thread::sleep_for(chrono::microseconds(100));
+	}
+
+	float* ring_points = PointRingPoints(ring);
+	uint64_t offset = point_head % ring->point_capacity;
+	uint64_t first_part = min<uint64_t>(count, ring->point_capacity - offset);
+
+	memcpy(ring_points + 3 * offset, &points[0], first_part * 3 * sizeof(float));
+	memcpy(ring_points, points.data() + 3 * first_part, (count - first_part) * 3 * sizeof(float));
+
+	PointRingBatch& batch = PointRingBatches(ring)[batch_head % ring->batch_capacity];
+	batch.first = point_head;
+	batch.count = count;
+	batch.sequence = sequence;
+	batch.timestamp = timestamp;
+
+	// publish
+	ring->point_head.store(point_head + count, std::memory_order_release);
+	ring->batch_head.store(batch_head + 1, std::memory_order_release);
+
+	return true;
+}
+
+// --------------------------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+	string socket_path;
+	string shm_name;
+	double rate = 1000000.0;
+	unsigned int batch_size = 4096;
+	double seconds = 0.0;
+	bool drop = false;
+
+	for(int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		bool value = i + 1 < argc;
+
+		if(arg == "--socket" && value)
+			socket_path = argv[++i];
+		else if(arg == "--shm" && value)
+			shm_name = argv[++i];
+		else if(arg == "--rate" && value)
+			rate = atof(argv[++i]);
+		else if(arg == "--batch" && value)
+			batch_size = atoi(argv[++i]);
+		else if(arg == "--seconds" && value)
+			seconds = atof(argv[++i]);
+		else if(arg == "--drop")
+			drop = true;
+	}
+
+	if(socket_path.empty() == shm_name.empty() || rate <= 0.0 || batch_size == 0 || batch_size > POINT_FRAME_MAX) {
+		cout << "usage: " << argv[0] << " --socket <path> | --shm <name> [--rate <points/s>] [--batch <points>] [--seconds <s>] [--drop]" << endl;
+		return 1;
+	}
+
+	// the renderer closing the socket must not kill us
+	signal(SIGPIPE, SIG_IGN);
+
+	int fd = -1;
+	PointRingHeader* ring = nullptr;
+	size_t ring_size = 0;
+
+	if(!socket_path.empty() && (fd = ConnectSocket(socket_path)) < 0)
+		return 1;
+
+	if(!shm_name.empty() && !(ring = OpenRing(shm_name, ring_size)))
+		return 1;
+
+	if(ring && batch_size > ring->point_capacity) {
+		cout << "ERROR::PRODUCER:: batches larger than the ring (" << ring->point_capacity << " points)" << endl;
+		return 1;
+	}
+
+	vector<float> points(3 * batch_size);
+
+	auto start = chrono::steady_clock::now();
+	auto report = start;
+	chrono::duration<double> batch_period(batch_size / rate);
+
+	uint64_t sequence = 0;
+	uint64_t sent = 0;
+	uint64_t dropped = 0;
+
+	while(seconds <= 0.0 || chrono::steady_clock::now() - start < chrono::duration<double>(seconds)) {
+		// paced on the target rate, late batches are sent right away
+		this_thread::sleep_until(start + chrono::duration_cast<chrono::steady_clock::duration>(batch_period * sequence));
+
+		ScanLine(points, sequence);
+
+		uint64_t timestamp = PointTimestamp();
+
+		if(fd >= 0) {
+			PointFrameHeader header = { POINT_FRAME_MAGIC, batch_size, sequence, timestamp };
+
+			if(!WriteFull(fd, &header, sizeof(header)) || !WriteFull(fd, &points[0], points.size() * sizeof(float))) {
+				cout << "Producer: renderer disconnected" << endl;
+				break;
+			}
+
+			sent += batch_size;
+		}
+		else if(PushRing(ring, points, sequence, timestamp, drop)) {
+			sent += batch_size;
+		}
+		else {
+			dropped += batch_size;
+		}
+
+		sequence++;
+
+		auto now = chrono::steady_clock::now();
+
+		if(now - report > chrono::seconds(1)) {
+			double elapsed = chrono::duration<double>(now - start).count();
+			printf("Producer: %.2f Mpoints/s (target %.2f), %llu batches, %llu points dropped\n", sent / elapsed / 1e6, rate / 1e6, (unsigned long long)sequence, (unsigned long long)dropped);
+			report = now;
+		}
+	}
+
+	if(fd >= 0)
+		close(fd);
+
+	if(ring)
+		munmap(ring, ring_size);
+
+	return 0;
+}
@@ -0,0 +1,98 @@
+#include "progressive.h"
+#include "gl_state.h"
+#include "gl_debug.h"
+
+#include <algorithm>
+
+/*---------------------------------------------------------------------------*/
+
+static uint32_t ReverseBits(uint32_t v, unsigned int bits)
+{
+	uint32_t r = 0;
+
+	for(unsigned int b = 0; b < bits; b++) {
+		r = (r << 1) | (v & 1);
+		v >>= 1;
+	}
+
+	return r;
+}
+
+/*---------------------------------------------------------------------------*/
+
+ProgressiveRender::ProgressiveRender(unsigned int points_per_frame)
+{
+	this->points_per_frame = points_per_frame;
+	this->drawn = 0;
+	this->nb_points = 0;
+	this->restart = true;
+	this->last_mvp = glm::mat4(0.0f);
+	this->last_version = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+
+void ProgressiveRender::BuildOrder(unsigned int nb_points)
+{
+	unsigned int bits = 0;
+
+	while((1ull << bits) < nb_points)
+		bits++;
+
+	order.clear();
+	order.reserve(nb_points);
+
+	// indices past the end are skipped, the others keep their bit reversed rank
+	for(uint64_t i = 0; i < (1ull << bits); i++) {
+		uint32_t index = ReverseBits(i, bits);
+
+		if(index < nb_points)
+			order.push_back(index);
+	}
+
+	this->nb_points = nb_points;
+}
+
+/*---------------------------------------------------------------------------*/
+
+bool ProgressiveRender::NeedsRestart(const Render& render, const glm::mat4& mvp) const
+{
+	return restart || mvp != last_mvp || render.points->version != last_version || render.points->Size() != nb_points;
+}
+
+bool ProgressiveRender::Draw(Render& render, const glm::mat4& mvp)
+{
+	GLDEBUG_GROUP("ProgressiveRender::Draw");
+
+	unsigned int size = render.points->Size();
+
+	if(NeedsRestart(render, mvp)) {
+		// same order as long as the number of points does not change
+		if(size != nb_points || render.nb_sorted != order.size()) {
+			BuildOrder(size);
+			render.UploadSortedIndices(order);
+		}
+
+		last_mvp = mvp;
+		last_version = render.points->version;
+		drawn = 0;
+		restart = false;
+	}
+
+	if(drawn >= nb_points)
+		return true;
+
+	unsigned int count = std::min(points_per_frame, nb_points - drawn);
+
+	render.DrawSceneSorted(drawn, count);
+	drawn += count;
+
+	return false;
+}
+
+/*---------------------------------------------------------------------------*/
+
+float ProgressiveRender::Progress() const
+{
+	return nb_points ? (float)drawn / nb_points : 1.0f;
+}
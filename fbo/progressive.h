@@ -0,0 +1,64 @@
+#pragma once
+
+#define GLM_ENABLE_EXPERIMENTAL
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+#include "render.h"
+
+/*---------------------------------------------------------------------------*/
+
+/*
+	Progressive point rendering into the persistent offscreen target.
+
+	Every frame draws the next points_per_frame points of a level of detail order and
+	accumulates them into custom_framebuffer (no clear, the depth test keeps the nearest
+	points): the first frame shows a uniform subset of the cloud, the next ones refine it
+	until every point is drawn, then nothing is drawn anymore.
+
+	The order is the bit reversal permutation of the point indices: on Morton sorted
+	points, any prefix of it is spread evenly over the cloud. A change of the mvp, of the
+	points (PointBuffer::version) or a Restart() starts over. The caller clears the
+	target when NeedsRestart() says so, before anything else of the frame is drawn
+	(the mesh), then calls Draw().
+
+	The order goes into Render::sorted_ebo: not to be mixed with the blended (depth
+	sorted) draw.
+*/
+
+class ProgressiveRender
+{
+	public:
+		ProgressiveRender(unsigned int points_per_frame);
+		virtual ~ProgressiveRender() {}
+
+		// the accumulated image is stale: the target has to be cleared before this frame's draws
+		bool NeedsRestart(const Render& render, const glm::mat4& mvp) const;
+
+		// custom_framebuffer must be bound (and cleared on a restart); returns true once the image is complete
+		bool Draw(Render& render, const glm::mat4& mvp);
+
+		void Restart() { restart = true; }
+
+		// drawn points / total, 1.0 when complete
+		float Progress() const;
+
+	public:
+		unsigned int points_per_frame;
+
+	private:
+		void BuildOrder(unsigned int nb_points);
+
+		std::vector<uint32_t> order;
+
+		unsigned int drawn;
+		unsigned int nb_points;
+		bool restart;
+
+		// what the accumulated image was drawn with
+		glm::mat4 last_mvp;
+		unsigned int last_version;
+};
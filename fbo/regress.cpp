@@ -0,0 +1,209 @@
+#include "regress.h"
+#include "ppm.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+/*---------------------------------------------------------------------------*/
+
+Regression::Regression(const std::string& dir, bool update)
+{
+	this->dir = dir;
+	this->update = update;
+	this->tolerance = 8;
+	this->max_different = 0.001;
+	this->max_slowdown = 1.25;
+	this->timings_changed = false;
+	this->checks = 0;
+	this->failures = 0;
+	this->recorded = 0;
+
+	std::ifstream file(dir + "/timings.txt");
+	std::string name;
+	double ms;
+
+	while(file >> name >> ms)
+		timings[name] = ms;
+}
+
+/*---------------------------------------------------------------------------*/
+
+bool Regression::CheckImage(const std::string& name, int width, int height, const unsigned char* rgba)
+{
+	std::string path = dir + "/" + name + ".ppm";
+
+	int golden_width = 0;
+	int golden_height = 0;
+	std::vector<unsigned char> golden;
+
+	// recorded on --update only: a missing golden is a failure, not a free pass
+	if(update) {
+		bool written = WritePPM(path, width, height, rgba);
+
+		printf("%-28s image recorded (%s)\n", name.c_str(), path.c_str());
+		recorded++;
+
+		return written;
+	}
+
+	checks++;
+
+	if(!std::filesystem::exists(path)) {
+		printf("%-28s FAILED: no golden %s (regress.sh --update records it)\n", name.c_str(), path.c_str());
+		failures++;
+
+		return false;
+	}
+
+	if(!ReadPPM(path, golden_width, golden_height, golden)) {
+		printf("%-28s FAILED: golden %s is not a valid PPM image\n", name.c_str(), path.c_str());
+		failures++;
+
+		return false;
+	}
+
+	if(golden_width != width || golden_height != height) {
+		printf("%-28s FAILED: %dx%d image, golden is %dx%d\n", name.c_str(), width, height, golden_width, golden_height);
+		failures++;
+
+		return false;
+	}
+
+	return Compare(name, width, height, rgba, &golden[0], tolerance);
+}
+
+/*---------------------------------------------------------------------------*/
+
+bool Regression::CheckMatch(const std::string& name, int width, int height, const unsigned char* rgba, const unsigned char* reference, int tolerance)
+{
+	checks++;
+
+	bool ok = Compare(name, width, height, rgba, reference, tolerance);
+
+	if(!ok)
+		WritePPM(dir + "/" + name + "_reference.ppm", width, height, reference);
+
+	return ok;
+}
+
+/*---------------------------------------------------------------------------*/
+
+bool Regression::Compare(const std::string& name, int width, int height, const unsigned char* rgba, const unsigned char* golden, int tolerance)
+{
+	size_t different = 0;
+	double squared_error = 0.0;
+
+	// difference image, amplified
+	std::vector<unsigned char> diff((size_t)width * height * 4, 255);
+
+	for(int y = 0; y < height; y++) {
+		for(int x = 0; x < width; x++) {
+			const unsigned char* a = &rgba[((size_t)y * width + x) * 4];
+			const unsigned char* g = &golden[((size_t)y * width + x) * 4];
+
+			bool matched = false;
+
+			for(int dy = -1; dy <= 1 && !matched; dy++) {
+				for(int dx = -1; dx <= 1 && !matched; dx++) {
+					int nx = x + dx;
+					int ny = y + dy;
+
+					if(nx < 0 || ny < 0 || nx >= width || ny >= height)
+						continue;
+
+					const unsigned char* n = &golden[((size_t)ny * width + nx) * 4];
+
+					matched = std::abs(a[0] - n[0]) <= tolerance && std::abs(a[1] - n[1]) <= tolerance && std::abs(a[2] - n[2]) <= tolerance;
+				}
+			}
+
+			for(int c = 0; c < 3; c++) {
+				int d = a[c] - g[c];
+
+				squared_error += d * d;
+				diff[((size_t)y * width + x) * 4 + c] = std::min(255, 4 * std::abs(d));
+			}
+
+			if(!matched)
+				different++;
+		}
+	}
+
+	double fraction = (double)different / ((double)width * height);
+	double mse = squared_error / (3.0 * width * height);
+	double psnr = mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : 99.0;
+
+	bool ok = fraction <= max_different;
+
+	printf("%-28s %s: %.4f%% different pixels, PSNR %.1f dB\n", name.c_str(), ok ? "ok" : "FAILED", 100.0 * fraction, psnr);
+
+	if(!ok) {
+		WritePPM(dir + "/" + name + "_actual.ppm", width, height, rgba);
+		WritePPM(dir + "/" + name + "_diff.ppm", width, height, &diff[0]);
+		failures++;
+	}
+
+	return ok;
+}
+
+/*---------------------------------------------------------------------------*/
+
+bool Regression::CheckTime(const std::string& name, double ms)
+{
+	auto baseline = timings.find(name);
+
+	if(update) {
+		timings[name] = ms;
+		timings_changed = true;
+
+		printf("%-28s %.2f ms recorded\n", name.c_str(), ms);
+		recorded++;
+
+		return true;
+	}
+
+	checks++;
+
+	if(baseline == timings.end()) {
+		printf("%-28s FAILED: %.2f ms, no baseline in %s/timings.txt (regress.sh --update records it)\n", name.c_str(), ms, dir.c_str());
+		failures++;
+
+		return false;
+	}
+
+	bool ok = ms <= baseline->second * max_slowdown;
+
+	printf("%-28s %s: %.2f ms (baseline %.2f ms, x%.2f)\n", name.c_str(), ok ? "ok" : "FAILED", ms, baseline->second, ms / baseline->second);
+
+	if(!ok)
+		failures++;
+
+	return ok;
+}
+
+/*---------------------------------------------------------------------------*/
+
+int Regression::Finish()
+{
+	if(timings_changed) {
+		std::ofstream file(dir + "/timings.txt", std::ios::trunc);
+
+		for(auto& t : timings)
+			file << t.first << " " << t.second << "\n";
+
+		if(!file) {
+			std::cout << "ERROR::REGRESS:: cannot write " << dir << "/timings.txt" << std::endl;
+			failures++;
+		}
+	}
+
+	printf("regression: %u checks, %u failed, %u recorded\n", checks, failures, recorded);
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <map>
+#include <string>
+
+/*---------------------------------------------------------------------------*/
+
+/*
+	Golden image and frame time checks (--regress mode of the viewer, see regress.sh).
+
+	Images are compared against dir/<name>.ppm: a pixel is different when no pixel of
+	the 3x3 neighbourhood of the golden image is within `tolerance` on every channel
+	(a point moved by one pixel between two rasterizers is not a regression, a wrong
+	color is). The check fails past max_different of the pixels, the actual image and
+	a difference image are then written next to the golden one.
+
+	CheckMatch() compares two renderers of the same frame the same way (no golden, never
+	recorded): the SoftRasterizer image against the GL readback.
+
+	Frame times are compared against dir/timings.txt ("name ms" lines), the check fails
+	when a case is max_slowdown times slower than its baseline.
+
+	A missing golden image or baseline fails the check: update records everything (the
+	first time, then after an intended change of the picture or the speed).
+*/
+
+class Regression
+{
+	public:
+		Regression(const std::string& dir, bool update = false);
+		virtual ~Regression() {}
+
+		// rgba: width x height, rows bottom up (glReadPixels layout)
+		bool CheckImage(const std::string& name, int width, int height, const unsigned char* rgba);
+
+		// rgba against reference (same size and layout), within tolerance per channel
+		bool CheckMatch(const std::string& name, int width, int height, const unsigned char* rgba, const unsigned char* reference, int tolerance);
+
+		bool CheckTime(const std::string& name, double ms);
+
+		// writes the recorded baselines, prints the summary, returns the process exit code
+		int Finish();
+
+	public:
+		int tolerance;
+		double max_different;
+		double max_slowdown;
+
+	private:
+		// counts a failure and writes the actual and the difference images next to the goldens
+		bool Compare(const std::string& name, int width, int height, const unsigned char* rgba, const unsigned char* golden, int tolerance);
+
+		std::string dir;
+		bool update;
+
+		std::map<std::string, double> timings;
+		bool timings_changed;
+
+		unsigned int checks;
+		unsigned int failures;
+		unsigned int recorded;
+};
@@ -0,0 +1,31 @@
+#!/bin/bash
+
+# golden images + frame times under Mesa llvmpipe (deterministic software rasterizer),
+# and the CPU rasterizer against the GL image of the same frame
+#
+# ./regress.sh            compare against regress/, a missing golden image or timing fails
+# ./regress.sh --update   record everything (first run, or after an intended change)
+#
+# The goldens are not generated by the build. To create them, or to refresh them after
+# an intended change, on the reference machine (Mesa llvmpipe, no GPU needed):
+#
+#   ./build.sh && ./regress.sh --update && ./regress.sh
+#   git add regress/*.ppm regress/timings.txt   (not the *_actual / *_diff / *_reference images)
+#
+# The frame times depend on the machine: record them where the check runs (CI runner).
+
+set -e
+
+mkdir -p regress
+
+export LIBGL_ALWAYS_SOFTWARE=1
+export GALLIUM_DRIVER=llvmpipe
+
+cd build
+
+# headless: virtual X server when there is no display
+if [ -z "$DISPLAY" ]; then
+  xvfb-run -a -s "-screen 0 1920x1080x24" ./glfw_shader --regress ../regress "$@"
+else
+  ./glfw_shader --regress ../regress "$@"
+fi
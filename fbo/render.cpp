@@ -1,43 +1,50 @@
 #include "render.h"
+#include "gl_state.h"
+#include "gl_debug.h"
+#include "vertex_format.h"
 
+#include <algorithm>
 #include <iostream>
 
 /*---------------------------------------------------------------------------*/
 
-Render::Render(std::vector<glm::vec3> vertices, int screen_width, int screen_height, bool use_frambuffer)
+Render::Render(std::vector<glm::vec3> vertices, int screen_width, int screen_height, bool use_frambuffer, FramebufferDesc fb_desc)
 {
 	this->use_frambuffer = use_frambuffer;
+	this->fb_desc = fb_desc;
 	this->screen_width = screen_width;
 	this->screen_height = screen_height;
 
 	// Scene
 	// -----
 
-	this->nb_vertices = vertices.size();
-
 	// allocate and assign a VAO to vao_id
     glGenVertexArrays(1, &vao);
 
-	// bind our VAO as the current used object: so any operation that would affect a VAO will affect this particular VAO
-	glBindVertexArray(vao);
+	// allocate our VBO (currently only one for vertex) and copy the vertex data to it
+	this->points = std::make_shared<PointBuffer>(vertices);
 
-	// allocate and assign our VBO(s) (currently only one for vertex)
-	glGenBuffers(1, &vertex_vbo);
+	// bind our VAO as the current used object: so any operation that would affect a VAO will affect this particular VAO
+	GLState::Get().BindVertexArray(vao);
 
-    // bind our first VBO as being the active buffer and storing vertex attributes (any operation that would affect a VBO will affect this particular VBO)
-	glBindBuffer(GL_ARRAY_BUFFER, vertex_vbo);
+	// attributes of PointFormat (our vertex VBO)
+	BindPointAttributes();
 
-	// copy the vertex data to our VBO
-	glBufferData(GL_ARRAY_BUFFER, this->nb_vertices * sizeof(vertices[0]), &vertices[0], GL_STATIC_DRAW);
+	// element buffer for the depth sorted draws (the GL_ELEMENT_ARRAY_BUFFER binding is part of the VAO state)
+	glGenBuffers(1, &sorted_ebo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sorted_ebo);
+	this->nb_sorted = 0;
 
-    // Enable attribute index 0 as being used (our vertex VBO)
-    glEnableVertexAttribArray(0);
+	this->mesh_vao = 0;
+	this->mesh_vbo = 0;
+	this->mesh_ebo = 0;
+	this->mesh_nb_indices = 0;
 
-    // Specify that our coordinate data is going into attribute index 0, and contains 3 floats per vertex
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+	GLDEBUG_LABEL(GL_VERTEX_ARRAY, vao, "scene vao");
+	GLDEBUG_LABEL(GL_BUFFER, sorted_ebo, "sorted indices");
 
 	// unbind our VAO as the current used object: so any operation that would affect a VAO will not affect this particular VAO anymore
-	glBindVertexArray(0);
+	GLState::Get().BindVertexArray(0);
 
 
 	// FRAMBUFFER OSR: see https://learnopengl.com/Advanced-OpenGL/Framebuffers
@@ -50,14 +57,17 @@ Render::Render(std::vector<glm::vec3> vertices, int screen_width, int screen_hei
 			normal color/depth or stencil buffer. The advantage of using textures is that the result of all rendering 
 			operations will be stored as a texture image that we can then easily use in our shaders"
 
-		2. Bind to the default framebuffer
+		2. Bind to the default framebuffer (a multisampled target is resolved into the color texture first)
 
 		3. Draw a quad that spans the entire screen with the new framebuffer's color buffer as its texture
 
 			For the "quad screen" vertex shader if we supply the coordinates as normalized device coordinates
 			we can directly specify them as the output of the vertex shader (no need to apply mvp matrix)
+
+			Without post shader the quad pass is skipped: the color texture is blitted to the default framebuffer
 		*/
 
+		// QuadFormat, interleaved
 		float quad_screen[] = { // vertex attributes for a quad that fills the entire screen in Normalized Device Coordinates.
 			// positions   // texCoords
 			-1.0f,  1.0f,  0.0f, 1.0f,
@@ -75,51 +85,115 @@ Render::Render(std::vector<glm::vec3> vertices, int screen_width, int screen_hei
 		glGenVertexArrays(1, &quadVAO);
 		glGenBuffers(1, &quadVBO);
 
-		glBindVertexArray(quadVAO);
+		GLState::Get().BindVertexArray(quadVAO);
 		glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
 		
 		glBufferData(GL_ARRAY_BUFFER, sizeof(quad_screen), &quad_screen, GL_STATIC_DRAW);
 		
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-		
-		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+		static_assert(sizeof(quad_screen) == 6 * QuadFormat::stride, "quad_screen is not 6 QuadFormat vertices");
+
+		QuadFormat::Setup(LAYOUT_INTERLEAVED, 6);
+
+		GLDEBUG_LABEL(GL_VERTEX_ARRAY, quadVAO, "quad vao");
+		GLDEBUG_LABEL(GL_BUFFER, quadVBO, "quad vbo");
 
 		// framebuffer configuration
 		// -------------------------
 
-		glGenFramebuffers(1, &custom_framebuffer);
-		glBindFramebuffer(GL_FRAMEBUFFER, custom_framebuffer);
-		
-		// create a color attachment texture
-		glGenTextures(1, &textureColorbuffer);
-		glBindTexture(GL_TEXTURE_2D, textureColorbuffer);
+		CreateFramebuffer();
+
+		GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, 0);
+		GLState::Get().BindVertexArray(0);
+
+	}
+
+}
+
+/*---------------------------------------------------------------------------*/
+
+void Render::CreateFramebuffer()
+{
+	GLenum internal_format, format, type;
+
+	switch(fb_desc.color_format) {
+		case COLOR_R11F_G11F_B10F:
+			internal_format = GL_R11F_G11F_B10F; format = GL_RGB; type = GL_FLOAT;
+			break;
+		case COLOR_RGBA16F:
+			internal_format = GL_RGBA16F; format = GL_RGBA; type = GL_HALF_FLOAT;
+			break;
+		default:
+			internal_format = GL_RGBA8; format = GL_RGBA; type = GL_UNSIGNED_BYTE;
+			break;
+	}
+
+	bool multisampled = fb_desc.samples > 1;
+
+	// create a color attachment texture
+	glGenTextures(1, &textureColorbuffer);
+	GLState::Get().BindTexture(GL_TEXTURE_2D, textureColorbuffer);
 
-		// we pass NULL as the texture's data parameter. For this texture, we're only allocating memory and not 
-		// actually filling it. Filling the texture will happen as soon as we render to the framebuffer
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, screen_width, screen_height, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	// we pass NULL as the texture's data parameter. For this texture, we're only allocating memory and not 
+	// actually filling it. Filling the texture will happen as soon as we render (or resolve) to the framebuffer
+	glTexImage2D(GL_TEXTURE_2D, 0, internal_format, screen_width, screen_height, 0, format, type, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
+	this->msaa_color_rbo = 0;
+	this->resolve_framebuffer = 0;
+	this->rbo = 0;
+
+	glGenFramebuffers(1, &custom_framebuffer);
+	GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, custom_framebuffer);
+
+	if(multisampled) {
+		// the scene is drawn into a multisampled renderbuffer...
+		glGenRenderbuffers(1, &msaa_color_rbo);
+		glBindRenderbuffer(GL_RENDERBUFFER, msaa_color_rbo);
+		glRenderbufferStorageMultisample(GL_RENDERBUFFER, fb_desc.samples, internal_format, screen_width, screen_height);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, msaa_color_rbo);
+	}
+	else {
 		// attach it to the framebuffer (GL_COLOR_ATTACHMENT0: the type of attachment we're going to attach : here a color attachment)
 		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textureColorbuffer, 0);
-		
-		// create a renderbuffer object for depth and stencil attachment (we won't be sampling these)
+	}
+
+	// create a renderbuffer object for depth and / or stencil attachment, only if asked (we won't be sampling these)
+	if(fb_desc.depth || fb_desc.stencil) {
+		GLenum ds_format = GL_DEPTH24_STENCIL8;
+		GLenum ds_attachment = GL_DEPTH_STENCIL_ATTACHMENT;
+
+		if(!fb_desc.stencil) {
+			ds_format = GL_DEPTH_COMPONENT24;
+			ds_attachment = GL_DEPTH_ATTACHMENT;
+		}
+		else if(!fb_desc.depth) {
+			ds_format = GL_STENCIL_INDEX8;
+			ds_attachment = GL_STENCIL_ATTACHMENT;
+		}
+
 		glGenRenderbuffers(1, &rbo);
 		glBindRenderbuffer(GL_RENDERBUFFER, rbo);
-		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, screen_width, screen_height); // use a single renderbuffer object for both a depth AND stencil buffer.
-		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rbo); // now actually attach it
-		
-		// now that we actually created the framebuffer and added all attachments we want to check if it is actually complete now
-		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-			std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << std::endl;
+		glRenderbufferStorageMultisample(GL_RENDERBUFFER, multisampled ? fb_desc.samples : 0, ds_format, screen_width, screen_height);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, ds_attachment, GL_RENDERBUFFER, rbo); // now actually attach it
+	}
 
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-		glBindVertexArray(0);
+	// now that we actually created the framebuffer and added all attachments we want to check if it is actually complete now
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << std::endl;
 
-	}
+	GLDEBUG_LABEL(GL_FRAMEBUFFER, custom_framebuffer, "offscreen fbo");
+	GLDEBUG_LABEL(GL_TEXTURE, textureColorbuffer, "offscreen color");
 
+	// ...and resolved into the texture
+	if(multisampled) {
+		glGenFramebuffers(1, &resolve_framebuffer);
+		GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, resolve_framebuffer);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textureColorbuffer, 0);
+
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+			std::cout << "ERROR::FRAMEBUFFER:: Resolve framebuffer is not complete!" << std::endl;
+	}
 }
 
 /*---------------------------------------------------------------------------*/
@@ -127,41 +201,224 @@ Render::Render(std::vector<glm::vec3> vertices, int screen_width, int screen_hei
 Render::~Render()
 {
 	// VBO cleanup
-	glDeleteBuffers(1, &vertex_vbo);
+	this->points.reset();
+	glDeleteBuffers(1, &sorted_ebo);
 
 	// VAO cleanup
 	glDeleteVertexArrays(1, &vao);
 
+	if(mesh_vao) {
+		glDeleteVertexArrays(1, &mesh_vao);
+		glDeleteBuffers(1, &mesh_vbo);
+		glDeleteBuffers(1, &mesh_ebo);
+	}
+
 	if(this->use_frambuffer) {
 		glDeleteVertexArrays(1, &quadVAO);
 		glDeleteBuffers(1, &quadVBO);
+
+		glDeleteFramebuffers(1, &custom_framebuffer);
+		glDeleteTextures(1, &textureColorbuffer);
+
+		if(rbo)
+			glDeleteRenderbuffers(1, &rbo);
+
+		if(resolve_framebuffer) {
+			glDeleteFramebuffers(1, &resolve_framebuffer);
+			glDeleteRenderbuffers(1, &msaa_color_rbo);
+		}
 	}
 }
 
 /*---------------------------------------------------------------------------*/
 
+void Render::BindPointAttributes()
+{
+	// the VAO must be bound: the attribute pointer records the buffer currently bound to GL_ARRAY_BUFFER
+	glBindBuffer(GL_ARRAY_BUFFER, points->vbo);
+
+	// PointBuffer holds the positions only
+	static_assert(PointFormat::stride == sizeof(glm::vec3), "PointBuffer stores glm::vec3");
+
+	PointFormat::Setup(LAYOUT_INTERLEAVED, points->capacity);
+}
+
+/*---------------------------------------------------------------------------*/
+
+void Render::Sync()
+{
+	GLDEBUG_GROUP("Render::Sync");
+
+	if(points->Upload()) {
+		// the PointBuffer grew into a new GL buffer
+		GLState::Get().BindVertexArray(vao);
+		BindPointAttributes();
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+
+std::shared_ptr<PointBuffer> Render::SwapPoints(std::shared_ptr<PointBuffer> new_points, const std::vector<PointChunk>& new_chunks)
+{
+	GLDEBUG_GROUP("Render::SwapPoints");
+
+	std::shared_ptr<PointBuffer> old_points = points;
+
+	// a new version: the change tracker and the progressive accumulation see a new scene
+	new_points->version = old_points->version + 1;
+
+	points = new_points;
+	chunks = new_chunks;
+
+	// the sorted indices were built for the previous points
+	nb_sorted = 0;
+
+	GLState::Get().BindVertexArray(vao);
+	BindPointAttributes();
+
+	return old_points;
+}
+
+/*---------------------------------------------------------------------------*/
+
 void Render::DrawScene()
 {
+	GLDEBUG_GROUP("Render::DrawScene");
+
 	// bind our VAO as the current used object: so any operation that would affect a VAO will affect this particular VAO
-	glBindVertexArray(vao);
+	GLState::Get().BindVertexArray(vao);
 
-	//glDrawElements(GL_LINES, this->nb_vertices, GL_UNSIGNED_INT, 0);
+	//glDrawElements(GL_LINES, points->Size(), GL_UNSIGNED_INT, 0);
 	
-	//glDrawArrays(GL_TRIANGLE_STRIP, 0, this->nb_vertices);
+	//glDrawArrays(GL_TRIANGLE_STRIP, 0, points->Size());
 	
-	glDrawArrays(GL_POINTS, 0, this->nb_vertices);
+	GLState::Get().DrawArrays(GL_POINTS, 0, points->Size());
 
-	// unbind our VAO as the current used object: so any operation that would affect a VAO will not affect this particular VAO anymore
-	glBindVertexArray(0);
+	// the VAO stays bound: the next frame's bind is then skipped by the state cache
+}
+
+/*---------------------------------------------------------------------------*/
+
+void Render::UploadSortedIndices(const std::vector<uint32_t>& indices)
+{
+	this->nb_sorted = indices.size();
+
+	GLState::Get().BindVertexArray(vao);
+
+	// re-specify the whole store every frame: the driver orphans the previous one instead of stalling on it
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.empty() ? NULL : &indices[0], GL_STREAM_DRAW);
+
+	GLState::Get().CountUpload(indices.size() * sizeof(uint32_t));
+}
+
+/*---------------------------------------------------------------------------*/
+
+void Render::DrawSceneSorted()
+{
+	DrawSceneSorted(0, this->nb_sorted);
+}
+
+/*---------------------------------------------------------------------------*/
+
+void Render::DrawSceneSorted(unsigned int first, unsigned int count)
+{
+	GLDEBUG_GROUP("Render::DrawSceneSorted");
+
+	if(first >= this->nb_sorted)
+		return;
+
+	count = std::min(count, this->nb_sorted - first);
+
+	GLState::Get().BindVertexArray(vao);
+
+	GLState::Get().DrawElements(GL_POINTS, count, GL_UNSIGNED_INT, (void*)(first * sizeof(uint32_t)));
+}
+
+/*---------------------------------------------------------------------------*/
+
+void Render::UploadMesh(const Mesh& mesh)
+{
+	GLDEBUG_GROUP("Render::UploadMesh");
+
+	if(!mesh_vao) {
+		glGenVertexArrays(1, &mesh_vao);
+		glGenBuffers(1, &mesh_vbo);
+		glGenBuffers(1, &mesh_ebo);
+
+		GLDEBUG_LABEL(GL_VERTEX_ARRAY, mesh_vao, "mesh vao");
+		GLDEBUG_LABEL(GL_BUFFER, mesh_vbo, "mesh vbo");
+		GLDEBUG_LABEL(GL_BUFFER, mesh_ebo, "mesh indices");
+	}
+
+	GLState::Get().BindVertexArray(mesh_vao);
+
+	size_t vertex_bytes = mesh.vertices.size() * sizeof(MeshFormat::Vertex);
+	size_t index_bytes = mesh.indices.size() * sizeof(uint32_t);
+
+	glBindBuffer(GL_ARRAY_BUFFER, mesh_vbo);
+	glBufferData(GL_ARRAY_BUFFER, vertex_bytes, mesh.vertices.empty() ? NULL : &mesh.vertices[0], GL_STATIC_DRAW);
+
+	// the GL_ELEMENT_ARRAY_BUFFER binding is part of the VAO state
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh_ebo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_bytes, mesh.indices.empty() ? NULL : &mesh.indices[0], GL_STATIC_DRAW);
+
+	MeshFormat::Setup(LAYOUT_INTERLEAVED, mesh.vertices.size());
+
+	GLState::Get().CountUpload(vertex_bytes + index_bytes);
+
+	this->mesh_nb_indices = mesh.indices.size();
+}
+
+/*---------------------------------------------------------------------------*/
+
+void Render::DrawMesh()
+{
+	GLDEBUG_GROUP("Render::DrawMesh");
+
+	if(!mesh_nb_indices)
+		return;
+
+	GLState::Get().BindVertexArray(mesh_vao);
+
+	GLState::Get().DrawElements(GL_TRIANGLES, mesh_nb_indices, GL_UNSIGNED_INT, 0);
+}
+
+/*---------------------------------------------------------------------------*/
+
+void Render::ResolveFramebuffer()
+{
+	if(!resolve_framebuffer)
+		return;
+
+	GLDEBUG_GROUP("Render::ResolveFramebuffer");
+
+	GLState::Get().BindFramebuffer(GL_READ_FRAMEBUFFER, custom_framebuffer);
+	GLState::Get().BindFramebuffer(GL_DRAW_FRAMEBUFFER, resolve_framebuffer);
+	glBlitFramebuffer(0, 0, screen_width, screen_height, 0, 0, screen_width, screen_height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+/*---------------------------------------------------------------------------*/
+
+void Render::BlitToScreen()
+{
+	GLDEBUG_GROUP("Render::BlitToScreen");
+
+	// the resolved (single sampled) target
+	GLState::Get().BindFramebuffer(GL_READ_FRAMEBUFFER, resolve_framebuffer ? resolve_framebuffer : custom_framebuffer);
+	GLState::Get().BindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(0, 0, screen_width, screen_height, 0, 0, screen_width, screen_height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
 /*---------------------------------------------------------------------------*/
 
 void Render::DrawQuadScreen()
 {
-	glBindVertexArray(quadVAO);
-	glBindTexture(GL_TEXTURE_2D, textureColorbuffer);	// use the color attachment texture as the texture of the quad plane
-	glDrawArrays(GL_TRIANGLES, 0, 6);
+	GLDEBUG_GROUP("Render::DrawQuadScreen");
 
-	glBindVertexArray(0);
+	GLState::Get().BindVertexArray(quadVAO);
+	GLState::Get().ActiveTexture(0);
+	GLState::Get().BindTexture(GL_TEXTURE_2D, textureColorbuffer);	// use the color attachment texture as the texture of the quad plane
+	GLState::Get().DrawArrays(GL_TRIANGLES, 0, 6);
 }
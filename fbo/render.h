@@ -6,18 +6,70 @@
 #include <glm/glm.hpp>
 #include <string>
 #include <vector>
+#include <memory>
+#include <cstdint>
+
+#include "point_buffer.h"
+#include "morton.h"
+#include "mesh.h"
+
+/*---------------------------------------------------------------------------*/
+
+// offscreen target description
+enum ColorFormat
+{
+	COLOR_RGBA8,
+	COLOR_R11F_G11F_B10F,
+	COLOR_RGBA16F
+};
+
+struct FramebufferDesc
+{
+	ColorFormat color_format = COLOR_RGBA8;
+
+	bool depth = true;
+	bool stencil = false;
+
+	// > 1: multisampled renderbuffers, resolved into textureColorbuffer by ResolveFramebuffer()
+	int samples = 0;
+};
 
 /*---------------------------------------------------------------------------*/
 
 class Render
 {
 	public:
-		Render(std::vector<glm::vec3> vertices, int screen_width, int screen_height, bool use_frambuffer);
+		Render(std::vector<glm::vec3> vertices, int screen_width, int screen_height, bool use_frambuffer, FramebufferDesc fb_desc = FramebufferDesc());
 		virtual ~Render();
 
+		// flush the pending point edits (re-points the VAO if the GL buffer was reallocated)
+		void Sync();
+
+		// draws new_points (filled elsewhere, see GLUploader) from now on, returns the previous buffer
+		std::shared_ptr<PointBuffer> SwapPoints(std::shared_ptr<PointBuffer> new_points, const std::vector<PointChunk>& new_chunks);
+
 		void DrawScene();
+
+		// back to front draw (alpha blended points): glDrawElements with the sorted indices
+		void UploadSortedIndices(const std::vector<uint32_t>& indices);
+		void DrawSceneSorted();
+
+		// count indices of the uploaded order from first (progressive draws)
+		void DrawSceneSorted(unsigned int first, unsigned int count);
+
+		// indexed triangle mesh (MeshFormat, interleaved): replaces the previous one
+		void UploadMesh(const Mesh& mesh);
+		void DrawMesh();
+
+		// MSAA: blit the multisampled target into textureColorbuffer (no-op otherwise)
+		void ResolveFramebuffer();
+
+		// post shader pass: full screen quad sampling textureColorbuffer
 		void DrawQuadScreen();
 
+		// no post shader: copy textureColorbuffer straight to the default framebuffer
+		void BlitToScreen();
+
 	public:
 		bool use_frambuffer;
        	int screen_width;
@@ -26,16 +78,39 @@ class Render
 	public:
 		// Scene attributes
 		GLuint vao;
-		GLuint vertex_vbo;
 
-		unsigned int nb_vertices;
+		// growable vertex VBO: AppendPoints / UpdateRange / RemoveRange then Sync()
+		std::shared_ptr<PointBuffer> points;
+
+		// element buffer filled by UploadSortedIndices()
+		GLuint sorted_ebo;
+		unsigned int nb_sorted;
+
+		// spatial chunks of the points (filled when the points are Morton sorted, empty otherwise)
+		std::vector<PointChunk> chunks;
+
+		// mesh (UploadMesh), 0 until the first upload
+		GLuint mesh_vao;
+		GLuint mesh_vbo;
+		GLuint mesh_ebo;
+		unsigned int mesh_nb_indices;
 
 	public:
 		// Custom framebuffer attributes
+		FramebufferDesc fb_desc;
+
 		unsigned int custom_framebuffer;
 		unsigned int textureColorbuffer;
 		unsigned int rbo;
 
+		// MSAA: custom_framebuffer renders into multisampled renderbuffers, resolve_framebuffer holds textureColorbuffer
+		unsigned int msaa_color_rbo;
+		unsigned int resolve_framebuffer;
+
 		// quad screen 
 		unsigned int quadVAO, quadVBO;
+
+	private:
+		void BindPointAttributes();
+		void CreateFramebuffer();
 };
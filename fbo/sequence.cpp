@@ -0,0 +1,354 @@
+#include "sequence.h"
+#include "render.h"
+#include "gl_uploader.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+
+#include <sys/mman.h>
+
+// KITTI velodyne: x, y, z, reflectance
+static const unsigned int FLOATS_PER_POINT = 4;
+
+/*---------------------------------------------------------------------------*/
+
+// Submit() jobs only run on the pool threads, the caller's slice does not count here: one more
+SequencePlayer::SequencePlayer(unsigned int prefetch, unsigned int io_threads) : io(io_threads + 1)
+{
+	this->loop = true;
+	this->frame_rate = 10.0;
+	this->scale = 1.0f;
+
+	this->position = 0.0;
+	this->last_time = -1.0;
+	this->speed = 1.0;
+	this->paused = false;
+	this->seeked = true;
+
+	this->shown = -1;
+	this->starved_frame = -1;
+	this->back_frame = -1;
+	this->uploading = false;
+
+	for(unsigned int i = 0; i < std::max(2u, prefetch); i++)
+		slots.emplace_back(new Slot());
+}
+
+SequencePlayer::~SequencePlayer()
+{
+	// the pages stay mapped until the slots go: only unpinned here
+	for(auto& slot : slots) {
+		if(slot->locked)
+			munlock(slot->points.data(), slot->points.capacity() * sizeof(glm::vec3));
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+
+bool SequencePlayer::Open(const std::string& directory, double frame_rate, float scale)
+{
+	namespace fs = std::filesystem;
+
+	std::error_code error;
+
+	for(const auto& entry : fs::directory_iterator(directory, error)) {
+		if(!entry.is_regular_file() || entry.path().extension() != ".bin")
+			continue;
+
+		Frame frame;
+		frame.path = entry.path().string();
+		frame.nb_points = entry.file_size() / (FLOATS_PER_POINT * sizeof(float));
+
+		frames.push_back(frame);
+	}
+
+	if(error || frames.empty()) {
+		std::cout << "ERROR::SEQUENCE:: no .bin frame in " << directory << std::endl;
+		return false;
+	}
+
+	std::sort(frames.begin(), frames.end(), [](const Frame& a, const Frame& b) { return a.path < b.path; });
+
+	this->frame_rate = frame_rate;
+	this->scale = scale;
+
+	unsigned int max_points = 0;
+
+	for(const auto& f : frames)
+		max_points = std::max(max_points, f.nb_points);
+
+	// staging: sized for the largest frame, locked once (no page faults nor allocation while playing)
+	bool pinned = true;
+
+	for(auto& slot : slots) {
+		slot->points.reserve(max_points);
+
+		if(mlock(slot->points.data(), max_points * sizeof(glm::vec3)) == 0)
+			slot->locked = true;
+		else
+			pinned = false;
+	}
+
+	if(!pinned)
+		std::cout << "SequencePlayer: staging memory not locked (RLIMIT_MEMLOCK), pageable" << std::endl;
+
+	// the second buffer of the pair drawn by Render (the first one grows once, on its first frame)
+	back = std::make_shared<PointBuffer>(std::vector<glm::vec3>());
+	back->points.reserve(max_points);
+
+	std::cout << "SequencePlayer: " << frames.size() << " frames at " << frame_rate << " Hz, up to " << max_points << " points, "
+		<< slots.size() << " frames prefetched" << std::endl;
+
+	return true;
+}
+
+/*---------------------------------------------------------------------------*/
+
+// I/O thread
+void SequencePlayer::Read(Slot& slot, const std::string& path, unsigned int nb_points)
+{
+	TRACE_SCOPE("sequence read");
+
+	auto start = std::chrono::steady_clock::now();
+
+	// file records, per I/O thread
+	static thread_local std::vector<float> raw;
+	raw.resize((size_t)nb_points * FLOATS_PER_POINT);
+
+	FILE* file = fopen(path.c_str(), "rb");
+	bool ok = file && fread(raw.data(), sizeof(float) * FLOATS_PER_POINT, nb_points, file) == nb_points;
+
+	if(file)
+		fclose(file);
+
+	if(!ok) {
+		slot.state.store(SLOT_FAILED, std::memory_order_release);
+		return;
+	}
+
+	// within the block reserved by Open()
+	slot.points.resize(nb_points);
+
+	// z up -> y up
+	for(unsigned int i = 0; i < nb_points; i++) {
+		const float* r = &raw[(size_t)i * FLOATS_PER_POINT];
+		slot.points[i] = glm::vec3(r[0], r[2], -r[1]) * scale;
+	}
+
+	slot.read_ms = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() * 1e3;
+	slot.state.store(SLOT_READY, std::memory_order_release);
+}
+
+/*---------------------------------------------------------------------------*/
+
+int SequencePlayer::Step() const
+{
+	// faster than recorded: every step-th frame is due, only those are read
+	return std::max(1, (int)std::floor(speed));
+}
+
+int SequencePlayer::Next(int frame, int step) const
+{
+	int n = frames.size();
+
+	if(loop)
+		return (frame + step) % n;
+
+	return std::min(frame + step, n - 1);
+}
+
+SequencePlayer::Slot* SequencePlayer::Find(int frame)
+{
+	for(auto& slot : slots) {
+		if(slot->frame == frame)
+			return slot.get();
+	}
+
+	return nullptr;
+}
+
+void SequencePlayer::Prefetch(int target)
+{
+	// the frames due next, nearest first
+	int wanted[64];
+	int nb_wanted = 0;
+	int step = Step();
+
+	for(int f = target; nb_wanted < (int)std::min(slots.size(), (size_t)64); f = Next(f, step)) {
+		if(std::find(wanted, wanted + nb_wanted, f) != wanted + nb_wanted)
+			break;
+
+		wanted[nb_wanted++] = f;
+	}
+
+	for(int w = 0; w < nb_wanted; w++) {
+		int f = wanted[w];
+
+		// on the GPU or being read already
+		if(f == back_frame || f == shown || Find(f))
+			continue;
+
+		// a slot holding none of the wanted frames, and no read in progress
+		Slot* free_slot = nullptr;
+
+		for(auto& slot : slots) {
+			if(slot->state.load(std::memory_order_acquire) == SLOT_READING)
+				continue;
+
+			if(std::find(wanted, wanted + nb_wanted, slot->frame) == wanted + nb_wanted) {
+				free_slot = slot.get();
+				break;
+			}
+		}
+
+		if(!free_slot)
+			return;
+
+		free_slot->frame = f;
+		free_slot->state.store(SLOT_READING, std::memory_order_relaxed);
+
+		Slot* slot = free_slot;
+
+		// frames is not modified after Open()
+		io.Submit([this, slot, f]() { Read(*slot, frames[f].path, frames[f].nb_points); });
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+
+bool SequencePlayer::Update(Render& render, GLUploader* uploader, double now)
+{
+	if(frames.empty())
+		return false;
+
+	TRACE_SCOPE("sequence");
+
+	int n = frames.size();
+
+	// playback clock
+	if(last_time >= 0.0 && !paused)
+		position += (now - last_time) * frame_rate * speed;
+
+	last_time = now;
+
+	if(position >= n) {
+		if(loop) {
+			position = std::fmod(position, (double)n);
+		}
+		else {
+			position = n - 1;
+			paused = true;
+		}
+	}
+
+	int target = (int)position;
+
+	// faster than recorded: the due frames are on the stride
+	int step = Step();
+	target -= target % step;
+
+	Prefetch(target);
+
+	// what the back buffer should hold: the due frame, or the one after the visible frame
+	int next = target != shown ? target : Next(target, step);
+
+	if(!uploading && back_frame != next) {
+		Slot* slot = Find(next);
+
+		if(slot && slot->state.load(std::memory_order_acquire) == SLOT_READY) {
+			stats.read_ms_sum += slot->read_ms;
+			stats.read_ms_max = std::max(stats.read_ms_max, slot->read_ms);
+			stats.reads++;
+
+			// copied: the staging block stays in the slot, the back buffer keeps its own
+			back->Replace(slot->points.data(), slot->points.size(), uploader == nullptr);
+
+			slot->frame = -1;
+			slot->state.store(SLOT_EMPTY, std::memory_order_relaxed);
+
+			back_frame = next;
+
+			// the loader context writes the store, the buffer is drawn once its fence is signaled
+			if(uploader) {
+				uploading = true;
+
+				std::shared_ptr<PointBuffer> buffer = back;
+
+				uploader -> Submit([buffer]() { buffer->WriteStore(); }, [this]() { uploading = false; });
+			}
+		}
+		else if(slot && slot->state.load(std::memory_order_acquire) == SLOT_FAILED) {
+			std::cout << "ERROR::SEQUENCE:: cannot read " << frames[next].path << std::endl;
+
+			stats.read_errors++;
+			slot->frame = -1;
+			slot->state.store(SLOT_EMPTY, std::memory_order_relaxed);
+		}
+	}
+
+	if(target == shown)
+		return false;
+
+	if(back_frame != target || uploading) {
+		// due and not on the GPU: the previous frame stays up
+		if(starved_frame != target) {
+			starved_frame = target;
+			stats.starved++;
+		}
+
+		return false;
+	}
+
+	// frames passed over while starving
+	if(!seeked && shown >= 0) {
+		int distance = (target - shown + n) % n;
+
+		if(distance > step)
+			stats.skipped += distance / step - 1;
+	}
+
+	std::shared_ptr<PointBuffer> drawn = render.SwapPoints(back, std::vector<PointChunk>());
+
+	back = drawn;
+	back_frame = -1;
+	shown = target;
+	seeked = false;
+	stats.shown++;
+
+	return true;
+}
+
+/*---------------------------------------------------------------------------*/
+
+void SequencePlayer::SetSpeed(double speed)
+{
+	this->speed = std::min(std::max(speed, 1.0 / 16.0), 16.0);
+}
+
+void SequencePlayer::Seek(int frame)
+{
+	int n = frames.size();
+
+	if(n == 0)
+		return;
+
+	position = loop ? ((frame % n) + n) % n : std::min(std::max(frame, 0), n - 1);
+	seeked = true;
+}
+
+/*---------------------------------------------------------------------------*/
+
+void SequencePlayer::Report() const
+{
+	// a due frame is shown (on time or late) or skipped
+	unsigned int due = stats.shown + stats.skipped;
+
+	printf("SequencePlayer: %u frames shown, %u skipped, starved %u times (%.1f%% of the due frames), %u read errors, read %.2f ms avg (max %.2f)\n",
+		stats.shown, stats.skipped, stats.starved, due ? 100.0 * stats.starved / due : 0.0, stats.read_errors,
+		stats.reads ? stats.read_ms_sum / stats.reads : 0.0, stats.read_ms_max);
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#define GLM_ENABLE_EXPERIMENTAL
+
+#include <glm/glm.hpp>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "point_buffer.h"
+#include "worker_pool.h"
+
+class Render;
+class GLUploader;
+
+/*---------------------------------------------------------------------------*/
+
+struct SequenceStats
+{
+	unsigned int shown = 0;
+
+	// a frame's time came and it was not on the GPU yet: the previous frame stayed
+	unsigned int starved = 0;
+
+	// frames passed over while starving (not counted: seeks, the stride of speeds > 1)
+	unsigned int skipped = 0;
+
+	unsigned int read_errors = 0;
+
+	// I/O thread time per frame file
+	double read_ms_sum = 0.0;
+	double read_ms_max = 0.0;
+	unsigned int reads = 0;
+};
+
+/*
+	Playback of a recorded scan: a directory of frame files, one point cloud each, in
+	file name order (KITTI velodyne .bin: float32 x, y, z, reflectance per point, z up,
+	in meters; scaled and turned y up on read).
+
+	The playback clock (frame_rate x speed) runs on the wall clock, not on the render
+	frames. Update(), once per render frame:
+	  - queues the reads of the next `prefetch` frames on the I/O threads, into staging
+	    slots sized once for the largest frame and locked in RAM (mlock), reused for the
+	    whole playback,
+	  - copies the next frame into the back PointBuffer as soon as it is read (its block
+	    is reused too) and uploads it (through the GLUploader when there is one, inline
+	    otherwise),
+	  - swaps the back and the drawn buffers (Render::SwapPoints) when that frame's time
+	    has come: the visible frame always changes in one piece.
+	A frame due and not in the back buffer yet is a starve: the previous one stays up.
+*/
+
+class SequencePlayer
+{
+	public:
+		SequencePlayer(unsigned int prefetch = 8, unsigned int io_threads = 2);
+		virtual ~SequencePlayer();
+
+		// indexes the frame files, sizes and locks the staging slots
+		bool Open(const std::string& directory, double frame_rate = 10.0, float scale = 1.0f / 40.0f);
+
+		unsigned int NbFrames() const { return frames.size(); }
+
+		// render thread, once per frame (now: seconds, any monotonic clock)
+		// returns true when the drawn points changed
+		bool Update(Render& render, GLUploader* uploader, double now);
+
+		void Pause(bool paused) { this->paused = paused; }
+		bool Paused() const { return paused; }
+
+		// playback speed, > 0 (2: twice the recorded rate)
+		void SetSpeed(double speed);
+		double Speed() const { return speed; }
+
+		void Seek(int frame);
+
+		// on screen
+		int Shown() const { return shown; }
+
+		void Report() const;
+
+	public:
+		bool loop;
+
+		SequenceStats stats;
+
+	private:
+		struct Frame
+		{
+			std::string path;
+			unsigned int nb_points;
+		};
+
+		enum SlotState
+		{
+			SLOT_EMPTY,
+			SLOT_READING,
+			SLOT_READY,
+			SLOT_FAILED
+		};
+
+		struct Slot
+		{
+			// written by the render thread while no read is queued
+			int frame = -1;
+			std::atomic<int> state{SLOT_EMPTY};
+
+			std::vector<glm::vec3> points;
+
+			// reserved for the largest frame by Open(), never reallocated: locked for the whole playback
+			bool locked = false;
+
+			double read_ms = 0.0;
+		};
+
+		void Read(Slot& slot, const std::string& path, unsigned int nb_points);
+		void Prefetch(int target);
+		Slot* Find(int frame);
+		int Next(int frame, int step) const;
+		int Step() const;
+
+		std::vector<Frame> frames;
+		double frame_rate;
+		float scale;
+
+		// playback clock, in frames
+		double position;
+		double last_time;
+		double speed;
+		bool paused;
+		bool seeked;
+
+		int shown;
+		int starved_frame;
+
+		// back buffer: holds back_frame, drawable once uploading is false
+		std::shared_ptr<PointBuffer> back;
+		int back_frame;
+		bool uploading;
+
+		std::vector<std::unique_ptr<Slot>> slots;
+
+		// last member: joined (pending reads done) before the slots go
+		WorkerPool io;
+};
@@ -1,20 +1,43 @@
 #include "shader.h"
+#include "frame_uniforms.h"
+#include "gl_state.h"
+#include "gl_debug.h"
 #include <iostream>
 #include <fstream>
 #include <memory>
+#include <cstring>
 
 #include <GL/glew.h>
 
 /*---------------------------------------------------------------------------*/
 
-Shader::Shader(const std::string& vertexShaderFilename, const std::string& fragmentShaderFilename)
+Shader::Shader(const std::string& vertexShaderFilename, const std::string& fragmentShaderFilename) : Shader(Load(vertexShaderFilename, fragmentShaderFilename))
+{
+}
+
+/*---------------------------------------------------------------------------*/
+
+ShaderSource Shader::Load(const std::string& vertexShaderFilename, const std::string& fragmentShaderFilename)
+{
+	ShaderSource source;
+
+	source.vertex_file = vertexShaderFilename;
+	source.vertex = LoadShader(vertexShaderFilename);
+	source.fragment = LoadShader(fragmentShaderFilename);
+
+	return source;
+}
+
+/*---------------------------------------------------------------------------*/
+
+Shader::Shader(const ShaderSource& source)
 {
     // assign our program handle a "name"
 	programID = glCreateProgram();
 
     // creates and compiles vertex/fragment shaders
-	vertexShaderID = CreateShader(LoadShader(vertexShaderFilename), GL_VERTEX_SHADER);
-	fragmentShaderID = CreateShader(LoadShader(fragmentShaderFilename), GL_FRAGMENT_SHADER);
+	vertexShaderID = CreateShader(source.vertex, GL_VERTEX_SHADER);
+	fragmentShaderID = CreateShader(source.fragment, GL_FRAGMENT_SHADER);
 
     // attach our shaders to our program
 	glAttachShader(programID, vertexShaderID);
@@ -33,6 +56,11 @@ Shader::Shader(const std::string& vertexShaderFilename, const std::string& fragm
 	CheckShaderError(programID, GL_LINK_STATUS, true, "Invalid shader program");
 
     //mvpID = glGetUniformLocation(program, "mvp");
+
+    // FrameData / ObjectData blocks (shaders/frame_data.glsl) to their fixed binding points
+    FrameUniforms::BindBlocks(programID);
+
+    GLDEBUG_LABEL(GL_PROGRAM, programID, source.vertex_file.c_str());
 }
 
 /*---------------------------------------------------------------------------*/
@@ -73,23 +101,55 @@ GLuint Shader::CreateShader(const std::string& text, unsigned int type)
 
 /*---------------------------------------------------------------------------*/
 
-void Shader::setMat4(const std::string &name, const glm::mat4 &mat)
+GLint Shader::Location(const char* name)
+{
+    // a few uniforms per program: a linear search, the string is only built on the first lookup
+    for(const auto& l : locations)
+    {
+        if(strcmp(l.first.c_str(), name) == 0)
+            return l.second;
+    }
+
+    GLint location = glGetUniformLocation(programID, name);
+    locations.push_back(std::make_pair(std::string(name), location));
+
+    return location;
+}
+
+/*---------------------------------------------------------------------------*/
+
+void Shader::setMat4(const char* name, const glm::mat4 &mat)
 {
-    glUniformMatrix4fv(glGetUniformLocation(programID, name.c_str()), 1, GL_FALSE, glm::value_ptr(mat));
+    glUniformMatrix4fv(Location(name), 1, GL_FALSE, glm::value_ptr(mat));
+}
+
+/*---------------------------------------------------------------------------*/
+
+void Shader::setInt(const char* name, int value)
+{ 
+    glUniform1i(Location(name), value); 
 }
 
 /*---------------------------------------------------------------------------*/
 
-void Shader::setInt(const std::string &name, int value)
+void Shader::setFloat(const char* name, float value)
 { 
-    glUniform1i(glGetUniformLocation(programID, name.c_str()), value); 
+    glUniform1f(Location(name), value); 
+}
+
+/*---------------------------------------------------------------------------*/
+
+void Shader::setVec3(const char* name, const glm::vec3 &value)
+{ 
+    glUniform3fv(Location(name), 1, glm::value_ptr(value)); 
 }
 
 /*---------------------------------------------------------------------------*/
 
 void Shader::Use()
 {
-	glUseProgram(programID);
+	// skipped if the program is already in use
+	GLState::Get().UseProgram(programID);
 }
 
 /*---------------------------------------------------------------------------*/
@@ -107,6 +167,21 @@ std::string Shader::LoadShader(const std::string& fileName)
         while(file.good())
         {
             getline(file, line);
+
+            // #include "file": GLSL has none, the file (relative to this one) is pasted in place
+            if(line.compare(0, 9, "#include ") == 0)
+            {
+                size_t first = line.find('"');
+                size_t last = line.rfind('"');
+
+                if(first != std::string::npos && last > first)
+                {
+                    std::string dir = fileName.substr(0, fileName.rfind('/') + 1);
+                    output.append(LoadShader(dir + line.substr(first + 1, last - first - 1)));
+                    continue;
+                }
+            }
+
 			output.append(line + "\n");
         }
     }
@@ -2,6 +2,7 @@
 
 #include <string>
 #include <memory>
+#include <vector>
 
 #define GLM_ENABLE_EXPERIMENTAL
 
@@ -12,22 +13,43 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+// shader texts with their #include expanded (no GL: can be read on any thread)
+struct ShaderSource
+{
+	std::string vertex_file;
+	std::string vertex;
+	std::string fragment;
+};
+
 class Shader
 {
 	public:
 		Shader(const std::string& vertexShaderFilename, const std::string& fragmentShaderFilename);
+
+		// compiled from sources read beforehand (Load)
+		Shader(const ShaderSource& source);
 		virtual ~Shader();
 
+		static ShaderSource Load(const std::string& vertexShaderFilename, const std::string& fragmentShaderFilename);
+
 		void Use();
-		void setMat4(const std::string &name, const glm::mat4 &mat);
-		void setInt(const std::string &name, int value);
+		// names are C strings: no std::string built per call
+		void setMat4(const char* name, const glm::mat4 &mat);
+		void setInt(const char* name, int value);
+		void setFloat(const char* name, float value);
+		void setVec3(const char* name, const glm::vec3 &value);
+
+		// glGetUniformLocation, cached per name
+		GLint Location(const char* name);
 
 	private:
-		std::string LoadShader(const std::string& fileName);
+		static std::string LoadShader(const std::string& fileName);
 		void CheckShaderError(GLuint shader, GLuint flag, bool isProgram, const std::string& errorMessage);
 		GLuint CreateShader(const std::string& text, unsigned int type);
 
 		GLuint vertexShaderID;
 		GLuint fragmentShaderID;
 		GLuint programID;
+
+		std::vector<std::pair<std::string, GLint>> locations;
 };
@@ -0,0 +1,7 @@
+#version 330 core
+
+// color writes are masked, only the samples passing the depth test count
+void main()
+{
+	gl_FragColor = vec4(1.0, 0.0, 0.0, 1.0);
+}
@@ -0,0 +1,13 @@
+#version 330 core
+#include "frame_data.glsl"
+
+// unit cube scaled to a chunk bounding box (occlusion query proxy)
+layout (location = 0) in vec3 position;
+
+uniform vec3 bmin;
+uniform vec3 bmax;
+
+void main()
+{
+	gl_Position = object.mvp * vec4(mix(bmin, bmax, position), 1.0);
+}
@@ -0,0 +1,18 @@
+// per-frame / per-object uniform blocks (FrameUniforms), std140: keep in sync with frame_uniforms.h
+// #include "frame_data.glsl" after the #version line
+
+layout (std140) uniform FrameData
+{
+	mat4 view;
+	mat4 projection;
+	mat4 view_projection;
+	vec4 viewport; // width, height, 1 / width, 1 / height
+	float time;
+} frame;
+
+layout (std140) uniform ObjectData
+{
+	mat4 model;
+	mat4 mvp;
+	vec4 params; // x: alpha
+} object;
@@ -0,0 +1,12 @@
+#version 330 core
+#include "frame_data.glsl"
+
+varying vec3 view_normal;
+
+void main()
+{
+	// head light, both sides lit (scans are rarely closed surfaces)
+	float col = 0.2 + 0.8 * abs(normalize(view_normal).z);
+
+	gl_FragColor = vec4(col, col, col, object.params.x);
+}
@@ -0,0 +1,15 @@
+#version 330 core
+#include "frame_data.glsl"
+
+layout (location = 0) in vec3 position;
+layout (location = 3) in vec3 normal;
+
+varying vec3 view_normal;
+
+void main()
+{
+	gl_Position = object.mvp * vec4(position, 1.0);
+
+	// uniform scale in the model matrix: no normal matrix needed
+	view_normal = mat3(frame.view * object.model) * normal;
+}
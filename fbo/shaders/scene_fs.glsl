@@ -1,9 +1,12 @@
 #version 330 core
+#include "frame_data.glsl"
 
 varying vec3 point_color;
 
 void main()
 {
 	float col = point_color.z;	
-	gl_FragColor = vec4(col, col, col, 1.0);
+
+	// alpha < 1.0 only for the depth sorted, blended draw
+	gl_FragColor = vec4(col, col, col, object.params.x);
 }
@@ -0,0 +1,29 @@
+#version 330 core
+#extension GL_ARB_shader_viewport_layer_array : enable
+#extension GL_AMD_vertex_shader_viewport_index : enable
+
+layout (location = 0) in vec3 position;
+
+// the ObjectData of the views, consecutive FrameUniforms slots of VIEW_STRIDE vec4 each
+// (defined by MultiView: FrameUniforms::ObjectStride() / 16), 16 views (MultiView::MAX_VIEWS)
+layout (std140) uniform ObjectArray
+{
+	vec4 slots[16 * VIEW_STRIDE];
+} views;
+
+// instance -> view, set per draw: an instance only draws the chunks its view sees
+uniform int view_index[16];
+
+varying vec3 point_color;
+
+void main()
+{
+	int v = view_index[gl_InstanceID];
+
+	// ObjectData: model (4 columns), mvp (4 columns), params
+	int mvp = v * VIEW_STRIDE + 4;
+
+	gl_Position = mat4(views.slots[mvp], views.slots[mvp + 1], views.slots[mvp + 2], views.slots[mvp + 3]) * vec4(position, 1.0);
+	gl_ViewportIndex = v;
+	point_color = vec3(1.0, 1.0, 1.0);
+}
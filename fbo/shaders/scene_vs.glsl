@@ -1,13 +1,12 @@
 #version 330 core
+#include "frame_data.glsl"
 
 layout (location = 0) in vec3 position;
 
-uniform mat4 mvp;
-
 varying vec3 point_color;
 
 void main()
 {
-	gl_Position = mvp * vec4(position, 1.0);
+	gl_Position = object.mvp * vec4(position, 1.0);
 	point_color = vec3(1.0, 1.0, 1.0);
 }
@@ -0,0 +1,202 @@
+#include "soft_raster.h"
+#include "ppm.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*---------------------------------------------------------------------------*/
+
+SoftRasterizer::SoftRasterizer(int width, int height, WorkerPool& pool) : pool(pool)
+{
+	this->width = width;
+	this->height = height;
+	this->visible = 0;
+
+	tiles_x = (width + (1 << TILE_SHIFT) - 1) >> TILE_SHIFT;
+	tiles_y = (height + (1 << TILE_SHIFT) - 1) >> TILE_SHIFT;
+
+	unsigned int nb_tiles = tiles_x * tiles_y;
+
+	// round robin: a slice of tile_order holds tiles of the whole screen
+	const unsigned int stride = 7;
+
+	for(unsigned int k = 0; k < stride; k++) {
+		for(unsigned int t = k; t < nb_tiles; t += stride)
+			tile_order.push_back(t);
+	}
+
+	bins.resize(pool.Size(), std::vector<std::vector<Fragment>>(nb_tiles));
+
+	color.assign((size_t)width * height, 0);
+	depth.assign((size_t)width * height, 1.0f);
+}
+
+/*---------------------------------------------------------------------------*/
+
+void SoftRasterizer::Transform(const std::vector<glm::vec3>& points, size_t begin, size_t end, const glm::mat4& mvp, std::vector<std::vector<Fragment>>& tile_bins)
+{
+	const float half_width = 0.5f * width;
+	const float half_height = 0.5f * height;
+
+	// clip space -> window, the center of the point is inside the clip volume
+	auto emit = [&](float x, float y, float z, float w)
+	{
+		float inv_w = 1.0f / w;
+
+		int ix = std::min((int)(x * inv_w * half_width + half_width), width - 1);
+		int iy = std::min((int)(y * inv_w * half_height + half_height), height - 1);
+
+		unsigned int tile = (iy >> TILE_SHIFT) * tiles_x + (ix >> TILE_SHIFT);
+		Fragment f = { (uint32_t)(iy * width + ix), z * inv_w * 0.5f + 0.5f };
+
+		tile_bins[tile].push_back(f);
+	};
+
+	auto inside = [](float x, float y, float z, float w)
+	{
+		return w > 0.0f && x >= -w && x <= w && y >= -w && y <= w && z >= -w && z <= w;
+	};
+
+	size_t i = begin;
+
+#if defined(__SSE2__)
+	// columns of the matrix, splatted once
+	__m128 m[4][4];
+
+	for(int c = 0; c < 4; c++) {
+		for(int r = 0; r < 4; r++)
+			m[c][r] = _mm_set1_ps(mvp[c][r]);
+	}
+
+	alignas(16) float cx[4], cy[4], cz[4], cw[4];
+
+	for(; i + 4 <= end; i += 4) {
+		const glm::vec3* p = &points[i];
+
+		__m128 px = _mm_setr_ps(p[0].x, p[1].x, p[2].x, p[3].x);
+		__m128 py = _mm_setr_ps(p[0].y, p[1].y, p[2].y, p[3].y);
+		__m128 pz = _mm_setr_ps(p[0].z, p[1].z, p[2].z, p[3].z);
+
+		__m128 clip[4];
+
+		for(int r = 0; r < 4; r++)
+			clip[r] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[0][r], px), _mm_mul_ps(m[1][r], py)), _mm_add_ps(_mm_mul_ps(m[2][r], pz), m[3][r]));
+
+		// -w <= x, y, z <= w (and w > 0)
+		__m128 w = clip[3];
+		__m128 neg_w = _mm_sub_ps(_mm_setzero_ps(), w);
+		__m128 in = _mm_cmpgt_ps(w, _mm_setzero_ps());
+
+		for(int r = 0; r < 3; r++)
+			in = _mm_and_ps(in, _mm_and_ps(_mm_cmpge_ps(clip[r], neg_w), _mm_cmple_ps(clip[r], w)));
+
+		int mask = _mm_movemask_ps(in);
+
+		// group fully clipped (off screen, behind the camera): no scalar work
+		if(!mask)
+			continue;
+
+		_mm_store_ps(cx, clip[0]);
+		_mm_store_ps(cy, clip[1]);
+		_mm_store_ps(cz, clip[2]);
+		_mm_store_ps(cw, clip[3]);
+
+		for(int k = 0; k < 4; k++) {
+			if(mask & (1 << k))
+				emit(cx[k], cy[k], cz[k], cw[k]);
+		}
+	}
+#endif
+
+	// scalar tail (or whole range without SSE)
+	for(; i < end; i++) {
+		glm::vec4 clip = mvp * glm::vec4(points[i], 1.0f);
+
+		if(inside(clip.x, clip.y, clip.z, clip.w))
+			emit(clip.x, clip.y, clip.z, clip.w);
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+
+void SoftRasterizer::Splat(unsigned int tile, uint32_t point_color, uint32_t clear_color)
+{
+	int x0 = (tile % tiles_x) << TILE_SHIFT;
+	int y0 = (tile / tiles_x) << TILE_SHIFT;
+	int x1 = std::min(x0 + (1 << TILE_SHIFT), width);
+	int y1 = std::min(y0 + (1 << TILE_SHIFT), height);
+
+	for(int y = y0; y < y1; y++) {
+		std::fill(&color[(size_t)y * width + x0], &color[(size_t)y * width + x1], clear_color);
+		std::fill(&depth[(size_t)y * width + x0], &depth[(size_t)y * width + x1], 1.0f);
+	}
+
+	// slices in order, bins in point order: the first of two equal depths wins, as with GL_LESS
+	for(auto& slice_bins : bins) {
+		for(const Fragment& f : slice_bins[tile]) {
+			if(f.depth < depth[f.pixel]) {
+				depth[f.pixel] = f.depth;
+				color[f.pixel] = point_color;
+			}
+		}
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+
+void SoftRasterizer::Draw(const std::vector<glm::vec3>& points, const glm::mat4& mvp, uint32_t point_color, uint32_t clear_color)
+{
+	for(auto& slice_bins : bins) {
+		for(auto& bin : slice_bins)
+			bin.clear();
+	}
+
+	pool.ParallelFor(points.size(), [&](size_t begin, size_t end, unsigned int slice)
+	{
+		Transform(points, begin, end, mvp, bins[slice]);
+	});
+
+	pool.ParallelFor(tile_order.size(), [&](size_t begin, size_t end, unsigned int)
+	{
+		for(size_t i = begin; i < end; i++)
+			Splat(tile_order[i], point_color, clear_color);
+	});
+
+	visible = 0;
+
+	for(auto& slice_bins : bins) {
+		for(auto& bin : slice_bins)
+			visible += bin.size();
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+
+bool SoftRasterizer::WritePPM(const std::string& path) const
+{
+	return ::WritePPM(path, width, height, Pixels());
+}
+
+/*---------------------------------------------------------------------------*/
+
+double SoftRasterizer::Compare(const unsigned char* rgba, int tolerance) const
+{
+	const unsigned char* pixels = Pixels();
+	size_t nb_pixels = (size_t)width * height;
+	size_t different = 0;
+
+	for(size_t p = 0; p < nb_pixels; p++) {
+		for(int c = 0; c < 4; c++) {
+			if(std::abs((int)pixels[4 * p + c] - (int)rgba[4 * p + c]) > tolerance) {
+				different++;
+				break;
+			}
+		}
+	}
+
+	return nb_pixels ? (double)different / nb_pixels : 0.0;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#define GLM_ENABLE_EXPERIMENTAL
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "worker_pool.h"
+
+/*---------------------------------------------------------------------------*/
+
+/*
+	CPU point rasterizer, no GL context needed (GPU-less nodes, reference images).
+
+	Same rules as the GL path for GL_POINTS of size 1 with GL_LESS depth test: a point
+	is dropped when its center is outside the clip volume, otherwise it covers the pixel
+	containing its window position.
+
+	1. transform: each worker takes a slice of the points, 4 points per SSE iteration
+	   (scalar fallback), and bins the visible ones by screen tile
+	2. splat: each worker takes whole tiles (dealt round robin: the dense tiles of the
+	   middle of the screen are spread over the workers) and depth tests the points of
+	   the tile bins, in the point order: no two workers touch the same pixel, no atomics
+
+	The color buffer is RGBA8, rows bottom up: the layout glReadPixels(GL_RGBA,
+	GL_UNSIGNED_BYTE) returns, so readback / capture code takes both.
+*/
+
+class SoftRasterizer
+{
+	public:
+		SoftRasterizer(int width, int height, WorkerPool& pool = WorkerPool::Instance());
+		virtual ~SoftRasterizer() {}
+
+		// clears and draws the points (colors: RGBA bytes packed little endian, 0xAABBGGRR)
+		void Draw(const std::vector<glm::vec3>& points, const glm::mat4& mvp, uint32_t point_color = 0xffffffff, uint32_t clear_color = 0xff000000);
+
+		const unsigned char* Pixels() const { return (const unsigned char*)&color[0]; }
+
+		// binary PPM, top row first
+		bool WritePPM(const std::string& path) const;
+
+		// fraction of the pixels with a channel differing by more than tolerance from rgba (same layout and size)
+		double Compare(const unsigned char* rgba, int tolerance = 0) const;
+
+	public:
+		int width;
+		int height;
+
+		// points inside the clip volume in the last Draw()
+		size_t visible;
+
+	private:
+		static const int TILE_SHIFT = 6; // 64x64 pixel tiles
+
+		struct Fragment
+		{
+			uint32_t pixel;
+			float depth;
+		};
+
+		void Transform(const std::vector<glm::vec3>& points, size_t begin, size_t end, const glm::mat4& mvp, std::vector<std::vector<Fragment>>& tile_bins);
+		void Splat(unsigned int tile, uint32_t point_color, uint32_t clear_color);
+
+		WorkerPool& pool;
+
+		int tiles_x;
+		int tiles_y;
+
+		// tile order of the splat pass
+		std::vector<unsigned int> tile_order;
+
+		// bins[slice][tile], kept between frames (no re-allocations)
+		std::vector<std::vector<std::vector<Fragment>>> bins;
+
+		std::vector<uint32_t> color;
+		std::vector<float> depth;
+};
@@ -0,0 +1,169 @@
+#include "startup.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cstdio>
+
+/*---------------------------------------------------------------------------*/
+
+// the WorkerPool caller runs a ParallelFor slice, not a Submit() job: one more slice for nb_threads threads
+StartupGraph::StartupGraph(unsigned int nb_threads) : pool(nb_threads + 1)
+{
+	creation = std::chrono::steady_clock::now();
+	done = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+
+double StartupGraph::Elapsed() const
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - creation).count() * 1e3;
+}
+
+/*---------------------------------------------------------------------------*/
+
+int StartupGraph::AddStage(const char* name, bool main, const std::vector<int>& dependencies, std::function<void()> fn)
+{
+	int id = stages.size();
+
+	Stage stage;
+	stage.name = name;
+	stage.main = main;
+	stage.fn = std::move(fn);
+	stage.waiting = dependencies.size();
+	stage.start = 0.0;
+	stage.end = 0.0;
+
+	stages.push_back(std::move(stage));
+
+	for(int d : dependencies)
+		stages[d].dependents.push_back(id);
+
+	return id;
+}
+
+int StartupGraph::Add(const char* name, const std::vector<int>& dependencies, std::function<void()> fn)
+{
+	return AddStage(name, false, dependencies, std::move(fn));
+}
+
+int StartupGraph::AddMain(const char* name, const std::vector<int>& dependencies, std::function<void()> fn)
+{
+	return AddStage(name, true, dependencies, std::move(fn));
+}
+
+/*---------------------------------------------------------------------------*/
+
+void StartupGraph::Launch(int id)
+{
+	if(stages[id].main) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			main_ready.push_back(id);
+		}
+
+		cv.notify_all();
+	}
+	else {
+		pool.Submit([this, id]() { Execute(id); });
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+
+void StartupGraph::Execute(int id)
+{
+	Stage& stage = stages[id];
+
+	stage.start = Elapsed();
+
+	{
+		TRACE_SCOPE(stage.name);
+		stage.fn();
+	}
+
+	stage.end = Elapsed();
+
+	std::vector<int> ready;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		done++;
+
+		for(int d : stage.dependents) {
+			if(--stages[d].waiting > 0)
+				continue;
+
+			if(stages[d].main)
+				main_ready.push_back(d);
+			else
+				ready.push_back(d);
+		}
+
+		// under the lock: once the last stage is done, Run() returns and the graph may be gone
+		cv.notify_all();
+	}
+
+	// not the last stages: they are not done yet
+	for(int d : ready)
+		Launch(d);
+}
+
+/*---------------------------------------------------------------------------*/
+
+void StartupGraph::Run()
+{
+	// the stages without input first: a done stage may already start its dependents
+	std::vector<int> roots;
+
+	for(unsigned int id = 0; id < stages.size(); id++) {
+		if(stages[id].waiting == 0)
+			roots.push_back(id);
+	}
+
+	for(int id : roots)
+		Launch(id);
+
+	while(true) {
+		int id;
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			cv.wait(lock, [this]() { return !main_ready.empty() || done == stages.size(); });
+
+			if(main_ready.empty())
+				return;
+
+			id = main_ready.front();
+			main_ready.pop_front();
+		}
+
+		Execute(id);
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+
+void StartupGraph::Report()
+{
+	double first_frame = Elapsed();
+	double serial = 0.0;
+
+	std::vector<const Stage*> order;
+
+	for(auto& stage : stages) {
+		order.push_back(&stage);
+		serial += stage.end - stage.start;
+	}
+
+	std::sort(order.begin(), order.end(), [](const Stage* a, const Stage* b) { return a->start < b->start; });
+
+	printf("--- startup (ms)\n");
+	printf("%-16s %8s %8s %8s  %s\n", "stage", "start", "end", "time", "thread");
+
+	for(auto stage : order)
+		printf("%-16s %8.1f %8.1f %8.1f  %s\n", stage->name, stage->start, stage->end, stage->end - stage->start, stage->main ? "main" : "worker");
+
+	printf("time to first frame %.1f ms (stages one after the other: %.1f ms)\n", first_frame, serial);
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "worker_pool.h"
+
+/*---------------------------------------------------------------------------*/
+
+/*
+	Startup sequence as a dependency graph.
+
+	Each stage lists the stages it needs. CPU stages (file reads, data generation and
+	sorting) run on a worker pool of the graph as soon as their inputs are done, GL
+	stages (window / context creation, uploads, shader compilation) run on the thread
+	calling Run(), the one that owns the context, in the order their inputs complete.
+	So the context comes up while the data is generated, and the first GL stage that
+	needs the data waits for it and nothing else.
+
+	The graph has its own pool: CPU stages may use WorkerPool::Instance() (ParallelFor
+	must not be called from a job of the same pool).
+
+		int window = AddMain("window", {}, ...);
+		int points = Add("points", {}, ...);
+		AddMain("upload", {window, points}, ...);
+		Run();
+		...
+		Report(); // after the first frame: per stage times, time to first frame
+*/
+
+class StartupGraph
+{
+	public:
+		// nb_threads: CPU stages running at the same time
+		StartupGraph(unsigned int nb_threads = 3);
+		virtual ~StartupGraph() {}
+
+		// stage on the worker pool, returns its id (dependencies: ids of earlier stages)
+		int Add(const char* name, const std::vector<int>& dependencies, std::function<void()> fn);
+
+		// stage on the Run() thread (GL context)
+		int AddMain(const char* name, const std::vector<int>& dependencies, std::function<void()> fn);
+
+		// returns when every stage is done
+		void Run();
+
+		// stage times since the graph creation, time to first frame: call it once the first frame is swapped
+		void Report();
+
+	private:
+		struct Stage
+		{
+			const char* name;
+			bool main;
+			std::function<void()> fn;
+
+			std::vector<int> dependents;
+			int waiting;
+
+			// ms since creation
+			double start;
+			double end;
+		};
+
+		int AddStage(const char* name, bool main, const std::vector<int>& dependencies, std::function<void()> fn);
+
+		void Launch(int id);
+		void Execute(int id);
+		double Elapsed() const;
+
+		WorkerPool pool;
+
+		std::chrono::steady_clock::time_point creation;
+
+		std::vector<Stage> stages;
+
+		// main stages whose inputs are done, stages done
+		std::mutex mutex;
+		std::condition_variable cv;
+		std::deque<int> main_ready;
+		size_t done;
+};
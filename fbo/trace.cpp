@@ -0,0 +1,233 @@
+#include "trace.h"
+
+#ifdef GLFW_SHADER_TRACE
+
+#include <GL/glew.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// events kept per thread (the oldest ones are overwritten)
+static const uint64_t RING_SIZE = 1 << 16;
+
+// GPU scopes in flight
+static const int GPU_SLOTS = 256;
+
+/*---------------------------------------------------------------------------*/
+
+struct TraceEvent
+{
+	const char* name;
+	uint64_t start;
+	uint64_t end;
+};
+
+// single writer (its thread), read by Flush()
+struct ThreadBuffer
+{
+	unsigned int tid;
+	std::string name;
+
+	std::atomic<uint64_t> head;
+	std::vector<TraceEvent> events;
+};
+
+// never freed: a thread may end before the flush
+static std::mutex registry_mutex;
+static std::vector<ThreadBuffer*> registry;
+
+static thread_local ThreadBuffer* local_buffer = nullptr;
+
+static ThreadBuffer* NewBuffer(const char* name)
+{
+	ThreadBuffer* buffer = new ThreadBuffer();
+	buffer->head = 0;
+	buffer->events.resize(RING_SIZE);
+
+	std::lock_guard<std::mutex> lock(registry_mutex);
+
+	buffer->tid = registry.size() + 1;
+	buffer->name = name ? name : "thread " + std::to_string(buffer->tid);
+	registry.push_back(buffer);
+
+	return buffer;
+}
+
+static ThreadBuffer* LocalBuffer()
+{
+	if(!local_buffer)
+		local_buffer = NewBuffer(nullptr);
+
+	return local_buffer;
+}
+
+static void Push(ThreadBuffer* buffer, const char* name, uint64_t start, uint64_t end)
+{
+	uint64_t h = buffer->head.load(std::memory_order_relaxed);
+
+	TraceEvent& e = buffer->events[h % RING_SIZE];
+	e.name = name;
+	e.start = start;
+	e.end = end;
+
+	buffer->head.store(h + 1, std::memory_order_release);
+}
+
+/*---------------------------------------------------------------------------*/
+
+uint64_t Trace::Now()
+{
+	static const auto epoch = std::chrono::steady_clock::now();
+
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void Trace::ThreadName(const char* name)
+{
+	ThreadBuffer* buffer = LocalBuffer();
+
+	std::lock_guard<std::mutex> lock(registry_mutex);
+	buffer->name = name;
+}
+
+void Trace::Record(const char* name, uint64_t start, uint64_t end)
+{
+	Push(LocalBuffer(), name, start, end);
+}
+
+/*---------------------------------------------------------------------------*/
+
+// GL thread only
+struct GPUSlot
+{
+	const char* name;
+	GLuint queries[2];
+
+	// both timestamps issued, not collected yet
+	bool pending;
+};
+
+static GPUSlot gpu_slots[GPU_SLOTS];
+static bool gpu_init = false;
+static int gpu_next = 0;
+static int gpu_oldest = 0;
+
+// the "GPU" track, written by CollectGPU()
+static ThreadBuffer* gpu_buffer = nullptr;
+
+TraceGPUScope::TraceGPUScope(const char* name)
+{
+	if(!gpu_init) {
+		for(int i = 0; i < GPU_SLOTS; i++) {
+			glGenQueries(2, gpu_slots[i].queries);
+			gpu_slots[i].pending = false;
+		}
+
+		gpu_buffer = NewBuffer("GPU");
+		gpu_init = true;
+
+		// starts the CPU clock: no GPU event before its epoch
+		Trace::Now();
+	}
+
+	// every slot in flight (collect not called): not measured
+	if(gpu_slots[gpu_next].pending || (gpu_next + 1) % GPU_SLOTS == gpu_oldest) {
+		slot = -1;
+		return;
+	}
+
+	slot = gpu_next;
+	gpu_next = (gpu_next + 1) % GPU_SLOTS;
+
+	gpu_slots[slot].name = name;
+	glQueryCounter(gpu_slots[slot].queries[0], GL_TIMESTAMP);
+}
+
+TraceGPUScope::~TraceGPUScope()
+{
+	if(slot < 0)
+		return;
+
+	glQueryCounter(gpu_slots[slot].queries[1], GL_TIMESTAMP);
+	gpu_slots[slot].pending = true;
+}
+
+void Trace::CollectGPU()
+{
+	if(!gpu_init)
+		return;
+
+	// GPU clock -> CPU time base, taken again every frame (no drift)
+	GLint64 gpu_now = 0;
+	glGetInteger64v(GL_TIMESTAMP, &gpu_now);
+
+	int64_t offset = (int64_t)Now() - (int64_t)gpu_now;
+
+	// in issue order, up to the first one still running
+	while(gpu_oldest != gpu_next && gpu_slots[gpu_oldest].pending) {
+		GPUSlot& s = gpu_slots[gpu_oldest];
+
+		GLint available = 0;
+		glGetQueryObjectiv(s.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+
+		if(!available)
+			break;
+
+		GLuint64 start = 0;
+		GLuint64 end = 0;
+		glGetQueryObjectui64v(s.queries[0], GL_QUERY_RESULT, &start);
+		glGetQueryObjectui64v(s.queries[1], GL_QUERY_RESULT, &end);
+
+		Push(gpu_buffer, s.name, (uint64_t)((int64_t)start + offset), (uint64_t)((int64_t)end + offset));
+
+		s.pending = false;
+		gpu_oldest = (gpu_oldest + 1) % GPU_SLOTS;
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+
+void Trace::Flush(const char* path)
+{
+	FILE* file = fopen(path, "w");
+
+	if(!file) {
+		std::cout << "ERROR::TRACE:: cannot write " << path << std::endl;
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(registry_mutex);
+
+	size_t nb_events = 0;
+	bool first = true;
+
+	fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+	for(ThreadBuffer* buffer : registry) {
+		fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}", first ? "" : ",\n", buffer->tid, buffer->name.c_str());
+		first = false;
+
+		uint64_t head = buffer->head.load(std::memory_order_acquire);
+		uint64_t begin = head > RING_SIZE ? head - RING_SIZE : 0;
+
+		for(uint64_t i = begin; i < head; i++) {
+			const TraceEvent& e = buffer->events[i % RING_SIZE];
+
+			// complete events, microseconds
+			fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}", e.name, e.start / 1e3, (e.end - e.start) / 1e3, buffer->tid);
+			nb_events++;
+		}
+	}
+
+	fprintf(file, "\n]}\n");
+	fclose(file);
+
+	std::cout << "Trace: " << nb_events << " events, " << registry.size() << " tracks -> " << path << std::endl;
+}
+
+#endif
@@ -0,0 +1,78 @@
+#pragma once
+
+/*---------------------------------------------------------------------------*/
+
+/*
+	Scoped CPU / GPU trace instrumentation, built only with -DGLFW_SHADER_TRACE (cmake
+	-DTRACE=ON). Otherwise every macro below expands to nothing.
+
+	TRACE_THREAD(str)      names the calling thread (its track in the viewer)
+	TRACE_SCOPE(str)       CPU time until the end of the enclosing scope
+	TRACE_GPU_SCOPE(str)   GPU time of the GL commands of the enclosing scope (GL thread)
+	TRACE_GPU_COLLECT()    once per frame: reads the GPU timestamps that are available
+	TRACE_FLUSH(path)      writes every event as Chrome trace-event JSON (chrome://tracing,
+	                       ui.perfetto.dev)
+
+	Names must be string literals (only the pointer is stored). Each thread writes its
+	events into its own ring buffer (no lock, the oldest events are overwritten), with
+	steady_clock nanosecond timestamps. GPU scopes are glQueryCounter(GL_TIMESTAMP)
+	pairs, moved to the CPU time base when collected: they get their own "GPU" track.
+*/
+
+#ifdef GLFW_SHADER_TRACE
+
+#include <cstdint>
+
+class Trace
+{
+	public:
+		static void ThreadName(const char* name);
+		static void Flush(const char* path);
+
+		// ns since the first use
+		static uint64_t Now();
+
+		static void Record(const char* name, uint64_t start, uint64_t end);
+
+		static void CollectGPU();
+};
+
+class TraceScope
+{
+	public:
+		TraceScope(const char* name) : name(name), start(Trace::Now()) {}
+		~TraceScope() { Trace::Record(name, start, Trace::Now()); }
+
+	private:
+		const char* name;
+		uint64_t start;
+};
+
+class TraceGPUScope
+{
+	public:
+		TraceGPUScope(const char* name);
+		~TraceGPUScope();
+
+	private:
+		int slot;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+#define TRACE_THREAD(name) Trace::ThreadName(name)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+#define TRACE_GPU_SCOPE(name) TraceGPUScope TRACE_CONCAT(trace_gpu_scope_, __LINE__)(name)
+#define TRACE_GPU_COLLECT() Trace::CollectGPU()
+#define TRACE_FLUSH(path) Trace::Flush(path)
+
+#else
+
+#define TRACE_THREAD(name) do {} while(0)
+#define TRACE_SCOPE(name) do {} while(0)
+#define TRACE_GPU_SCOPE(name) do {} while(0)
+#define TRACE_GPU_COLLECT() do {} while(0)
+#define TRACE_FLUSH(path) do {} while(0)
+
+#endif
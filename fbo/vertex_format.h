@@ -0,0 +1,251 @@
+#pragma once
+
+#define GLM_ENABLE_EXPERIMENTAL
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+/*---------------------------------------------------------------------------*/
+
+/*
+	Vertex formats described once, at compile time.
+
+	An attribute is a tag type: shader location + host type. A format lists its
+	attributes, everything else comes from that list: the packed host vertex
+	(interleaved), the per attribute arrays (SoA), the sizes / offsets of both
+	layouts and the glVertexAttribPointer calls.
+
+		typedef VertexFormat<Position, Color, Intensity> Format;
+
+		Format::Vertex v;                                      // packed, Format::stride bytes
+		v.Get<Color>() = RGBA8{255, 0, 0, 255};
+
+		Format::Arrays arrays;                                 // one vector per attribute
+		arrays.Get<Position>().push_back(p);
+
+		std::vector<unsigned char> bytes = Format::Pack(arrays, LAYOUT_SOA);
+
+		Format::Setup(LAYOUT_SOA, nb_vertices);                // every attribute
+		Format::Setup<Position>(LAYOUT_SOA, nb_vertices);      // depth / shadow pass VAO
+
+	Interleaved: one vertex after the other, every pass reads whole vertices.
+	SoA: one block per attribute in the same buffer, a position only pass reads
+	the position block and nothing else.
+*/
+
+enum VertexLayout
+{
+	LAYOUT_INTERLEAVED,
+	LAYOUT_SOA
+};
+
+// 4 normalized unsigned bytes (packed color)
+struct RGBA8
+{
+	uint8_t r, g, b, a;
+};
+
+/*---------------------------------------------------------------------------*/
+
+// host type -> glVertexAttribPointer parameters
+template<typename T> struct AttributeType;
+
+template<> struct AttributeType<float>     { static constexpr GLint components = 1; static constexpr GLenum type = GL_FLOAT; static constexpr GLboolean normalized = GL_FALSE; };
+template<> struct AttributeType<glm::vec2> { static constexpr GLint components = 2; static constexpr GLenum type = GL_FLOAT; static constexpr GLboolean normalized = GL_FALSE; };
+template<> struct AttributeType<glm::vec3> { static constexpr GLint components = 3; static constexpr GLenum type = GL_FLOAT; static constexpr GLboolean normalized = GL_FALSE; };
+template<> struct AttributeType<glm::vec4> { static constexpr GLint components = 4; static constexpr GLenum type = GL_FLOAT; static constexpr GLboolean normalized = GL_FALSE; };
+template<> struct AttributeType<RGBA8>     { static constexpr GLint components = 4; static constexpr GLenum type = GL_UNSIGNED_BYTE; static constexpr GLboolean normalized = GL_TRUE; };
+
+template<GLuint LOCATION, typename T>
+struct Attribute
+{
+	static constexpr GLuint location = LOCATION;
+	typedef T type;
+};
+
+// point attributes (locations of the scene shaders)
+struct Position  : Attribute<0, glm::vec3> {};
+struct Color     : Attribute<1, RGBA8> {};
+struct Intensity : Attribute<2, float> {};
+struct Normal    : Attribute<3, glm::vec3> {};
+struct Timestamp : Attribute<4, float> {};
+
+// screen quad (quad_vs.glsl)
+struct QuadPosition : Attribute<0, glm::vec2> {};
+struct QuadTexCoord : Attribute<1, glm::vec2> {};
+
+/*---------------------------------------------------------------------------*/
+
+namespace vertex_format_detail
+{
+	template<typename X, typename... A> struct IndexOf;
+	template<typename X, typename... A> struct IndexOf<X, X, A...> : std::integral_constant<size_t, 0> {};
+	template<typename X, typename Y, typename... A> struct IndexOf<X, Y, A...> : std::integral_constant<size_t, 1 + IndexOf<X, A...>::value> {};
+
+	// bytes of the attributes before index
+	template<typename... A>
+	constexpr size_t OffsetOf(size_t index)
+	{
+		constexpr size_t sizes[] = { sizeof(typename A::type)... };
+		size_t offset = 0;
+
+		for(size_t i = 0; i < index; i++)
+			offset += sizes[i];
+
+		return offset;
+	}
+
+	// members one after the other (every host type is 4 bytes aligned: no padding, checked by VertexFormat)
+	template<typename... A> struct Packed;
+
+	template<typename A>
+	struct Packed<A>
+	{
+		typename A::type value;
+	};
+
+	template<typename A, typename B, typename... R>
+	struct Packed<A, B, R...>
+	{
+		typename A::type value;
+		Packed<B, R...> rest;
+	};
+
+	template<size_t I>
+	struct Member
+	{
+		template<typename P> static auto& Get(P& p) { return Member<I - 1>::Get(p.rest); }
+	};
+
+	template<>
+	struct Member<0>
+	{
+		template<typename P> static auto& Get(P& p) { return p.value; }
+	};
+}
+
+/*---------------------------------------------------------------------------*/
+
+template<typename... A>
+struct VertexFormat
+{
+	static_assert(sizeof...(A) > 0, "empty vertex format");
+
+	// interleaved vertex size, also the sum of the SoA element sizes
+	static constexpr size_t stride = (sizeof(typename A::type) + ...);
+
+	template<typename X>
+	static constexpr bool Has() { return (std::is_same<X, A>::value || ...); }
+
+	template<typename X>
+	static constexpr size_t Index()
+	{
+		static_assert(Has<X>(), "attribute not in the vertex format");
+		return vertex_format_detail::IndexOf<X, A...>::value;
+	}
+
+	// interleaved: offset in a vertex, SoA: offset of the attribute block (the same sum, times the vertex count)
+	template<typename X>
+	static constexpr size_t Offset(VertexLayout layout, size_t nb_vertices)
+	{
+		return vertex_format_detail::OffsetOf<A...>(Index<X>()) * (layout == LAYOUT_SOA ? nb_vertices : 1);
+	}
+
+	template<typename X>
+	static constexpr GLsizei Stride(VertexLayout layout)
+	{
+		return layout == LAYOUT_SOA ? sizeof(typename X::type) : stride;
+	}
+
+	// packed host vertex
+	struct Vertex
+	{
+		template<typename X> typename X::type& Get() { return vertex_format_detail::Member<Index<X>()>::Get(data); }
+		template<typename X> const typename X::type& Get() const { return vertex_format_detail::Member<Index<X>()>::Get(data); }
+
+		vertex_format_detail::Packed<A...> data;
+	};
+
+	// one array per attribute, all of the same size
+	struct Arrays
+	{
+		template<typename X> std::vector<typename X::type>& Get() { return std::get<Index<X>()>(arrays); }
+		template<typename X> const std::vector<typename X::type>& Get() const { return std::get<Index<X>()>(arrays); }
+
+		size_t Size() const { return std::get<0>(arrays).size(); }
+		void Resize(size_t n) { std::apply([n](auto&... a) { (a.resize(n), ...); }, arrays); }
+
+		std::tuple<std::vector<typename A::type>...> arrays;
+	};
+
+	// buffer image of the arrays in the given layout
+	static std::vector<unsigned char> Pack(const Arrays& arrays, VertexLayout layout)
+	{
+		size_t n = arrays.Size();
+		std::vector<unsigned char> bytes(n * stride);
+
+		(PackAttribute<A>(arrays, layout, bytes), ...);
+
+		return bytes;
+	}
+
+	// with the VAO and the vertex buffer bound: every attribute, or only the listed ones (the others are not fetched)
+	template<typename... Only>
+	static void Setup(VertexLayout layout, size_t nb_vertices)
+	{
+		if constexpr(sizeof...(Only) == 0)
+			(SetupAttribute<A>(layout, nb_vertices), ...);
+		else
+			(SetupAttribute<Only>(layout, nb_vertices), ...);
+	}
+
+	private:
+		template<typename X>
+		static void PackAttribute(const Arrays& arrays, VertexLayout layout, std::vector<unsigned char>& bytes)
+		{
+			const std::vector<typename X::type>& src = arrays.template Get<X>();
+			const size_t size = sizeof(typename X::type);
+
+			if(src.empty())
+				return;
+
+			if(layout == LAYOUT_SOA) {
+				memcpy(&bytes[Offset<X>(LAYOUT_SOA, src.size())], &src[0], src.size() * size);
+				return;
+			}
+
+			unsigned char* dst = &bytes[Offset<X>(LAYOUT_INTERLEAVED, 0)];
+
+			for(size_t i = 0; i < src.size(); i++, dst += stride)
+				memcpy(dst, &src[i], size);
+		}
+
+		template<typename X>
+		static void SetupAttribute(VertexLayout layout, size_t nb_vertices)
+		{
+			static_assert(Has<X>(), "attribute not in the vertex format");
+
+			typedef AttributeType<typename X::type> T;
+
+			glEnableVertexAttribArray(X::location);
+			glVertexAttribPointer(X::location, T::components, T::type, T::normalized, Stride<X>(layout), (void*)Offset<X>(layout, nb_vertices));
+		}
+};
+
+/*---------------------------------------------------------------------------*/
+
+// point formats
+typedef VertexFormat<Position> PointFormat;
+typedef VertexFormat<Position, Color, Intensity, Normal, Timestamp> FullPointFormat;
+
+typedef VertexFormat<QuadPosition, QuadTexCoord> QuadFormat;
+
+static_assert(sizeof(PointFormat::Vertex) == PointFormat::stride, "padding in PointFormat::Vertex");
+static_assert(sizeof(FullPointFormat::Vertex) == FullPointFormat::stride, "padding in FullPointFormat::Vertex");
+static_assert(sizeof(QuadFormat::Vertex) == QuadFormat::stride, "padding in QuadFormat::Vertex");
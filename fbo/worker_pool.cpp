@@ -0,0 +1,152 @@
+#include "worker_pool.h"
+#include "trace.h"
+
+#include <algorithm>
+
+/*---------------------------------------------------------------------------*/
+
+WorkerPool::WorkerPool(unsigned int nb_threads)
+{
+	if(nb_threads == 0)
+		nb_threads = std::max(1u, std::thread::hardware_concurrency());
+
+	this->nb_slices = nb_threads;
+	this->stop = false;
+	this->first_job = 0;
+	this->nb_jobs = 0;
+
+	// the thread calling ParallelFor() works too: one thread less in the pool
+	for(unsigned int i = 1; i < nb_threads; i++)
+		threads.emplace_back(&WorkerPool::Loop, this);
+}
+
+/*---------------------------------------------------------------------------*/
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stop = true;
+	}
+
+	cv.notify_all();
+
+	for(auto& t : threads)
+		t.join();
+}
+
+/*---------------------------------------------------------------------------*/
+
+WorkerPool& WorkerPool::Instance()
+{
+	static WorkerPool pool;
+	return pool;
+}
+
+/*---------------------------------------------------------------------------*/
+
+void WorkerPool::Push(std::function<void()> job)
+{
+	if(threads.empty()) {
+		job();
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if(nb_jobs == jobs.size()) {
+			std::vector<std::function<void()>> grown(std::max((size_t)16, 2 * jobs.size()));
+
+			for(size_t i = 0; i < nb_jobs; i++)
+				grown[i] = std::move(jobs[(first_job + i) % jobs.size()]);
+
+			jobs.swap(grown);
+			first_job = 0;
+		}
+
+		jobs[(first_job + nb_jobs) % jobs.size()] = std::move(job);
+		nb_jobs++;
+	}
+
+	cv.notify_one();
+}
+
+/*---------------------------------------------------------------------------*/
+
+void WorkerPool::Loop()
+{
+	TRACE_THREAD("worker");
+
+	while(true) {
+		std::function<void()> job;
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			cv.wait(lock, [this]() { return stop || nb_jobs > 0; });
+
+			if(stop && nb_jobs == 0)
+				return;
+
+			job = std::move(jobs[first_job]);
+			first_job = (first_job + 1) % jobs.size();
+			nb_jobs--;
+		}
+
+		TRACE_SCOPE("job");
+		job();
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+
+void WorkerPool::ParallelFor(size_t count, void (*fn)(void*, size_t, size_t, unsigned int), void* context)
+{
+	if(count == 0)
+		return;
+
+	// on the caller's stack, the jobs only carry a pointer to it and their slice
+	struct Slices
+	{
+		void (*fn)(void*, size_t, size_t, unsigned int);
+		void* context;
+		size_t count;
+		size_t slice_size;
+
+		unsigned int remaining;
+		std::mutex done_mutex;
+		std::condition_variable done_cv;
+	};
+
+	unsigned int slices = std::min((size_t)nb_slices, count);
+
+	Slices state;
+	state.fn = fn;
+	state.context = context;
+	state.count = count;
+	state.slice_size = (count + slices - 1) / slices;
+	state.remaining = slices - 1;
+
+	Slices* p = &state;
+
+	for(unsigned int s = 1; s < slices; s++) {
+		Push([p, s]() {
+			size_t begin = std::min(p->count, s * p->slice_size);
+			size_t end = std::min(p->count, begin + p->slice_size);
+
+			p->fn(p->context, begin, end, s);
+
+			// decrement under the lock: the caller's stack (mutex, cv) may vanish right after
+			std::lock_guard<std::mutex> lock(p->done_mutex);
+
+			if(--p->remaining == 0)
+				p->done_cv.notify_one();
+		});
+	}
+
+	// slice 0 on the calling thread
+	fn(context, 0, std::min(count, state.slice_size), 0);
+
+	std::unique_lock<std::mutex> lock(state.done_mutex);
+	state.done_cv.wait(lock, [&]() { return state.remaining == 0; });
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/*---------------------------------------------------------------------------*/
+
+/*
+	Fixed set of worker threads fed by a FIFO job queue.
+
+	ParallelFor() splits [0, count) into one slice per worker and blocks until all slices
+	are done (the calling thread runs a slice too), Submit() queues a single job and
+	returns a future. ParallelFor() must not be called from inside a pool job.
+
+	ParallelFor() does not allocate: the function is called through a pointer to it (no
+	std::function), the slice jobs fit in the std::function local storage and the job
+	queue is a ring that only grows. It can run every frame.
+*/
+
+class WorkerPool
+{
+	public:
+		// nb_threads = 0: one thread per hardware core
+		WorkerPool(unsigned int nb_threads = 0);
+		virtual ~WorkerPool();
+
+		unsigned int Size() const { return nb_slices; }
+
+		// fn(begin, end, slice_index) with slice_index < Size()
+		template<typename F>
+		void ParallelFor(size_t count, F&& fn)
+		{
+			typedef typename std::remove_reference<F>::type Function;
+
+			auto call = [](void* context, size_t begin, size_t end, unsigned int slice) {
+				(*static_cast<Function*>(context))(begin, end, slice);
+			};
+
+			ParallelFor(count, call, (void*)&fn);
+		}
+
+		void ParallelFor(size_t count, void (*fn)(void*, size_t, size_t, unsigned int), void* context);
+
+		template<typename F>
+		auto Submit(F&& fn) -> std::future<decltype(fn())>
+		{
+			auto task = std::make_shared<std::packaged_task<decltype(fn())()>>(std::forward<F>(fn));
+			auto result = task->get_future();
+
+			Push([task]() { (*task)(); });
+
+			return result;
+		}
+
+		// process wide pool, shared by the preprocessing stages
+		static WorkerPool& Instance();
+
+	private:
+		void Push(std::function<void()> job);
+		void Loop();
+
+		unsigned int nb_slices;
+
+		std::vector<std::thread> threads;
+
+		// FIFO ring: nb_jobs jobs from first_job, doubled when full
+		std::vector<std::function<void()>> jobs;
+		size_t first_job;
+		size_t nb_jobs;
+
+		std::mutex mutex;
+		std::condition_variable cv;
+		bool stop;
+};